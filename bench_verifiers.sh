@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Compares the candidate verifiers as the key set (and DFA) grows
+# Usage: ./bench_verifiers.sh <json_file> [out_dir]
+
+if [[ $# -lt 1 ]]; then
+    echo "Usage: $0 <json_file> [out_dir]" >&2
+    exit 1
+fi
+
+json_file="$1"
+out_dir="${2:-bench_out_verifiers}"
+
+cmake -S . -B build -DCMAKE_BUILD_TYPE=Release -DBUILD_TESTING=OFF
+cmake --build build --target bench_matrix -j
+
+./build/bench_matrix \
+    --json "$json_file" \
+    --out-dir "$out_dir" \
+    --mode bench \
+    --algo teddy \
+    --algo teddy_baseline \
+    --key-type highest \
+    --key-type mixed \
+    --num-keys 16 \
+    --num-keys 64 \
+    --num-keys 256 \
+    --num-keys 1024 \
+    --num-keys 4096 \
+    --grouping greedy_paper_policy \
+    --score paper \
+    --suffix-mode raw \
+    --sigma 3 \
+    --verifier dfa \
+    --verifier top_trie \
+    --verifier pipelined
@@ -45,6 +45,11 @@ struct findkey_teddy_stats {
     uint64_t reject_key_not_found;
 
     uint64_t exact_matches;
+
+    // TEDDY_SCAN_ADAPTIVE only
+    uint64_t switches_to_tokenizer;
+    uint64_t switches_to_teddy;
+    uint64_t tokenizer_bytes;
 };
 
 struct findkey_timing {
@@ -52,6 +57,14 @@ struct findkey_timing {
     uint64_t match_ns;
 };
 
+struct findkey_compile_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t capacity;
+};
+
 enum findkey_teddy_compile_grouping_strategy {
     TEDDY_COMPILE_GREEDY_PAPER_POLICY = 0,
     TEDDY_COMPILE_GREEDY_MIN_DELTA = 1,
@@ -63,25 +76,124 @@ enum findkey_teddy_compile_grouping_strategy {
     TEDDY_COMPILE_SORTED_SUFFIX_ROUND_ROBIN = 7,
     TEDDY_COMPILE_SORTED_SUFFIX_PARTITION = 8,
     TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION = 9,
+    TEDDY_COMPILE_BRANCH_AND_BOUND = 10,
+    TEDDY_COMPILE_NIBBLE_CLUSTERING = 11,
     FINDKEY_TEDDY_COMPILE_GROUPING_STRATEGY_COUNT,
+
+    // not a grouping of its own, see findkey_teddy_select_config
+    TEDDY_COMPILE_AUTO = 64,
 };
 
 enum findkey_teddy_grouping_score {
     TEDDY_GROUPING_SCORE_PAPER = 0,
     TEDDY_GROUPING_SCORE_PAPER_NIBBLE = 1,
     TEDDY_GROUPING_SCORE_NIBBLE_COUNT = 2,
+    TEDDY_GROUPING_SCORE_FREQUENCY = 3,
     FINDKEY_TEDDY_GROUPING_SCORE_COUNT,
 };
 
 enum findkey_teddy_suffix_mode {
     TEDDY_SUFFIX_RAW = 0,
     TEDDY_SUFFIX_QUOTED = 1,
+    // per group, the sigma bytes up to 7 before the key ends the input
+    // histogram makes rarest
+    TEDDY_SUFFIX_WINDOW = 2,
+    // the opening quote and the first sigma bytes of every key, verified
+    // forward through a trie of the keys whatever the verifier
+    TEDDY_SUFFIX_PREFIX = 3,
+    // TEDDY_SUFFIX_PREFIX when the keys have more distinct first sigma bytes
+    // than last sigma bytes, TEDDY_SUFFIX_RAW otherwise
+    TEDDY_SUFFIX_AUTO = 4,
     FINDKEY_TEDDY_SUFFIX_MODE_COUNT,
 };
 
+enum findkey_teddy_verifier {
+    TEDDY_VERIFY_DFA = 0,
+    TEDDY_VERIFY_SUFFIX_TABLE = 1,
+    TEDDY_VERIFY_TOP_TRIE = 2,
+    TEDDY_VERIFY_PIPELINED = 3,
+    TEDDY_VERIFY_SWAR = 4,
+    FINDKEY_TEDDY_VERIFIER_COUNT,
+};
+
+enum findkey_teddy_scan_mode {
+    TEDDY_SCAN_FIXED = 0,
+    // a quote tokenizer takes over after the closing quote of the next key,
+    // searched for or not, in a 4 KiB window Teddy rejected 512 candidates
+    // in; dense runs of strings that are not keys stay on Teddy
+    TEDDY_SCAN_ADAPTIVE = 1,
+    FINDKEY_TEDDY_SCAN_MODE_COUNT,
+};
+
+enum findkey_query_mode {
+    // every match, as findkey
+    FINDKEY_QUERY_ALL = 0,
+    // the first match
+    FINDKEY_QUERY_ANY = 1,
+    // the first match of every key, done once each key has matched
+    FINDKEY_QUERY_FIRST_PER_KEY = 2,
+    // the first limit matches
+    FINDKEY_QUERY_LIMIT = 3,
+    FINDKEY_QUERY_MODE_COUNT,
+};
+
+struct findkey_query {
+    enum findkey_query_mode mode;
+    // FINDKEY_QUERY_LIMIT only, at least 1
+    size_t limit;
+};
+
+#define FINDKEY_QUERY_INIT {FINDKEY_QUERY_ALL, 0}
+
+/*
+    Resume token of findkey_with_cursor, pass it back unchanged
+    - offset: where the next call restarts the scan, a block boundary for
+      TEDDY; the kernel state is rebuilt from the block before it
+    - skip: matches found from offset that were already returned
+    - done: set once the scan reached the end of the data
+*/
+struct findkey_cursor {
+    size_t offset;
+    size_t skip;
+    int done;
+};
+
+#define FINDKEY_CURSOR_INIT {0, 0, 0}
+
+/*
+    Output arrays of findkey_columns, 6 to 12 bytes a result instead of the
+    16 of a padded findkey_result
+    - exactly one of positions and positions32, positions32 only for data
+      under 4 GiB
+    - exactly one of key_ids and key_ids16, key_ids16 only for at most
+      65536 keys
+    - capacity: entries of each array
+*/
+struct findkey_result_columns {
+    uint64_t* positions;
+    uint32_t* positions32;
+    uint32_t* key_ids;
+    uint16_t* key_ids16;
+    size_t capacity;
+};
+
+// byte counts of (a sample of) the input
+struct findkey_byte_histogram {
+    uint64_t counts[256];
+};
+
 struct findkey_teddy_grouping_config {
     enum findkey_teddy_compile_grouping_strategy strategy;
     enum findkey_teddy_grouping_score score;
+
+    // TEDDY_GROUPING_SCORE_FREQUENCY and TEDDY_SUFFIX_WINDOW only
+    // NULL: findkey samples the input before compiling
+    const struct findkey_byte_histogram* byte_histogram;
+
+    // move/swap local search after any strategy, 0 passes: off
+    uint32_t refine_max_passes;
+    // 0: no time limit
+    uint32_t refine_time_limit_ms;
 };
 
 struct findkey_teddy_config {
@@ -89,14 +201,19 @@ struct findkey_teddy_config {
     enum findkey_teddy_suffix_mode suffix_mode;
 
     int sigma;
+
+    enum findkey_teddy_verifier verifier;
+
+    enum findkey_teddy_scan_mode scan_mode;
 };
 
-#define FINDKEY_TEDDY_GROUPING_CONFIG_INIT \
-    {TEDDY_COMPILE_GREEDY_PAPER_POLICY, TEDDY_GROUPING_SCORE_PAPER}
+#define FINDKEY_TEDDY_GROUPING_CONFIG_INIT                          \
+    {TEDDY_COMPILE_GREEDY_PAPER_POLICY, TEDDY_GROUPING_SCORE_PAPER, \
+     NULL, 0, 0}
 
 #define FINDKEY_TEDDY_CONFIG_INIT                          \
     {FINDKEY_TEDDY_GROUPING_CONFIG_INIT, TEDDY_SUFFIX_RAW, \
-     FINDKEY_TEDDY_DEFAULT_SUFFIX_LENGTH}
+     FINDKEY_TEDDY_DEFAULT_SUFFIX_LENGTH, TEDDY_VERIFY_DFA, TEDDY_SCAN_FIXED}
 
 size_t findkey(const uint8_t* data,
                size_t len,
@@ -110,6 +227,95 @@ size_t findkey(const uint8_t* data,
                int* out_status,
                struct findkey_timing* out_timing);
 
+/*
+    findkey that stops scanning once query is answered
+    - the SIMD matchers check between 16-byte blocks and scan one block
+      more, since a hit may verify a key ending in the next block; the
+      scalar matchers stop at the answer
+    - results are ordered by position, except for FINDKEY_QUERY_ALL which
+      keeps the order of findkey
+    - returns the number of results the query keeps
+    - NULL query: FINDKEY_QUERY_ALL, FINDKEY_ERR_BAD_ARGS for an unknown
+      mode or a limit of 0
+*/
+size_t findkey_with_query(const uint8_t* data,
+                          size_t len,
+                          const uint8_t* const* keys,
+                          const size_t* key_lens,
+                          size_t num_keys,
+                          enum findkey_algo algo,
+                          const struct findkey_teddy_config* teddy_config,
+                          const struct findkey_query* query,
+                          struct findkey_result* out_results,
+                          size_t max_out_positions,
+                          int* out_status,
+                          struct findkey_timing* out_timing);
+
+/*
+    findkey writing at most max_out_positions results per call, then
+    continuing from cursor on the next call
+    - returns the number of results written to out_results, 0 once
+      cursor->done is set; the calls together return what findkey returns
+    - results come in scan order: TEDDY_VERIFY_PIPELINED verifies one
+      candidate at a time and TEDDY_SCAN_ADAPTIVE scans fixed here, so the
+      order may differ from findkey but never the results
+    - FINDKEY_ERR_BAD_ARGS for max_out_positions 0 or an offset past len
+    - the Teddy algorithms compile the keys on every call unless the compile
+      cache holds them, see findkey_set_compile_cache_capacity; compile once
+      with findkey_db_compile and page with findkey_db_match_with_cursor
+    - refine_time_limit_ms is ignored, skip relies on every call grouping
+      the keys the same way
+*/
+size_t findkey_with_cursor(const uint8_t* data,
+                           size_t len,
+                           const uint8_t* const* keys,
+                           const size_t* key_lens,
+                           size_t num_keys,
+                           enum findkey_algo algo,
+                           const struct findkey_teddy_config* teddy_config,
+                           struct findkey_cursor* cursor,
+                           struct findkey_result* out_results,
+                           size_t max_out_positions,
+                           int* out_status,
+                           struct findkey_timing* out_timing);
+
+/*
+    findkey writing positions and key ids into separate arrays, straight
+    from the matcher
+    - the first out->capacity results in findkey's order, returns the total
+      count as findkey does
+    - FINDKEY_ERR_BAD_ARGS when out does not have one array of each or its
+      narrow arrays cannot hold len or num_keys
+*/
+size_t findkey_columns(const uint8_t* data,
+                       size_t len,
+                       const uint8_t* const* keys,
+                       const size_t* key_lens,
+                       size_t num_keys,
+                       enum findkey_algo algo,
+                       const struct findkey_teddy_config* teddy_config,
+                       const struct findkey_result_columns* out,
+                       int* out_status,
+                       struct findkey_timing* out_timing);
+
+/*
+    Matches of every key counted as they are verified, no findkey_result is
+    stored
+    - out_counts has num_keys entries, indexed by key id; a repeated key
+      counts under its first id, as findkey reports it
+    - returns the sum of out_counts, the count findkey would return
+*/
+size_t findkey_count(const uint8_t* data,
+                     size_t len,
+                     const uint8_t* const* keys,
+                     const size_t* key_lens,
+                     size_t num_keys,
+                     enum findkey_algo algo,
+                     const struct findkey_teddy_config* teddy_config,
+                     uint64_t* out_counts,
+                     int* out_status,
+                     struct findkey_timing* out_timing);
+
 // statistics collection for teddy
 size_t findkey_with_stats(const uint8_t* data,
                           size_t len,
@@ -121,6 +327,198 @@ size_t findkey_with_stats(const uint8_t* data,
                           int* out_status,
                           struct findkey_timing* out_timing);
 
+// counts the bytes of evenly spaced chunks, at most 1 MiB in total
+void findkey_sample_byte_histogram(
+    const uint8_t* data,
+    size_t len,
+    struct findkey_byte_histogram* out_histogram);
+
+/*
+    Resolves TEDDY_COMPILE_AUTO, any other config is copied as is
+    - every grouping strategy, score and sigma is compiled on a thread pool
+      and run through the baseline prefilter over a sample of data
+    - the candidate with the fewest prefilter hit lanes wins, the first one
+      on ties; suffix mode, verifier, scan mode, refinement and histogram
+      are kept
+    - findkey and findkey_with_stats resolve TEDDY_COMPILE_AUTO the same
+      way, out_config can be stored to skip the search next time
+*/
+void findkey_teddy_select_config(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    const struct findkey_teddy_config* teddy_config,
+    struct findkey_teddy_config* out_config,
+    int* out_status);
+
+/*
+    Teddy tables, groups and verification tries compiled once and reused
+    - sample is tuned on like findkey tunes on its input, TEDDY_COMPILE_AUTO
+      is resolved on it, NULL with sample_len 0 tunes on nothing
+    - NULL on failure, with out_status set
+*/
+struct findkey_db;
+
+struct findkey_db* findkey_db_compile(
+    const uint8_t* sample,
+    size_t sample_len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    const struct findkey_teddy_config* teddy_config,
+    int* out_status);
+
+void findkey_db_free(struct findkey_db* db);
+
+// removed keys included, key ids run from 0 to findkey_db_num_keys - 1
+size_t findkey_db_num_keys(const struct findkey_db* db);
+
+// bytes of key key_id, stored in db, NULL for unknown and removed ids
+const uint8_t* findkey_db_key(const struct findkey_db* db,
+                              uint32_t key_id,
+                              size_t* out_len);
+
+/*
+    Key set updates in place, without a full recompile
+    - findkey_db_add_key returns the id of the new key, the next unused one;
+      it goes into the trie and its suffix into the group whose estimated
+      pass rate grows the least, only that group's table bits change
+    - a removed id is never reused, FINDKEY_ERR_BAD_ARGS for unknown and
+      removed ids
+    - both regroup every key from scratch once the estimated pass rate
+      grows 50% past the last full grouping, or when a new key is shorter
+      than the suffixes; regrouping tunes on uniform bytes, db keeps no
+      sample
+    - a mapped db copies what it changes, no call may run alongside another
+      one on the same db
+*/
+uint32_t findkey_db_add_key(struct findkey_db* db,
+                            const uint8_t* key,
+                            size_t key_len,
+                            int* out_status);
+
+void findkey_db_remove_key(struct findkey_db* db,
+                           uint32_t key_id,
+                           int* out_status);
+
+// same results as findkey with algo TEDDY and the config of db
+size_t findkey_db_match(const struct findkey_db* db,
+                        const uint8_t* data,
+                        size_t len,
+                        struct findkey_result* out_results,
+                        size_t max_out_positions,
+                        int* out_status,
+                        struct findkey_timing* out_timing);
+
+// findkey_db_match stopping once query is answered, as findkey_with_query
+size_t findkey_db_match_with_query(const struct findkey_db* db,
+                                   const uint8_t* data,
+                                   size_t len,
+                                   const struct findkey_query* query,
+                                   struct findkey_result* out_results,
+                                   size_t max_out_positions,
+                                   int* out_status,
+                                   struct findkey_timing* out_timing);
+
+// findkey_db_match continuing from cursor, as findkey_with_cursor
+size_t findkey_db_match_with_cursor(const struct findkey_db* db,
+                                    const uint8_t* data,
+                                    size_t len,
+                                    struct findkey_cursor* cursor,
+                                    struct findkey_result* out_results,
+                                    size_t max_out_positions,
+                                    int* out_status,
+                                    struct findkey_timing* out_timing);
+
+// findkey_columns with db, key_ids16 needs at most 65536 keys
+size_t findkey_db_match_columns(const struct findkey_db* db,
+                                const uint8_t* data,
+                                size_t len,
+                                const struct findkey_result_columns* out,
+                                int* out_status,
+                                struct findkey_timing* out_timing);
+
+// findkey_count with db, out_counts has findkey_db_num_keys entries
+size_t findkey_db_count(const struct findkey_db* db,
+                        const uint8_t* data,
+                        size_t len,
+                        uint64_t* out_counts,
+                        int* out_status,
+                        struct findkey_timing* out_timing);
+
+/*
+    Versioned binary image of db
+    - returns its size, written to out only if it fits in capacity, so
+      NULL and 0 query the size
+    - only loads on a machine with the same byte order
+*/
+size_t findkey_db_serialize(const struct findkey_db* db,
+                            uint8_t* out,
+                            size_t capacity,
+                            int* out_status);
+
+// FINDKEY_ERR_BAD_ARGS for anything findkey_db_serialize did not write
+struct findkey_db* findkey_db_deserialize(const uint8_t* bytes,
+                                          size_t len,
+                                          int* out_status);
+
+/*
+    findkey_db_deserialize without copying the tries and the suffix table,
+    the matchers read them from bytes
+    - bytes must be 8-byte aligned and stay unchanged until findkey_db_free,
+      as a read-only mmap of a findkey_db_serialize file is, processes
+      mapping the same file share one copy
+    - the trie is only bounds checked as a whole, map trusted files only
+*/
+struct findkey_db* findkey_db_map(const uint8_t* bytes,
+                                  size_t len,
+                                  int* out_status);
+
+/*
+    Results packed to store or send them, readable on any machine
+    - positions as zigzag varint deltas from the previous result, so any
+      order is kept, key ids as varints; a few bytes a result when the
+      results are close together
+    - returns the size of the block, written to out only if it fits in
+      capacity, so NULL and 0 query the size
+*/
+size_t findkey_results_encode(const struct findkey_result* results,
+                              size_t num_results,
+                              uint8_t* out,
+                              size_t capacity,
+                              int* out_status);
+
+/*
+    Returns the number of results in the block, the first max_out_positions
+    are written to out_results
+    - FINDKEY_ERR_BAD_ARGS for anything findkey_results_encode did not write
+*/
+size_t findkey_results_decode(const uint8_t* bytes,
+                              size_t len,
+                              struct findkey_result* out_results,
+                              size_t max_out_positions,
+                              int* out_status);
+
+/*
+    Process wide LRU cache of what findkey and findkey_with_stats compile for
+    Teddy, keyed by the keys and the config, off until given a capacity
+    - capacity 0 turns it off, a smaller capacity evicts the least recently
+      used entries
+    - configs tuned on the input are compiled every time: TEDDY_COMPILE_AUTO,
+      and TEDDY_GROUPING_SCORE_FREQUENCY or TEDDY_SUFFIX_WINDOW without a
+      byte_histogram
+    - safe to call from any thread, like findkey itself
+*/
+void findkey_set_compile_cache_capacity(size_t capacity);
+
+void findkey_get_compile_cache_stats(
+    struct findkey_compile_cache_stats* out_stats);
+
+// drops every entry and zeroes the counters, the capacity is kept
+void findkey_reset_compile_cache(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,12 @@ namespace {
         "match\n"
         "  --collect-stats            Print Teddy baseline false-positive "
         "stats\n"
+        "  --count                    Print the matches of each key, "
+        "counted without storing positions\n"
+        "  --save-db <db_file>        Compile the Teddy database, write it "
+        "and match with it\n"
+        "  --db <db_file>             Match with a database written by "
+        "--save-db instead of compiling\n"
         "\n"
         "Teddy options:\n"
         "  --teddy-grouping-strategy <name>\n"
@@ -33,22 +39,42 @@ namespace {
         "greedy_min_delta, "
         "hash_std, hash_adler32, hash_crc32, hash_xxhash, hash_fnv1a, "
         "sorted_suffix_round_robin, sorted_suffix_partition, "
-        "sorted_suffix_optimal_partition\n"
+        "sorted_suffix_optimal_partition, branch_and_bound, "
+        "nibble_clustering, auto\n"
         "                             Default: greedy_paper_policy\n"
         "  --teddy-grouping-score <name>\n"
         "                             Values: paper, paper_nibble, "
-        "nibble_count\n"
+        "nibble_count, frequency\n"
         "                             Default: paper\n"
         "  --teddy-suffix-mode <name>\n"
-        "                             Values: raw, quote-suffix\n"
+        "                             Values: raw, quote-suffix, window, "
+        "prefix, auto\n"
         "                             Default: raw\n"
         "  --sigma <n>                Suffix length for teddy keys grouping\n"
         "                             Range: 1..4\n"
         "                             Default: 3\n"
+        "  --teddy-verifier <name>    Candidate verification structure\n"
+        "                             Values: dfa, suffix_table, top_trie, "
+        "pipelined, swar\n"
+        "                             Default: dfa\n"
+        "  --teddy-scan-mode <name>   Switch to a tokenizer on dense regions, "
+        "at the next key\n"
+        "                             Values: fixed, adaptive\n"
+        "                             Default: fixed\n"
+        "  --teddy-refine-passes <n>  Move/swap local search passes after "
+        "grouping\n"
+        "                             Default: 0 (off)\n"
+        "  --teddy-refine-time-ms <n> Time limit of the local search\n"
+        "                             Default: 0 (none)\n"
         "\n"
         "Notes:\n"
-        "  - --collect-stats always uses the Teddy baseline matcher\n"
-        "  - Teddy options are ignored when --algo scalar is selected\n";
+        "  - --collect-stats uses the Teddy baseline matcher, or the SIMD "
+        "matcher with --teddy-scan-mode adaptive\n"
+        "  - Teddy options are ignored when --algo scalar is selected\n"
+        "  - --save-db and --db need --algo teddy, the Teddy options of --db "
+        "are the ones it was saved with\n"
+        "  - auto tries every grouping strategy, score and sigma on a sample "
+        "of the data and prints the one it picks\n";
 
     std::fprintf(stderr, usage_message, prog_name);
     std::exit(EXIT_FAILURE);
@@ -63,10 +89,17 @@ ParsedCliArgs parse_cli_args_or_exit(int argc, char** argv) {
         {"teddy-grouping-score", required_argument, nullptr, 'q'},
         {"teddy-suffix-mode", required_argument, nullptr, 's'},
         {"sigma", required_argument, nullptr, 'm'},
+        {"teddy-verifier", required_argument, nullptr, 'v'},
+        {"teddy-scan-mode", required_argument, nullptr, 'w'},
+        {"teddy-refine-passes", required_argument, nullptr, 'f'},
+        {"teddy-refine-time-ms", required_argument, nullptr, 't'},
         {"keys", required_argument, nullptr, 'k'},
         {"data", required_argument, nullptr, 'd'},
         {"collect-stats", no_argument, nullptr, 'c'},
         {"print-positions", no_argument, nullptr, 'p'},
+        {"count", no_argument, nullptr, 'n'},
+        {"save-db", required_argument, nullptr, 'o'},
+        {"db", required_argument, nullptr, 'b'},
         {nullptr, 0, nullptr, 0},
     };
 
@@ -132,6 +165,43 @@ ParsedCliArgs parse_cli_args_or_exit(int argc, char** argv) {
                 args.teddy_config.sigma = *parsed;
                 break;
             }
+            case 'v': {
+                const auto parsed = findkey_options::parse_verifier(optarg);
+                if (!parsed) {
+                    std::fprintf(stderr, "Unknown teddy verifier specified\n");
+                    print_usage_and_exit(argv[0]);
+                }
+                args.teddy_config.verifier = *parsed;
+                break;
+            }
+            case 'w': {
+                const auto parsed = findkey_options::parse_scan_mode(optarg);
+                if (!parsed) {
+                    std::fprintf(stderr, "Unknown teddy scan mode specified\n");
+                    print_usage_and_exit(argv[0]);
+                }
+                args.teddy_config.scan_mode = *parsed;
+                break;
+            }
+            case 'f': {
+                const auto parsed = findkey_options::parse_uint32(optarg);
+                if (!parsed) {
+                    std::fprintf(stderr, "Invalid refine passes specified\n");
+                    print_usage_and_exit(argv[0]);
+                }
+                args.teddy_config.grouping.refine_max_passes = *parsed;
+                break;
+            }
+            case 't': {
+                const auto parsed = findkey_options::parse_uint32(optarg);
+                if (!parsed) {
+                    std::fprintf(stderr,
+                                 "Invalid refine time limit specified\n");
+                    print_usage_and_exit(argv[0]);
+                }
+                args.teddy_config.grouping.refine_time_limit_ms = *parsed;
+                break;
+            }
             case 'k':
                 args.keys_path = optarg;
                 break;
@@ -144,6 +214,15 @@ ParsedCliArgs parse_cli_args_or_exit(int argc, char** argv) {
             case 'p':
                 args.print_positions = true;
                 break;
+            case 'n':
+                args.count = true;
+                break;
+            case 'o':
+                args.save_db_path = optarg;
+                break;
+            case 'b':
+                args.db_path = optarg;
+                break;
             default:
                 print_usage_and_exit(argv[0]);
         }
@@ -157,5 +236,21 @@ ParsedCliArgs parse_cli_args_or_exit(int argc, char** argv) {
         print_usage_and_exit(argv[0]);
     }
 
+    if ((args.save_db_path || args.db_path) &&
+        (args.algo != TEDDY || args.collect_stats ||
+         (args.save_db_path && args.db_path))) {
+        std::fprintf(stderr,
+                     "--save-db and --db need --algo teddy, without "
+                     "--collect-stats or each other\n");
+        print_usage_and_exit(argv[0]);
+    }
+
+    if (args.count && (args.collect_stats || args.print_positions)) {
+        std::fprintf(stderr,
+                     "--count goes without --collect-stats and "
+                     "--print-positions\n");
+        print_usage_and_exit(argv[0]);
+    }
+
     return args;
 }
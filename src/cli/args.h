@@ -9,6 +9,11 @@ struct ParsedCliArgs {
     const char* data_path = nullptr;
     bool collect_stats = false;
     bool print_positions = false;
+    // per key counts through findkey_count, no positions
+    bool count = false;
+    // TEDDY only, at most one of them
+    const char* save_db_path = nullptr;
+    const char* db_path = nullptr;
 };
 
 ParsedCliArgs parse_cli_args_or_exit(int argc, char** argv);
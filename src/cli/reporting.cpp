@@ -1,4 +1,5 @@
 #include "cli/reporting.h"
+#include "core/findkey_options.h"
 
 #include <cstdio>
 
@@ -11,6 +12,19 @@ void print_compilation_stats(const teddy::CompilationMetadata& teddy_metadata,
     std::printf("\tMax key length: %zu\n", dfa_metadata.max_key_len);
 }
 
+void print_selected_teddy_config(const findkey_teddy_config& config) {
+    const auto strategy =
+        findkey_options::grouping_strategy_name(config.grouping.strategy);
+    const auto score =
+        findkey_options::grouping_score_name(config.grouping.score);
+    std::printf("Selected Teddy config:\n");
+    std::printf("\tGrouping strategy: %.*s\n",
+                static_cast<int>(strategy.size()), strategy.data());
+    std::printf("\tGrouping score: %.*s\n", static_cast<int>(score.size()),
+                score.data());
+    std::printf("\tSigma: %d\n", config.sigma);
+}
+
 void print_teddy_runtime_stats(const findkey_teddy_stats& teddy_stats,
                                size_t data_len) {
     const size_t scan_positions = data_len;
@@ -60,6 +74,10 @@ void print_teddy_runtime_stats(const findkey_teddy_stats& teddy_stats,
     std::printf("\tReject key not found: %lu\n",
                 teddy_stats.reject_key_not_found);
     std::printf("\tExact matches: %lu\n", teddy_stats.exact_matches);
+    std::printf("\tSwitches to tokenizer: %lu\n",
+                teddy_stats.switches_to_tokenizer);
+    std::printf("\tSwitches to teddy: %lu\n", teddy_stats.switches_to_teddy);
+    std::printf("\tTokenizer bytes: %lu\n", teddy_stats.tokenizer_bytes);
     std::printf("\tHit lane ratio: %.6f\n", hit_lane_ratio);
     std::printf("\tAvg hit groups per lane: %.6f\n", avg_hit_groups);
     std::printf("\tExact matches per hit lane: %.6f\n", exact_match_ratio);
@@ -9,5 +9,8 @@
 void print_compilation_stats(const teddy::CompilationMetadata& teddy_metadata,
                              const DFACompilationMetadata& dfa_metadata);
 
+// the config TEDDY_COMPILE_AUTO resolved to
+void print_selected_teddy_config(const findkey_teddy_config& config);
+
 void print_teddy_runtime_stats(const findkey_teddy_stats& teddy_stats,
                                size_t data_len);
@@ -0,0 +1,117 @@
+#include "core/compile_cache.h"
+
+#include <utility>
+
+namespace {
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// every key with its length, then every config field but the histogram
+// pointer, then the histogram itself
+std::string cache_key(const std::vector<std::string_view>& keys,
+                      const findkey_teddy_config& config) {
+    std::string key;
+    for (const std::string_view bytes : keys) {
+        append(key, static_cast<uint64_t>(bytes.size()));
+        key.append(bytes);
+    }
+    append(key, config.grouping.strategy);
+    append(key, config.grouping.score);
+    append(key, config.grouping.refine_max_passes);
+    append(key, config.grouping.refine_time_limit_ms);
+    append(key, config.suffix_mode);
+    append(key, config.sigma);
+    append(key, config.verifier);
+    append(key, config.scan_mode);
+    if (config.grouping.byte_histogram) {
+        append(key, *config.grouping.byte_histogram);
+    }
+    return key;
+}
+
+}  // namespace
+
+bool CompileCache::cacheable(const findkey_teddy_config& config) noexcept {
+    if (config.grouping.strategy == TEDDY_COMPILE_AUTO) {
+        return false;
+    }
+    return config.grouping.byte_histogram ||
+           (config.grouping.score != TEDDY_GROUPING_SCORE_FREQUENCY &&
+            config.suffix_mode != TEDDY_SUFFIX_WINDOW);
+}
+
+std::shared_ptr<const findkey_db> CompileCache::find_or_compile(
+    const std::vector<std::string_view>& keys,
+    const findkey_teddy_config& config,
+    const Compile& compile) {
+    bool enabled = false;
+    {
+        const std::lock_guard lock(mutex_);
+        enabled = capacity_ != 0;
+    }
+    if (!enabled || !cacheable(config)) {
+        return std::make_shared<const findkey_db>(compile());
+    }
+
+    std::string key = cache_key(keys, config);
+    {
+        const std::lock_guard lock(mutex_);
+        if (const auto it = index_.find(key); it != index_.end()) {
+            ++stats_.hits;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->second;
+        }
+        ++stats_.misses;
+    }
+
+    auto db = std::make_shared<const findkey_db>(compile());
+
+    const std::lock_guard lock(mutex_);
+    if (const auto it = index_.find(key); it != index_.end()) {
+        return it->second->second;
+    }
+    if (capacity_ == 0) {
+        return db;
+    }
+    entries_.emplace_front(std::move(key), db);
+    index_.emplace(entries_.front().first, entries_.begin());
+    evict_to(capacity_);
+    return db;
+}
+
+void CompileCache::set_capacity(size_t capacity) {
+    const std::lock_guard lock(mutex_);
+    capacity_ = capacity;
+    evict_to(capacity_);
+}
+
+void CompileCache::reset() {
+    const std::lock_guard lock(mutex_);
+    index_.clear();
+    entries_.clear();
+    stats_ = {};
+}
+
+findkey_compile_cache_stats CompileCache::stats() const {
+    const std::lock_guard lock(mutex_);
+    findkey_compile_cache_stats stats = stats_;
+    stats.entries = entries_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void CompileCache::evict_to(size_t capacity) {
+    while (entries_.size() > capacity) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+CompileCache& compile_cache() {
+    static CompileCache cache;
+    return cache;
+}
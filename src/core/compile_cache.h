@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/database.h"
+#include "findkey.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+    LRU cache of compiled databases, keyed by the key bytes and the config
+    - find_or_compile compiles outside the lock, threads missing the same
+      entry at once both compile and the first insert wins
+    - entries are shared, an evicted one lives until its last user is done
+*/
+class CompileCache {
+   public:
+    using Compile = std::function<findkey_db()>;
+
+    // false when compiling reads the input
+    static bool cacheable(const findkey_teddy_config& config) noexcept;
+
+    // compile() straight away when the cache is off or config not cacheable
+    std::shared_ptr<const findkey_db> find_or_compile(
+        const std::vector<std::string_view>& keys,
+        const findkey_teddy_config& config,
+        const Compile& compile);
+
+    void set_capacity(size_t capacity);
+    void reset();
+    [[nodiscard]] findkey_compile_cache_stats stats() const;
+
+   private:
+    using Entry = std::pair<std::string, std::shared_ptr<const findkey_db>>;
+
+    void evict_to(size_t capacity);
+
+    mutable std::mutex mutex_;
+    size_t capacity_ = 0;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    findkey_compile_cache_stats stats_{};
+};
+
+// the process wide cache behind findkey and findkey_with_stats
+CompileCache& compile_cache();
@@ -0,0 +1,441 @@
+#include "core/database.h"
+
+#include "core/findkey_error.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct DatabaseHeader {
+    char magic[sizeof(DATABASE_MAGIC)];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t reserved;
+    uint64_t total_size;
+};
+
+constexpr size_t padded(size_t size) noexcept {
+    return (size + DATABASE_ALIGNMENT - 1) & ~(DATABASE_ALIGNMENT - 1);
+}
+
+[[noreturn]] void bad_database(const char* message) {
+    throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT, message);
+}
+
+class ByteWriter {
+   public:
+    template <typename T>
+    void value(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void array(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        value(static_cast<uint64_t>(values.size()));
+        bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    void array(const std::vector<T>& values) {
+        array(std::span<const T>(values));
+    }
+
+    template <typename T>
+    void array(const FlatArray<T>& values) {
+        array(values.span());
+    }
+
+    // fills in the size of the whole database, the header comes first
+    std::vector<uint8_t> finish() && {
+        const uint64_t total = out_.size();
+        std::memcpy(out_.data() + offsetof(DatabaseHeader, total_size), &total,
+                    sizeof(total));
+        return std::move(out_);
+    }
+
+   private:
+    void bytes(const void* data, size_t size) {
+        const size_t begin = out_.size();
+        out_.resize(begin + padded(size), 0);
+        if (size != 0) {
+            std::memcpy(out_.data() + begin, data, size);
+        }
+    }
+
+    std::vector<uint8_t> out_;
+};
+
+// borrowing readers hand out FlatArrays pointing into the input
+class ByteReader {
+   public:
+    ByteReader(std::span<const uint8_t> in, bool borrow)
+        : in_(in), borrow_(borrow) {}
+
+    template <typename T>
+    T value() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T result;
+        value_into(result);
+        return result;
+    }
+
+    template <typename T>
+    void value_into(T& out) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::memcpy(&out, take(sizeof(T)), sizeof(T));
+    }
+
+    template <typename T>
+    std::vector<T> array() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto count = value<uint64_t>();
+        if (count > remaining() / sizeof(T)) {
+            bad_database("Truncated findkey database section");
+        }
+        std::vector<T> result(count);
+        if (count != 0) {
+            std::memcpy(result.data(), take(count * sizeof(T)),
+                        count * sizeof(T));
+        }
+        return result;
+    }
+
+    template <typename T>
+    FlatArray<T> flat_array() {
+        static_assert(alignof(T) <= DATABASE_ALIGNMENT);
+        if (!borrow_) {
+            return array<T>();
+        }
+        const auto count = value<uint64_t>();
+        if (count > remaining() / sizeof(T)) {
+            bad_database("Truncated findkey database section");
+        }
+        const auto* begin = reinterpret_cast<const T*>(take(count * sizeof(T)));
+        return FlatArray<T>::borrow(std::span(begin, count));
+    }
+
+    [[nodiscard]] bool borrowing() const noexcept { return borrow_; }
+
+    [[nodiscard]] size_t remaining() const noexcept {
+        return in_.size() - position_;
+    }
+
+   private:
+    const uint8_t* take(size_t size) {
+        if (padded(size) > remaining()) {
+            bad_database("Truncated findkey database section");
+        }
+        const uint8_t* begin = in_.data() + position_;
+        position_ += padded(size);
+        return begin;
+    }
+
+    std::span<const uint8_t> in_;
+    size_t position_ = 0;
+    bool borrow_;
+};
+
+void write_config(ByteWriter& writer, const findkey_teddy_config& config) {
+    // the histogram pointer is dropped, it only matters while compiling
+    writer.value<uint32_t>(config.grouping.strategy);
+    writer.value<uint32_t>(config.grouping.score);
+    writer.value<uint32_t>(config.grouping.refine_max_passes);
+    writer.value<uint32_t>(config.grouping.refine_time_limit_ms);
+    writer.value<uint32_t>(config.suffix_mode);
+    writer.value<int32_t>(config.sigma);
+    writer.value<uint32_t>(config.verifier);
+    writer.value<uint32_t>(config.scan_mode);
+}
+
+template <typename Enum>
+Enum read_enum(ByteReader& reader, int count) {
+    const auto value = reader.value<uint32_t>();
+    if (value >= static_cast<uint32_t>(count)) {
+        bad_database("Unknown enum value in findkey database");
+    }
+    return static_cast<Enum>(value);
+}
+
+findkey_teddy_config read_config(ByteReader& reader) {
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    config.grouping.strategy =
+        read_enum<findkey_teddy_compile_grouping_strategy>(
+            reader, FINDKEY_TEDDY_COMPILE_GROUPING_STRATEGY_COUNT);
+    config.grouping.score = read_enum<findkey_teddy_grouping_score>(
+        reader, FINDKEY_TEDDY_GROUPING_SCORE_COUNT);
+    config.grouping.refine_max_passes = reader.value<uint32_t>();
+    config.grouping.refine_time_limit_ms = reader.value<uint32_t>();
+    config.suffix_mode = read_enum<findkey_teddy_suffix_mode>(
+        reader, FINDKEY_TEDDY_SUFFIX_MODE_COUNT);
+    config.sigma = reader.value<int32_t>();
+    config.verifier = read_enum<findkey_teddy_verifier>(
+        reader, FINDKEY_TEDDY_VERIFIER_COUNT);
+    config.scan_mode = read_enum<findkey_teddy_scan_mode>(
+        reader, FINDKEY_TEDDY_SCAN_MODE_COUNT);
+    return config;
+}
+
+void write_dfa(ByteWriter& writer, const DFA& dfa) {
+    writer.array(dfa.nodes);
+    writer.value<uint64_t>(dfa.max_key_len);
+    writer.array(dfa.top_nodes);
+    writer.value(dfa.short_keys.bucket_offsets);
+    writer.array(dfa.short_keys.lo);
+    writer.array(dfa.short_keys.hi);
+    writer.array(dfa.short_keys.key_ids);
+}
+
+bool valid_node(int32_t node, size_t num_nodes) noexcept {
+    return node >= -1 && node < static_cast<int64_t>(num_nodes);
+}
+
+void check_trie(const DFA& dfa, size_t num_keys) {
+    const size_t num_nodes = dfa.nodes.size();
+    for (const TrieNode& node : dfa.nodes) {
+        if (!std::all_of(node.children.begin(), node.children.end(),
+                         [&](int32_t child) {
+                             return valid_node(child, num_nodes);
+                         }) ||
+            node.key_id < -1 || node.key_id >= static_cast<int64_t>(num_keys)) {
+            bad_database("Trie node out of range in findkey database");
+        }
+    }
+    if (!std::all_of(dfa.top_nodes.begin(), dfa.top_nodes.end(),
+                     [&](int32_t node) {
+                         return valid_node(node, num_nodes);
+                     })) {
+        bad_database("Top trie out of range in findkey database");
+    }
+}
+
+DFA read_dfa(ByteReader& reader, size_t num_keys) {
+    DFA dfa;
+    dfa.nodes = reader.flat_array<TrieNode>();
+    dfa.max_key_len = reader.value<uint64_t>();
+    dfa.top_nodes = reader.flat_array<int32_t>();
+    dfa.short_keys.bucket_offsets =
+        reader.value<decltype(dfa.short_keys.bucket_offsets)>();
+    dfa.short_keys.lo = reader.flat_array<uint64_t>();
+    dfa.short_keys.hi = reader.flat_array<uint64_t>();
+    dfa.short_keys.key_ids = reader.flat_array<uint32_t>();
+
+    if (!dfa.top_nodes.empty() && dfa.top_nodes.size() != TOP_TRIE_ENTRIES) {
+        bad_database("Top trie out of range in findkey database");
+    }
+    // a mapped trie is trusted, scanning it would touch every page
+    if (!reader.borrowing()) {
+        check_trie(dfa, num_keys);
+    }
+
+    const ShortKeyTable& short_keys = dfa.short_keys;
+    const size_t num_short_keys = short_keys.key_ids.size();
+    if (short_keys.lo.size() != num_short_keys ||
+        short_keys.hi.size() != num_short_keys ||
+        !std::is_sorted(short_keys.bucket_offsets.begin(),
+                        short_keys.bucket_offsets.end()) ||
+        short_keys.bucket_offsets.back() != num_short_keys ||
+        !std::all_of(short_keys.key_ids.begin(), short_keys.key_ids.end(),
+                     [&](uint32_t key_id) { return key_id < num_keys; })) {
+        bad_database("Short key table out of range in findkey database");
+    }
+    return dfa;
+}
+
+void write_suffix_table(ByteWriter& writer, const teddy::SuffixTable& table) {
+    writer.array(table.slot_suffixes);
+    writer.array(table.slot_suffix_ids);
+    writer.value<uint64_t>(table.slot_mask);
+    writer.array(table.candidate_offsets);
+    writer.array(table.candidates);
+    writer.array(table.key_bytes);
+    writer.array(table.suffix_groups);
+}
+
+teddy::SuffixTable read_suffix_table(ByteReader& reader,
+                                     size_t num_suffixes,
+                                     size_t num_keys) {
+    teddy::SuffixTable table;
+    table.slot_suffixes = reader.flat_array<uint64_t>();
+    table.slot_suffix_ids = reader.flat_array<uint32_t>();
+    table.slot_mask = reader.value<uint64_t>();
+    table.candidate_offsets = reader.flat_array<uint32_t>();
+    table.candidates = reader.flat_array<teddy::SuffixTableCandidate>();
+    table.key_bytes = reader.flat_array<char>();
+    table.suffix_groups = reader.flat_array<uint8_t>();
+    if (table.empty()) {
+        return table;
+    }
+
+    // find_suffix_id probes until it meets an empty slot
+    const size_t num_slots = table.slot_suffixes.size();
+    if ((num_slots & (num_slots - 1)) != 0 ||
+        table.slot_mask != num_slots - 1 ||
+        table.slot_suffix_ids.size() != num_slots ||
+        std::find(table.slot_suffixes.begin(), table.slot_suffixes.end(),
+                  teddy::SuffixTable::EMPTY_SLOT) ==
+            table.slot_suffixes.end() ||
+        table.candidate_offsets.size() != num_suffixes + 1 ||
+        table.suffix_groups.size() != num_suffixes ||
+        !std::is_sorted(table.candidate_offsets.begin(),
+                        table.candidate_offsets.end()) ||
+        table.candidate_offsets.back() != table.candidates.size()) {
+        bad_database("Suffix table out of range in findkey database");
+    }
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        if (table.slot_suffixes[slot] != teddy::SuffixTable::EMPTY_SLOT &&
+            table.slot_suffix_ids[slot] >= num_suffixes) {
+            bad_database("Suffix table out of range in findkey database");
+        }
+    }
+    for (const teddy::SuffixTableCandidate& candidate : table.candidates) {
+        if (candidate.key_id >= num_keys ||
+            candidate.key_offset > table.key_bytes.size() ||
+            candidate.key_len > table.key_bytes.size() - candidate.key_offset) {
+            bad_database("Suffix table out of range in findkey database");
+        }
+    }
+    return table;
+}
+
+void write_teddy(ByteWriter& writer, const teddy::CompilationData& data) {
+    writer.value<int32_t>(data.sigma);
+    writer.value<int32_t>(data.num_groups);
+    writer.value<uint64_t>(data.end_quote_offset);
+    writer.value(data.low_table);
+    writer.value(data.high_table);
+    writer.array(data.suffixes);
+    writer.value<uint64_t>(data.group_suffix_ids.size());
+    for (const std::vector<uint32_t>& group : data.group_suffix_ids) {
+        writer.array(group);
+    }
+    writer.value<uint32_t>(data.verifier);
+    writer.array(data.key_window_offsets);
+    writer.value(data.group_window_offsets);
+    writer.value(data.window_offsets);
+    write_suffix_table(writer, data.suffix_table);
+    writer.value<uint8_t>(data.prefix);
+    write_dfa(writer, data.forward_dfa);
+}
+
+teddy::CompilationData read_teddy(ByteReader& reader, size_t num_keys) {
+    teddy::CompilationData data;
+    data.sigma = reader.value<int32_t>();
+    data.num_groups = reader.value<int32_t>();
+    data.end_quote_offset = reader.value<uint64_t>();
+    reader.value_into(data.low_table);
+    reader.value_into(data.high_table);
+    data.suffixes = reader.array<teddy::Suffix>();
+    const auto num_groups = reader.value<uint64_t>();
+    if (data.sigma < 1 || data.sigma > FINDKEY_TEDDY_MAX_SIGMA ||
+        data.num_groups < 1 || data.num_groups > teddy::MAX_GROUPS ||
+        num_groups != static_cast<uint64_t>(data.num_groups) ||
+        data.end_quote_offset > 1) {
+        bad_database("Bad Teddy layout in findkey database");
+    }
+    data.group_suffix_ids.resize(num_groups);
+    for (std::vector<uint32_t>& group : data.group_suffix_ids) {
+        group = reader.array<uint32_t>();
+        if (!std::all_of(group.begin(), group.end(), [&](uint32_t id) {
+                return id < data.suffixes.size();
+            })) {
+            bad_database("Suffix id out of range in findkey database");
+        }
+    }
+    data.verifier = read_enum<findkey_teddy_verifier>(
+        reader, FINDKEY_TEDDY_VERIFIER_COUNT);
+    data.key_window_offsets = reader.array<uint8_t>();
+    reader.value_into(data.group_window_offsets);
+    reader.value_into(data.window_offsets);
+    data.suffix_table =
+        read_suffix_table(reader, data.suffixes.size(), num_keys);
+    data.prefix = reader.value<uint8_t>() != 0;
+    data.forward_dfa = read_dfa(reader, num_keys);
+    if (!data.key_window_offsets.empty() &&
+        data.key_window_offsets.size() != num_keys) {
+        bad_database("Window offsets out of range in findkey database");
+    }
+    if (data.prefix ? data.forward_dfa.nodes.empty()
+                    : data.verifier == TEDDY_VERIFY_SUFFIX_TABLE &&
+                          data.suffix_table.empty()) {
+        bad_database("Missing verifier in findkey database");
+    }
+    return data;
+}
+
+findkey_db read_database(std::span<const uint8_t> bytes, bool borrow) {
+    ByteReader reader(bytes, borrow);
+    const auto header = reader.value<DatabaseHeader>();
+    if (std::memcmp(header.magic, DATABASE_MAGIC, sizeof(header.magic)) != 0) {
+        bad_database("Not a findkey database");
+    }
+    if (header.version != DATABASE_VERSION) {
+        bad_database("Unsupported findkey database version");
+    }
+    if (header.byte_order_mark != BYTE_ORDER_MARK) {
+        bad_database("findkey database written with another byte order");
+    }
+    if (header.total_size != bytes.size()) {
+        bad_database("findkey database size does not match its header");
+    }
+
+    findkey_db db;
+    db.config = read_config(reader);
+    // every key takes its 8-byte length at least
+    const auto num_stored_keys = reader.value<uint64_t>();
+    if (num_stored_keys > reader.remaining() / sizeof(uint64_t)) {
+        bad_database("Truncated findkey database section");
+    }
+    db.keys.resize(num_stored_keys);
+    for (std::string& key : db.keys) {
+        const std::vector<char> key_bytes = reader.array<char>();
+        key.assign(key_bytes.begin(), key_bytes.end());
+    }
+    db.grouped_pass_rate = reader.value<double>();
+    const size_t num_keys = db.keys.size();
+    db.data = read_teddy(reader, num_keys);
+    db.dfa = read_dfa(reader, num_keys);
+    if (num_keys == 0 || db.dfa.nodes.empty() || reader.remaining() != 0) {
+        bad_database("Bad findkey database layout");
+    }
+    return db;
+}
+
+}  // namespace
+
+std::vector<uint8_t> serialize_database(const findkey_db& db) {
+    DatabaseHeader header{};
+    std::memcpy(header.magic, DATABASE_MAGIC, sizeof(header.magic));
+    header.version = DATABASE_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+
+    ByteWriter writer;
+    writer.value(header);
+    write_config(writer, db.config);
+    writer.value<uint64_t>(db.keys.size());
+    for (const std::string& key : db.keys) {
+        writer.array(std::span<const char>(key));
+    }
+    writer.value(db.grouped_pass_rate);
+    write_teddy(writer, db.data);
+    write_dfa(writer, db.dfa);
+    return std::move(writer).finish();
+}
+
+findkey_db deserialize_database(std::span<const uint8_t> bytes) {
+    return read_database(bytes, false);
+}
+
+findkey_db map_database(std::span<const uint8_t> bytes) {
+    if (reinterpret_cast<uintptr_t>(bytes.data()) % DATABASE_ALIGNMENT != 0) {
+        bad_database("Mapped findkey database is not 8-byte aligned");
+    }
+    return read_database(bytes, true);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/key_dfa.h"
+#include "findkey.h"
+#include "teddy/compile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// everything a Teddy match needs besides the input, see findkey_db_compile
+struct findkey_db {
+    // TEDDY_COMPILE_AUTO resolved, byte_histogram always NULL
+    findkey_teddy_config config;
+    // by key id, empty once removed, see findkey_db_remove_key
+    std::vector<std::string> keys;
+    // teddy::estimated_pass_rate of the last full grouping
+    double grouped_pass_rate = 0;
+
+    teddy::CompilationData data;
+    DFA dfa;
+};
+
+inline constexpr char DATABASE_MAGIC[4] = {'F', 'K', 'D', 'B'};
+inline constexpr uint32_t DATABASE_VERSION = 2;
+// of every section, so a mapped database can be read in place
+inline constexpr size_t DATABASE_ALIGNMENT = 8;
+
+/*
+    Header, then one section per field of findkey_db in declaration order
+    - integers in host byte order, the header carries a byte order mark and
+      the version, a database is only loaded where it was written
+    - every array is a 64-bit element count followed by its raw elements,
+      padded to DATABASE_ALIGNMENT, no pointers, so the image can be used
+      wherever it is loaded
+*/
+std::vector<uint8_t> serialize_database(const findkey_db& db);
+
+// checks the header, that every section fits and that every index stays in
+// range, throws FindkeyError INVALID_ARGUMENT otherwise, copies every array
+findkey_db deserialize_database(std::span<const uint8_t> bytes);
+
+/*
+    Same checks without copying: the tries and the suffix table borrow bytes,
+    which must outlive the result and be DATABASE_ALIGNMENT aligned
+    - trie nodes are only bounds checked as a whole, scanning them would
+      touch every page of a mapped file
+*/
+findkey_db map_database(std::span<const uint8_t> bytes);
@@ -0,0 +1,299 @@
+#include "core/database_update.h"
+
+#include "core/findkey_error.h"
+#include "teddy/suffix_table.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// the mode prepare_suffixes read the suffixes of db under
+findkey_teddy_suffix_mode suffix_mode(const teddy::CompilationData& data) {
+    if (data.prefix) {
+        return TEDDY_SUFFIX_PREFIX;
+    }
+    return data.end_quote_offset == 0 ? TEDDY_SUFFIX_QUOTED : TEDDY_SUFFIX_RAW;
+}
+
+uint8_t key_offset(const teddy::CompilationData& data, uint32_t key_id) {
+    return data.key_window_offsets.empty() ? 0
+                                           : data.key_window_offsets[key_id];
+}
+
+std::optional<teddy::Suffix> database_key_suffix(const findkey_db& db,
+                                                 uint32_t key_id) {
+    return teddy::key_suffix(db.keys[key_id], db.data.sigma,
+                             suffix_mode(db.data), key_offset(db.data, key_id));
+}
+
+bool same_suffix(const teddy::Suffix& a, const teddy::Suffix& b, int sigma) {
+    return std::equal(a.begin(), a.begin() + sigma, b.begin());
+}
+
+uint32_t find_suffix(const teddy::CompilationData& data,
+                     const teddy::Suffix& suffix) {
+    for (uint32_t suffix_id = 0; suffix_id < data.suffixes.size();
+         ++suffix_id) {
+        if (same_suffix(data.suffixes[suffix_id], suffix, data.sigma)) {
+            return suffix_id;
+        }
+    }
+    return teddy::NO_SUFFIX;
+}
+
+// -1 once the last key with the suffix is removed
+int suffix_group(const teddy::CompilationData& data, uint32_t suffix_id) {
+    for (int group = 0; group < data.num_groups; ++group) {
+        const std::vector<uint32_t>& ids = data.group_suffix_ids[group];
+        if (std::find(ids.begin(), ids.end(), suffix_id) != ids.end()) {
+            return group;
+        }
+    }
+    return -1;
+}
+
+// bit `group` of every table entry, from the suffixes of the group
+void fill_group_bits(teddy::CompilationData& data, int group) {
+    const auto mask = static_cast<uint8_t>(1u << group);
+    for (int i = 0; i < data.sigma; ++i) {
+        for (int nibble = 0; nibble < 16; ++nibble) {
+            data.low_table[i][nibble] |= mask;
+            data.high_table[i][nibble] |= mask;
+        }
+        for (uint32_t suffix_id : data.group_suffix_ids[group]) {
+            const uint8_t c = data.suffixes[suffix_id][i];
+            data.low_table[i][c & 0x0F] &= ~mask;
+            data.high_table[i][c >> 4] &= ~mask;
+        }
+    }
+}
+
+void rebuild_verifiers(findkey_db& db) {
+    const std::vector<std::string_view> keys(db.keys.begin(), db.keys.end());
+    if (db.config.verifier == TEDDY_VERIFY_SWAR) {
+        db.dfa.short_keys = build_short_key_table(keys);
+    }
+    if (db.data.prefix || db.data.verifier != TEDDY_VERIFY_SUFFIX_TABLE) {
+        return;
+    }
+
+    std::vector<uint32_t> key_suffix_ids(keys.size(), teddy::NO_SUFFIX);
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        if (keys[key_id].empty()) {
+            continue;
+        }
+        if (const std::optional<teddy::Suffix> suffix =
+                database_key_suffix(db, key_id)) {
+            key_suffix_ids[key_id] = find_suffix(db.data, *suffix);
+        }
+    }
+    db.data.suffix_table =
+        teddy::build_suffix_table(keys, key_suffix_ids, db.data.suffixes,
+                                  db.data.group_suffix_ids, db.data.sigma);
+}
+
+struct Placement {
+    int group = 0;
+    int offset = 0;
+    teddy::Suffix suffix{};
+    uint32_t suffix_id = teddy::NO_SUFFIX;
+    bool grouped = false;  // the suffix is in the group already
+    double cost = 0;       // growth of the estimated pass rate
+};
+
+/*
+    - a suffix already in some group stays there, at no cost
+    - otherwise every group, and a new one while there is room, is tried at
+      each window offset it is verified at, the smaller group wins ties
+*/
+std::optional<Placement> place_key(const teddy::CompilationData& data,
+                                   std::string_view key) {
+    const bool windowed = !data.key_window_offsets.empty();
+    const int num_groups = std::min(data.num_groups + 1, teddy::MAX_GROUPS);
+
+    std::optional<Placement> best;
+    for (int group = 0; group < num_groups; ++group) {
+        const uint8_t offsets = windowed && group < data.num_groups
+                                    ? data.group_window_offsets[group]
+                                    : 1;
+        for (uint8_t rest = offsets; rest != 0; rest &= rest - 1) {
+            Placement candidate;
+            candidate.group = group;
+            candidate.offset = __builtin_ctz(rest);
+            const std::optional<teddy::Suffix> suffix = teddy::key_suffix(
+                key, data.sigma, suffix_mode(data), candidate.offset);
+            if (!suffix) {
+                continue;
+            }
+            candidate.suffix = *suffix;
+            candidate.suffix_id = find_suffix(data, *suffix);
+
+            const int current_group =
+                candidate.suffix_id == teddy::NO_SUFFIX
+                    ? -1
+                    : suffix_group(data, candidate.suffix_id);
+            if (current_group != -1) {
+                if (current_group != group) {
+                    continue;
+                }
+                candidate.grouped = true;
+            } else if (group < data.num_groups) {
+                candidate.cost =
+                    teddy::group_pass_rate(data, group, &candidate.suffix) -
+                    teddy::group_pass_rate(data, group);
+            } else {
+                candidate.cost =
+                    teddy::group_pass_rate(data, group, &candidate.suffix);
+            }
+
+            if (!best || candidate.cost < best->cost) {
+                best = candidate;
+            }
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+uint32_t add_database_key(findkey_db& db, std::string_view key) {
+    if (key.empty()) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Teddy keys must not be empty");
+    }
+    if (db.keys.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Too many keys in findkey database");
+    }
+
+    const auto key_id = static_cast<uint32_t>(db.keys.size());
+    db.keys.emplace_back(key);
+    insert_key(db.dfa, key, key_id, false);
+    if (db.data.prefix) {
+        insert_key(db.data.forward_dfa, key, key_id, true);
+    }
+
+    // shorter than the suffixes
+    const std::optional<Placement> placement = place_key(db.data, key);
+    if (!placement) {
+        regroup_database(db);
+        return key_id;
+    }
+
+    teddy::CompilationData& data = db.data;
+    uint32_t suffix_id = placement->suffix_id;
+    if (suffix_id == teddy::NO_SUFFIX) {
+        suffix_id = static_cast<uint32_t>(data.suffixes.size());
+        data.suffixes.push_back(placement->suffix);
+    }
+    if (placement->group == data.num_groups) {
+        data.group_suffix_ids.emplace_back();
+        data.group_window_offsets[data.num_groups] = 1;
+        ++data.num_groups;
+    }
+    if (!placement->grouped) {
+        data.group_suffix_ids[placement->group].push_back(suffix_id);
+        fill_group_bits(data, placement->group);
+    }
+    if (!data.key_window_offsets.empty()) {
+        data.key_window_offsets.push_back(
+            static_cast<uint8_t>(placement->offset));
+        data.window_offsets |= data.group_window_offsets[placement->group];
+    }
+
+    if (teddy::estimated_pass_rate(data) >
+        db.grouped_pass_rate * (1 + MAX_PASS_RATE_DRIFT)) {
+        regroup_database(db);
+    } else {
+        rebuild_verifiers(db);
+    }
+    return key_id;
+}
+
+void remove_database_key(findkey_db& db, uint32_t key_id) {
+    if (key_id >= db.keys.size() || db.keys[key_id].empty()) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Unknown key id in findkey database");
+    }
+
+    const std::optional<teddy::Suffix> suffix =
+        database_key_suffix(db, key_id);
+    const std::string key = std::exchange(db.keys[key_id], {});
+
+    // a duplicate of the key takes over its trie entry
+    int32_t duplicate_id = -1;
+    for (uint32_t id = 0; id < db.keys.size(); ++id) {
+        if (db.keys[id] == key) {
+            duplicate_id = static_cast<int32_t>(id);
+            break;
+        }
+    }
+    relabel_key(db.dfa, key, duplicate_id, false);
+    if (db.data.prefix) {
+        relabel_key(db.data.forward_dfa, key, duplicate_id, true);
+    }
+
+    teddy::CompilationData& data = db.data;
+    const uint32_t suffix_id =
+        suffix ? find_suffix(data, *suffix) : teddy::NO_SUFFIX;
+    const int group =
+        suffix_id == teddy::NO_SUFFIX ? -1 : suffix_group(data, suffix_id);
+    if (group != -1) {
+        bool used = false;
+        for (uint32_t id = 0; id < db.keys.size() && !used; ++id) {
+            if (db.keys[id].empty()) {
+                continue;
+            }
+            const std::optional<teddy::Suffix> other =
+                database_key_suffix(db, id);
+            used = other && same_suffix(*other, *suffix, data.sigma);
+        }
+        if (!used) {
+            std::erase(data.group_suffix_ids[group], suffix_id);
+            fill_group_bits(data, group);
+        }
+    }
+
+    rebuild_verifiers(db);
+}
+
+void regroup_database(findkey_db& db) {
+    std::vector<std::string_view> live_keys;
+    std::vector<uint32_t> live_ids;
+    for (uint32_t key_id = 0; key_id < db.keys.size(); ++key_id) {
+        if (!db.keys[key_id].empty()) {
+            live_keys.push_back(db.keys[key_id]);
+            live_ids.push_back(key_id);
+        }
+    }
+    if (live_keys.empty()) {
+        return;
+    }
+
+    // the suffix table is built over every key id below, the forward trie
+    // is kept as updated
+    findkey_teddy_config config = db.config;
+    if (config.suffix_mode == TEDDY_SUFFIX_AUTO) {
+        config.suffix_mode = suffix_mode(db.data);
+    }
+    config.verifier = TEDDY_VERIFY_DFA;
+    teddy::CompilationData data = teddy::compile(live_keys, config);
+    data.verifier = db.config.verifier;
+    data.forward_dfa = std::move(db.data.forward_dfa);
+    if (!data.key_window_offsets.empty()) {
+        std::vector<uint8_t> key_window_offsets(db.keys.size(), 0);
+        for (size_t i = 0; i < live_ids.size(); ++i) {
+            key_window_offsets[live_ids[i]] = data.key_window_offsets[i];
+        }
+        data.key_window_offsets = std::move(key_window_offsets);
+    }
+
+    db.data = std::move(data);
+    db.grouped_pass_rate = teddy::estimated_pass_rate(db.data);
+    rebuild_verifiers(db);
+}
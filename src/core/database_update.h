@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core/database.h"
+
+#include <cstdint>
+#include <string_view>
+
+/*
+    Key set updates of a compiled findkey_db, see findkey_db_add_key
+    - key ids stay stable, a removed key leaves an empty entry in db.keys
+    - only the tables of the group that changed are patched, the suffix
+      table and the short key table are rebuilt when their verifier is used
+*/
+
+// regroup once teddy::estimated_pass_rate grows past the last full grouping
+// by this share
+inline constexpr double MAX_PASS_RATE_DRIFT = 0.5;
+
+// throws FindkeyError INVALID_ARGUMENT for an empty key
+uint32_t add_database_key(findkey_db& db, std::string_view key);
+
+// throws FindkeyError INVALID_ARGUMENT for unknown and removed ids
+void remove_database_key(findkey_db& db, uint32_t key_id);
+
+// groups the live keys from scratch, tuned on uniform bytes since db keeps
+// no input
+void regroup_database(findkey_db& db);
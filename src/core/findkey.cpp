@@ -1,27 +1,37 @@
 #include "findkey.h"
+#include "core/compile_cache.h"
+#include "core/database.h"
+#include "core/database_update.h"
 #include "core/findkey_error.h"
 #include "core/key_dfa.h"
+#include "core/query.h"
+#include "core/result_block.h"
+#include "core/teddy_auto.h"
 #include "matchers/matcher_scalar.h"
 #include "matchers/matcher_teddy_baseline.h"
+#include "matchers/result_sink.h"
+#include "teddy/byte_histogram.h"
 #include "teddy/compile.h"
 
 #if COMPILER_SUPPORTS_TEDDY
 #include "matchers/matcher_teddy.h"
+#include "matchers/matcher_teddy_adaptive.h"
 #endif
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <span>
 #include <string_view>
 #include <utility>
 #include <vector>
 
-static inline bool bad_args(const uint8_t* data,
-                            size_t len,
-                            const uint8_t* const* keys,
+static inline bool bad_keys(const uint8_t* const* keys,
                             const size_t* key_lens,
-                            size_t num_keys,
-                            struct findkey_result* out_results) {
-    if (!data || len == 0 || !keys || !key_lens || !out_results || !num_keys) {
+                            size_t num_keys) {
+    if (!keys || !key_lens || !num_keys) {
         return true;
     }
     for (size_t i = 0; i < num_keys; ++i) {
@@ -35,24 +45,30 @@ static inline bool bad_args(const uint8_t* data,
     return false;
 }
 
+static inline bool bad_input(const uint8_t* data,
+                             size_t len,
+                             const uint8_t* const* keys,
+                             const size_t* key_lens,
+                             size_t num_keys) {
+    return !data || len == 0 || bad_keys(keys, key_lens, num_keys);
+}
+
+static inline bool bad_args(const uint8_t* data,
+                            size_t len,
+                            const uint8_t* const* keys,
+                            const size_t* key_lens,
+                            size_t num_keys,
+                            struct findkey_result* out_results) {
+    return !out_results || bad_input(data, len, keys, key_lens, num_keys);
+}
+
 static inline bool bad_args_stats(const uint8_t* data,
                                   size_t len,
                                   const uint8_t* const* keys,
                                   const size_t* key_lens,
                                   size_t num_keys,
                                   struct findkey_teddy_stats* teddy_stats) {
-    if (!data || len == 0 || !keys || !key_lens || !num_keys || !teddy_stats) {
-        return true;
-    }
-    for (size_t i = 0; i < num_keys; ++i) {
-        if (!keys[i] && key_lens[i] != 0) {
-            return true;
-        }
-        if (key_lens[i] == 0) {
-            return true;
-        }
-    }
-    return false;
+    return !teddy_stats || bad_input(data, len, keys, key_lens, num_keys);
 }
 
 template <typename Fn>
@@ -77,17 +93,96 @@ static int status_from_error(const FindkeyError& error) noexcept {
     return FINDKEY_ERR_BAD_ARGS;
 }
 
-extern "C" size_t findkey(const uint8_t* data,
-                          size_t len,
-                          const uint8_t* const* keys,
-                          const size_t* key_lens,
-                          size_t num_keys,
-                          enum findkey_algo algo,
-                          const struct findkey_teddy_config* teddy_config,
-                          struct findkey_result* out_results,
-                          size_t max_out_positions,
-                          int* out_status,
-                          struct findkey_timing* out_timing) {
+static teddy::CompilationData compile_teddy(
+    std::string_view data,
+    const std::vector<std::string_view>& keys,
+    const findkey_teddy_config& config) {
+    if ((config.grouping.score != TEDDY_GROUPING_SCORE_FREQUENCY &&
+         config.suffix_mode != TEDDY_SUFFIX_WINDOW) ||
+        config.grouping.byte_histogram) {
+        return teddy::compile(keys, config);
+    }
+
+    const findkey_byte_histogram histogram =
+        teddy::sample_byte_histogram(data);
+    findkey_teddy_config sampled_config = config;
+    sampled_config.grouping.byte_histogram = &histogram;
+    return teddy::compile(keys, sampled_config);
+}
+
+// the sampling pass of TEDDY_GROUPING_SCORE_FREQUENCY and
+// TEDDY_SUFFIX_WINDOW, and the search of TEDDY_COMPILE_AUTO count as compile
+// time
+static findkey_db compile_db(std::string_view data,
+                             const std::vector<std::string_view>& keys,
+                             const findkey_teddy_config& config) {
+    findkey_db db;
+    db.keys.assign(keys.begin(), keys.end());
+    if (config.grouping.strategy == TEDDY_COMPILE_AUTO) {
+        TeddyAutoSelection selection = select_teddy_config(data, keys, config);
+        db.config = selection.config;
+        db.data = std::move(selection.data);
+    } else {
+        db.config = config;
+        db.data = compile_teddy(data, keys, config);
+    }
+    db.config.grouping.byte_histogram = nullptr;
+    db.grouped_pass_rate = teddy::estimated_pass_rate(db.data);
+    db.dfa = compile_key_dfa(keys, db.config.verifier);
+    return db;
+}
+
+static std::shared_ptr<const findkey_db> compile_cached_db(
+    std::string_view data,
+    const std::vector<std::string_view>& keys,
+    const findkey_teddy_config& config) {
+    return compile_cache().find_or_compile(
+        keys, config, [&] { return compile_db(data, keys, config); });
+}
+
+static std::string_view data_view(const uint8_t* data, size_t len) {
+    return std::string_view(reinterpret_cast<const char*>(data), len);
+}
+
+static std::vector<std::string_view> key_views(const uint8_t* const* keys,
+                                               const size_t* key_lens,
+                                               size_t num_keys) {
+    std::vector<std::string_view> key_svs;
+    key_svs.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+        const char* k = reinterpret_cast<const char*>(keys[i]);
+        key_svs.emplace_back(k, key_lens[i]);
+    }
+    return key_svs;
+}
+
+static findkey_teddy_config config_or_default(
+    const findkey_teddy_config* teddy_config) {
+    const findkey_teddy_config default_teddy_config = FINDKEY_TEDDY_CONFIG_INIT;
+    return teddy_config ? *teddy_config : default_teddy_config;
+}
+
+// runs task, timing it into *ns unless ns is null
+template <typename Fn>
+static void timed(uint64_t* ns, Fn&& task) {
+    if (ns) {
+        *ns = measure_ns(task);
+    } else {
+        task();
+    }
+}
+
+/*
+    The frame of the C entry points
+    - resets *out_status and *out_timing, returns 0 on bad arguments
+    - otherwise returns what run returns, or 0 with the status of a
+      FindkeyError it throws
+*/
+template <typename Fn>
+static size_t run_entry(bool bad_arguments,
+                        int* out_status,
+                        findkey_timing* out_timing,
+                        Fn&& run) {
     if (out_status) {
         *out_status = FINDKEY_OK;
     }
@@ -95,162 +190,665 @@ extern "C" size_t findkey(const uint8_t* data,
         *out_timing = {};
     }
 
-    if (bad_args(data, len, keys, key_lens, num_keys, out_results)) {
+    if (bad_arguments) {
         if (out_status) {
             *out_status = FINDKEY_ERR_BAD_ARGS;
         }
         return 0;
     }
 
-    const std::string_view data_sv(reinterpret_cast<const char*>(data), len);
+    try {
+        return std::forward<Fn>(run)();
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
+        }
+        return 0;
+    }
+}
 
-    std::vector<std::string_view> key_svs;
-    key_svs.reserve(num_keys);
-    for (size_t i = 0; i < num_keys; ++i) {
-        const char* k = reinterpret_cast<const char*>(keys[i]);
-        key_svs.emplace_back(k, key_lens[i]);
+#if COMPILER_SUPPORTS_TEDDY
+// the adaptive scan keeps no block boundaries to resume from
+template <typename Sink>
+static void run_teddy_into(std::string_view data,
+                           const findkey_db& db,
+                           Sink& sink,
+                           ResultQuery* query,
+                           size_t start) {
+    if constexpr (!resumable_sink<Sink>) {
+        if (db.config.scan_mode == TEDDY_SCAN_ADAPTIVE) {
+            matcher_teddy_adaptive_into(data, db.data, db.dfa, sink, nullptr,
+                                        query);
+            return;
+        }
     }
+    matcher_teddy_into(data, db.data, db.dfa, sink, query, start);
+}
+#else
+template <typename Sink>
+static void run_teddy_into(std::string_view,
+                           const findkey_db&,
+                           Sink&,
+                           ResultQuery*,
+                           size_t) {
+    throw FindkeyError(FindkeyErrorCode::NOT_SUPPORTED,
+                       "Teddy is not supported by this compiler");
+}
+#endif
 
-    std::vector<findkey_result> results;
-    const findkey_teddy_config default_teddy_config = FINDKEY_TEDDY_CONFIG_INIT;
-    const findkey_teddy_config& config =
-        teddy_config ? *teddy_config : default_teddy_config;
+// compiles keys through the compile cache for the Teddy algorithms, then
+// scans data into sink from start on
+template <typename Sink>
+static void run_with_sink(std::string_view data,
+                          const std::vector<std::string_view>& keys,
+                          findkey_algo algo,
+                          const findkey_teddy_config& config,
+                          Sink& sink,
+                          findkey_timing* timing,
+                          ResultQuery* query = nullptr,
+                          size_t start = 0) {
+    std::shared_ptr<const findkey_db> db;
+    if (algo == TEDDY || algo == TEDDY_BASELINE) {
+        timed(timing ? &timing->compile_ns : nullptr,
+              [&] { db = compile_cached_db(data, keys, config); });
+    }
 
-    try {
+    timed(timing ? &timing->match_ns : nullptr, [&] {
         switch (algo) {
-            case SCALAR: {
-                if (out_timing) {
-                    out_timing->match_ns = measure_ns(
-                        [&] { results = matcher_scalar(data_sv, key_svs); });
-                } else {
-                    results = matcher_scalar(data_sv, key_svs);
-                }
+            case SCALAR:
+                matcher_scalar_into(data, keys, sink, query, start);
                 break;
-            }
-
             case TEDDY:
-#if COMPILER_SUPPORTS_TEDDY
-            {
-                teddy::CompilationData teddy_data;
-                DFA dfa;
-                if (out_timing) {
-                    out_timing->compile_ns = measure_ns([&] {
-                        teddy_data = teddy::compile(key_svs, config);
-                        dfa = compile_key_dfa(key_svs);
-                    });
-                    out_timing->match_ns = measure_ns([&] {
-                        results = matcher_teddy(data_sv, teddy_data, dfa);
-                    });
-                } else {
-                    teddy_data = teddy::compile(key_svs, config);
-                    dfa = compile_key_dfa(key_svs);
-                    results = matcher_teddy(data_sv, teddy_data, dfa);
-                }
+                run_teddy_into(data, *db, sink, query, start);
                 break;
-            }
-#else
-                throw FindkeyError(FindkeyErrorCode::NOT_SUPPORTED,
-                                   "Teddy is not supported by this compiler");
-#endif
-            case TEDDY_BASELINE: {
-                teddy::CompilationData teddy_data;
-                DFA dfa;
-                if (out_timing) {
-                    out_timing->compile_ns = measure_ns([&] {
-                        teddy_data = teddy::compile(key_svs, config);
-                        dfa = compile_key_dfa(key_svs);
-                    });
-                    out_timing->match_ns = measure_ns([&] {
-                        results =
-                            matcher_teddy_baseline(data_sv, teddy_data, dfa);
-                    });
-                } else {
-                    teddy_data = teddy::compile(key_svs, config);
-                    dfa = compile_key_dfa(key_svs);
-                    results = matcher_teddy_baseline(data_sv, teddy_data, dfa);
-                }
+            case TEDDY_BASELINE:
+                matcher_teddy_baseline_into(data, db->data, db->dfa, sink,
+                                            nullptr, query, start);
                 break;
-            }
             default:
                 throw FindkeyError(FindkeyErrorCode::UNKNOWN_ALGORITHM,
                                    "Unknown matching algorithm");
         }
+    });
+}
+
+// run_with_sink for a database compiled beforehand
+template <typename Sink>
+static void run_db_with_sink(const findkey_db& db,
+                             std::string_view data,
+                             Sink& sink,
+                             findkey_timing* timing,
+                             ResultQuery* query = nullptr,
+                             size_t start = 0) {
+    timed(timing ? &timing->match_ns : nullptr,
+          [&] { run_teddy_into(data, db, sink, query, start); });
+}
+
+// applies the ordering of query, copies what fits into out_results
+static size_t finish_results(const ResultQuery& query,
+                             std::vector<findkey_result>& results,
+                             findkey_result* out_results,
+                             size_t max_out_positions) {
+    query.finish(results);
+    std::copy_n(results.begin(), std::min(results.size(), max_out_positions),
+                out_results);
+    return results.size();
+}
+
+static size_t total_count(std::span<const uint64_t> counts) {
+    return std::accumulate(counts.begin(), counts.end(), size_t{0});
+}
 
-        const size_t num_positions =
-            std::min(results.size(), max_out_positions);
+// the adaptive scan only exists for the SIMD matcher
+static std::vector<findkey_result> run_teddy_with_stats(
+    std::string_view data,
+    const teddy::CompilationData& teddy_data,
+    const DFA& dfa,
+    const findkey_teddy_config& config,
+    findkey_teddy_stats* stats) {
+    if (config.scan_mode == TEDDY_SCAN_ADAPTIVE) {
+#if COMPILER_SUPPORTS_TEDDY
+        return matcher_teddy_adaptive(data, teddy_data, dfa, stats);
+#else
+        throw FindkeyError(FindkeyErrorCode::NOT_SUPPORTED,
+                           "Teddy is not supported by this compiler");
+#endif
+    }
+    return matcher_teddy_baseline(data, teddy_data, dfa, stats);
+}
 
-        for (size_t i = 0; i < num_positions; ++i) {
-            out_results[i] = results[i];
+extern "C" size_t findkey(const uint8_t* data,
+                          size_t len,
+                          const uint8_t* const* keys,
+                          const size_t* key_lens,
+                          size_t num_keys,
+                          enum findkey_algo algo,
+                          const struct findkey_teddy_config* teddy_config,
+                          struct findkey_result* out_results,
+                          size_t max_out_positions,
+                          int* out_status,
+                          struct findkey_timing* out_timing) {
+    return findkey_with_query(data, len, keys, key_lens, num_keys, algo,
+                              teddy_config, nullptr, out_results,
+                              max_out_positions, out_status, out_timing);
+}
+
+extern "C" size_t findkey_with_query(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    enum findkey_algo algo,
+    const struct findkey_teddy_config* teddy_config,
+    const struct findkey_query* query,
+    struct findkey_result* out_results,
+    size_t max_out_positions,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad = bad_args(data, len, keys, key_lens, num_keys, out_results);
+    return run_entry(bad, out_status, out_timing, [&] {
+        const auto key_svs = key_views(keys, key_lens, num_keys);
+        const findkey_query default_query = FINDKEY_QUERY_INIT;
+        ResultQuery result_query(query ? *query : default_query, key_svs);
+        ResultVector sink;
+        run_with_sink(data_view(data, len), key_svs, algo,
+                      config_or_default(teddy_config), sink, out_timing,
+                      ResultQuery::active(result_query));
+        return finish_results(result_query, sink.results, out_results,
+                              max_out_positions);
+    });
+}
+
+static bool bad_cursor(const findkey_cursor* cursor,
+                       size_t len,
+                       const findkey_result* out_results,
+                       size_t max_out_positions) {
+    return !cursor || cursor->offset > len || !out_results ||
+           max_out_positions == 0;
+}
+
+extern "C" size_t findkey_with_cursor(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    enum findkey_algo algo,
+    const struct findkey_teddy_config* teddy_config,
+    struct findkey_cursor* cursor,
+    struct findkey_result* out_results,
+    size_t max_out_positions,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad = bad_input(data, len, keys, key_lens, num_keys) ||
+                     bad_cursor(cursor, len, out_results, max_out_positions);
+    return run_entry(bad, out_status, out_timing, [&]() -> size_t {
+        if (cursor->done) {
+            return 0;
         }
+        // a time limit could group the keys differently on the next call
+        findkey_teddy_config config = config_or_default(teddy_config);
+        config.grouping.refine_time_limit_ms = 0;
+
+        ResultBuffer sink({out_results, max_out_positions}, *cursor);
+        run_with_sink(data_view(data, len),
+                      key_views(keys, key_lens, num_keys), algo, config, sink,
+                      out_timing, nullptr, cursor->offset);
+        // the cursor only moves once the scan went through
+        *cursor = sink.next(len);
+        return sink.size();
+    });
+}
+
+// one array of each, narrow enough for the positions and key ids they hold
+static bool bad_columns(const findkey_result_columns* out,
+                        size_t len,
+                        size_t num_keys) {
+    if (!out || !out->positions == !out->positions32 ||
+        !out->key_ids == !out->key_ids16) {
+        return true;
+    }
+    return (out->positions32 && len > UINT32_MAX) ||
+           (out->key_ids16 && num_keys > UINT16_MAX + size_t{1});
+}
+
+extern "C" size_t findkey_columns(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    enum findkey_algo algo,
+    const struct findkey_teddy_config* teddy_config,
+    const struct findkey_result_columns* out,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad = bad_input(data, len, keys, key_lens, num_keys) ||
+                     bad_columns(out, len, num_keys);
+    return run_entry(bad, out_status, out_timing, [&] {
+        ResultColumns sink(*out);
+        run_with_sink(data_view(data, len),
+                      key_views(keys, key_lens, num_keys), algo,
+                      config_or_default(teddy_config), sink, out_timing);
+        return sink.size();
+    });
+}
+
+extern "C" size_t findkey_count(const uint8_t* data,
+                                size_t len,
+                                const uint8_t* const* keys,
+                                const size_t* key_lens,
+                                size_t num_keys,
+                                enum findkey_algo algo,
+                                const struct findkey_teddy_config* teddy_config,
+                                uint64_t* out_counts,
+                                int* out_status,
+                                struct findkey_timing* out_timing) {
+    const bool bad =
+        !out_counts || bad_input(data, len, keys, key_lens, num_keys);
+    return run_entry(bad, out_status, out_timing, [&] {
+        KeyCounts sink{std::span(out_counts, num_keys)};
+        std::fill(sink.counts.begin(), sink.counts.end(), 0);
+        run_with_sink(data_view(data, len),
+                      key_views(keys, key_lens, num_keys), algo,
+                      config_or_default(teddy_config), sink, out_timing);
+        return total_count(sink.counts);
+    });
+}
 
+extern "C" size_t findkey_with_stats(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    const struct findkey_teddy_config* teddy_config,
+    struct findkey_teddy_stats* teddy_stats,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad =
+        bad_args_stats(data, len, keys, key_lens, num_keys, teddy_stats);
+    return run_entry(bad, out_status, out_timing, [&] {
+        *teddy_stats = {};
+        const std::string_view data_sv = data_view(data, len);
+        const auto key_svs = key_views(keys, key_lens, num_keys);
+        const findkey_teddy_config config = config_or_default(teddy_config);
+
+        std::shared_ptr<const findkey_db> db;
+        timed(out_timing ? &out_timing->compile_ns : nullptr,
+              [&] { db = compile_cached_db(data_sv, key_svs, config); });
+        std::vector<findkey_result> results;
+        timed(out_timing ? &out_timing->match_ns : nullptr, [&] {
+            results = run_teddy_with_stats(data_sv, db->data, db->dfa, config,
+                                           teddy_stats);
+        });
         return results.size();
+    });
+}
+
+extern "C" void findkey_teddy_select_config(
+    const uint8_t* data,
+    size_t len,
+    const uint8_t* const* keys,
+    const size_t* key_lens,
+    size_t num_keys,
+    const struct findkey_teddy_config* teddy_config,
+    struct findkey_teddy_config* out_config,
+    int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if (!out_config || bad_input(data, len, keys, key_lens, num_keys)) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return;
+    }
+
+    const findkey_teddy_config config = config_or_default(teddy_config);
+    if (config.grouping.strategy != TEDDY_COMPILE_AUTO) {
+        *out_config = config;
+        return;
+    }
+
+    try {
+        *out_config = select_teddy_config(data_view(data, len),
+                                          key_views(keys, key_lens, num_keys),
+                                          config)
+                          .config;
     } catch (const FindkeyError& error) {
         if (out_status) {
             *out_status = status_from_error(error);
         }
-        return 0;
     }
 }
 
-extern "C" size_t findkey_with_stats(
+extern "C" void findkey_sample_byte_histogram(
     const uint8_t* data,
     size_t len,
+    struct findkey_byte_histogram* out_histogram) {
+    if (!out_histogram) {
+        return;
+    }
+    *out_histogram = {};
+    if (!data) {
+        return;
+    }
+    *out_histogram = teddy::sample_byte_histogram(data_view(data, len));
+}
+
+extern "C" struct findkey_db* findkey_db_compile(
+    const uint8_t* sample,
+    size_t sample_len,
     const uint8_t* const* keys,
     const size_t* key_lens,
     size_t num_keys,
     const struct findkey_teddy_config* teddy_config,
-    struct findkey_teddy_stats* teddy_stats,
+    int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if ((!sample && sample_len != 0) || bad_keys(keys, key_lens, num_keys)) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return nullptr;
+    }
+
+    try {
+        return std::make_unique<findkey_db>(
+                   compile_db(data_view(sample, sample_len),
+                              key_views(keys, key_lens, num_keys),
+                              config_or_default(teddy_config)))
+            .release();
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
+        }
+        return nullptr;
+    }
+}
+
+extern "C" void findkey_db_free(struct findkey_db* db) {
+    delete db;
+}
+
+extern "C" size_t findkey_db_num_keys(const struct findkey_db* db) {
+    return db ? db->keys.size() : 0;
+}
+
+extern "C" const uint8_t* findkey_db_key(const struct findkey_db* db,
+                                         uint32_t key_id,
+                                         size_t* out_len) {
+    if (out_len) {
+        *out_len = 0;
+    }
+    if (!db || key_id >= db->keys.size() || db->keys[key_id].empty()) {
+        return nullptr;
+    }
+
+    const std::string& key = db->keys[key_id];
+    if (out_len) {
+        *out_len = key.size();
+    }
+    return reinterpret_cast<const uint8_t*>(key.data());
+}
+
+extern "C" uint32_t findkey_db_add_key(struct findkey_db* db,
+                                       const uint8_t* key,
+                                       size_t key_len,
+                                       int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if (!db || !key || key_len == 0) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return 0;
+    }
+
+    try {
+        return add_database_key(
+            *db, std::string_view(reinterpret_cast<const char*>(key),
+                                  key_len));
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
+        }
+        return 0;
+    }
+}
+
+extern "C" void findkey_db_remove_key(struct findkey_db* db,
+                                      uint32_t key_id,
+                                      int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if (!db) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return;
+    }
+
+    try {
+        remove_database_key(*db, key_id);
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
+        }
+    }
+}
+
+extern "C" size_t findkey_db_match(const struct findkey_db* db,
+                                   const uint8_t* data,
+                                   size_t len,
+                                   struct findkey_result* out_results,
+                                   size_t max_out_positions,
+                                   int* out_status,
+                                   struct findkey_timing* out_timing) {
+    return findkey_db_match_with_query(db, data, len, nullptr, out_results,
+                                       max_out_positions, out_status,
+                                       out_timing);
+}
+
+extern "C" size_t findkey_db_match_with_query(
+    const struct findkey_db* db,
+    const uint8_t* data,
+    size_t len,
+    const struct findkey_query* query,
+    struct findkey_result* out_results,
+    size_t max_out_positions,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad = !db || !data || len == 0 || !out_results;
+    return run_entry(bad, out_status, out_timing, [&] {
+        const findkey_query default_query = FINDKEY_QUERY_INIT;
+        // only FINDKEY_QUERY_FIRST_PER_KEY reads the keys
+        std::vector<std::string_view> key_svs;
+        if (query && query->mode == FINDKEY_QUERY_FIRST_PER_KEY) {
+            key_svs.assign(db->keys.begin(), db->keys.end());
+        }
+        ResultQuery result_query(query ? *query : default_query, key_svs);
+        ResultVector sink;
+        run_db_with_sink(*db, data_view(data, len), sink, out_timing,
+                         ResultQuery::active(result_query));
+        return finish_results(result_query, sink.results, out_results,
+                              max_out_positions);
+    });
+}
+
+extern "C" size_t findkey_db_match_with_cursor(
+    const struct findkey_db* db,
+    const uint8_t* data,
+    size_t len,
+    struct findkey_cursor* cursor,
+    struct findkey_result* out_results,
+    size_t max_out_positions,
     int* out_status,
     struct findkey_timing* out_timing) {
+    const bool bad = !db || !data || len == 0 ||
+                     bad_cursor(cursor, len, out_results, max_out_positions);
+    return run_entry(bad, out_status, out_timing, [&]() -> size_t {
+        if (cursor->done) {
+            return 0;
+        }
+        ResultBuffer sink({out_results, max_out_positions}, *cursor);
+        run_db_with_sink(*db, data_view(data, len), sink, out_timing, nullptr,
+                         cursor->offset);
+        // the cursor only moves once the scan went through
+        *cursor = sink.next(len);
+        return sink.size();
+    });
+}
+
+extern "C" size_t findkey_db_match_columns(
+    const struct findkey_db* db,
+    const uint8_t* data,
+    size_t len,
+    const struct findkey_result_columns* out,
+    int* out_status,
+    struct findkey_timing* out_timing) {
+    const bool bad =
+        !db || !data || len == 0 || bad_columns(out, len, db->keys.size());
+    return run_entry(bad, out_status, out_timing, [&] {
+        ResultColumns sink(*out);
+        run_db_with_sink(*db, data_view(data, len), sink, out_timing);
+        return sink.size();
+    });
+}
+
+extern "C" size_t findkey_db_count(const struct findkey_db* db,
+                                   const uint8_t* data,
+                                   size_t len,
+                                   uint64_t* out_counts,
+                                   int* out_status,
+                                   struct findkey_timing* out_timing) {
+    const bool bad = !db || !data || len == 0 || !out_counts;
+    return run_entry(bad, out_status, out_timing, [&] {
+        KeyCounts sink{std::span(out_counts, db->keys.size())};
+        std::fill(sink.counts.begin(), sink.counts.end(), 0);
+        run_db_with_sink(*db, data_view(data, len), sink, out_timing);
+        return total_count(sink.counts);
+    });
+}
+
+extern "C" size_t findkey_db_serialize(const struct findkey_db* db,
+                                       uint8_t* out,
+                                       size_t capacity,
+                                       int* out_status) {
     if (out_status) {
         *out_status = FINDKEY_OK;
     }
-    if (out_timing) {
-        *out_timing = {};
-    }
 
-    if (bad_args_stats(data, len, keys, key_lens, num_keys, teddy_stats)) {
+    if (!db) {
         if (out_status) {
             *out_status = FINDKEY_ERR_BAD_ARGS;
         }
         return 0;
     }
 
-    *teddy_stats = {};
+    const std::vector<uint8_t> bytes = serialize_database(*db);
+    if (out && bytes.size() <= capacity) {
+        std::memcpy(out, bytes.data(), bytes.size());
+    }
+    return bytes.size();
+}
 
-    const std::string_view data_sv(reinterpret_cast<const char*>(data), len);
+extern "C" struct findkey_db* findkey_db_deserialize(const uint8_t* bytes,
+                                                     size_t len,
+                                                     int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
 
-    std::vector<std::string_view> key_svs;
-    key_svs.reserve(num_keys);
-    for (size_t i = 0; i < num_keys; ++i) {
-        const char* k = reinterpret_cast<const char*>(keys[i]);
-        key_svs.emplace_back(k, key_lens[i]);
+    if (!bytes) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return nullptr;
     }
-    const findkey_teddy_config default_teddy_config = FINDKEY_TEDDY_CONFIG_INIT;
-    const findkey_teddy_config& config =
-        teddy_config ? *teddy_config : default_teddy_config;
 
     try {
-        teddy::CompilationData teddy_data;
-        DFA dfa;
-        std::vector<findkey_result> results;
-        if (out_timing) {
-            out_timing->compile_ns = measure_ns([&] {
-                teddy_data = teddy::compile(key_svs, config);
-                dfa = compile_key_dfa(key_svs);
-            });
-            out_timing->match_ns = measure_ns([&] {
-                results = matcher_teddy_baseline(data_sv, teddy_data, dfa,
-                                                 teddy_stats);
-            });
-        } else {
-            teddy_data = teddy::compile(key_svs, config);
-            dfa = compile_key_dfa(key_svs);
-            results =
-                matcher_teddy_baseline(data_sv, teddy_data, dfa, teddy_stats);
+        return std::make_unique<findkey_db>(
+                   deserialize_database(std::span(bytes, len)))
+            .release();
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
         }
+        return nullptr;
+    }
+}
 
-        return results.size();
+extern "C" struct findkey_db* findkey_db_map(const uint8_t* bytes,
+                                             size_t len,
+                                             int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if (!bytes) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return nullptr;
+    }
+
+    try {
+        return std::make_unique<findkey_db>(
+                   map_database(std::span(bytes, len)))
+            .release();
+    } catch (const FindkeyError& error) {
+        if (out_status) {
+            *out_status = status_from_error(error);
+        }
+        return nullptr;
+    }
+}
+
+extern "C" size_t findkey_results_encode(const struct findkey_result* results,
+                                         size_t num_results,
+                                         uint8_t* out,
+                                         size_t capacity,
+                                         int* out_status) {
+    const bool bad = !results && num_results != 0;
+    return run_entry(bad, out_status, nullptr, [&] {
+        const std::span block(results, num_results);
+        const size_t size = encoded_results_size(block);
+        if (out && size <= capacity) {
+            encode_results(block, out);
+        }
+        return size;
+    });
+}
+
+extern "C" size_t findkey_results_decode(const uint8_t* bytes,
+                                         size_t len,
+                                         struct findkey_result* out_results,
+                                         size_t max_out_positions,
+                                         int* out_status) {
+    if (out_status) {
+        *out_status = FINDKEY_OK;
+    }
+
+    if (!bytes || (!out_results && max_out_positions != 0)) {
+        if (out_status) {
+            *out_status = FINDKEY_ERR_BAD_ARGS;
+        }
+        return 0;
+    }
+
+    try {
+        return decode_results(std::span(bytes, len),
+                              std::span(out_results, max_out_positions));
     } catch (const FindkeyError& error) {
         if (out_status) {
             *out_status = status_from_error(error);
@@ -258,3 +856,18 @@ extern "C" size_t findkey_with_stats(
         return 0;
     }
 }
+
+extern "C" void findkey_set_compile_cache_capacity(size_t capacity) {
+    compile_cache().set_capacity(capacity);
+}
+
+extern "C" void findkey_get_compile_cache_stats(
+    struct findkey_compile_cache_stats* out_stats) {
+    if (out_stats) {
+        *out_stats = compile_cache().stats();
+    }
+}
+
+extern "C" void findkey_reset_compile_cache(void) {
+    compile_cache().reset();
+}
@@ -56,6 +56,15 @@ std::optional<findkey_teddy_compile_grouping_strategy> parse_grouping_strategy(
         raw == "sort_optimal_partition" || raw == "sorted_optimal_partition") {
         return TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION;
     }
+    if (raw == "branch_and_bound") {
+        return TEDDY_COMPILE_BRANCH_AND_BOUND;
+    }
+    if (raw == "nibble_clustering") {
+        return TEDDY_COMPILE_NIBBLE_CLUSTERING;
+    }
+    if (raw == "auto") {
+        return TEDDY_COMPILE_AUTO;
+    }
     return std::nullopt;
 }
 
@@ -70,6 +79,9 @@ std::optional<findkey_teddy_grouping_score> parse_grouping_score(
     if (raw == "nibble_count") {
         return TEDDY_GROUPING_SCORE_NIBBLE_COUNT;
     }
+    if (raw == "frequency") {
+        return TEDDY_GROUPING_SCORE_FREQUENCY;
+    }
     return std::nullopt;
 }
 
@@ -81,6 +93,15 @@ std::optional<findkey_teddy_suffix_mode> parse_suffix_mode(
     if (raw == "quote-suffix") {
         return TEDDY_SUFFIX_QUOTED;
     }
+    if (raw == "window") {
+        return TEDDY_SUFFIX_WINDOW;
+    }
+    if (raw == "prefix") {
+        return TEDDY_SUFFIX_PREFIX;
+    }
+    if (raw == "auto") {
+        return TEDDY_SUFFIX_AUTO;
+    }
     return std::nullopt;
 }
 
@@ -105,6 +126,55 @@ std::optional<int> parse_sigma(std::string_view raw) {
     return static_cast<int>(value);
 }
 
+std::optional<uint32_t> parse_uint32(std::string_view raw) {
+    if (raw.empty() || raw.front() == '-') {
+        return std::nullopt;
+    }
+
+    const std::string text(raw);
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || end == text.c_str() || *end != '\0') {
+        return std::nullopt;
+    }
+
+    if (value > std::numeric_limits<uint32_t>::max()) {
+        return std::nullopt;
+    }
+
+    return static_cast<uint32_t>(value);
+}
+
+std::optional<findkey_teddy_verifier> parse_verifier(std::string_view raw) {
+    if (raw == "dfa") {
+        return TEDDY_VERIFY_DFA;
+    }
+    if (raw == "suffix_table") {
+        return TEDDY_VERIFY_SUFFIX_TABLE;
+    }
+    if (raw == "top_trie") {
+        return TEDDY_VERIFY_TOP_TRIE;
+    }
+    if (raw == "pipelined") {
+        return TEDDY_VERIFY_PIPELINED;
+    }
+    if (raw == "swar") {
+        return TEDDY_VERIFY_SWAR;
+    }
+    return std::nullopt;
+}
+
+std::optional<findkey_teddy_scan_mode> parse_scan_mode(std::string_view raw) {
+    if (raw == "fixed") {
+        return TEDDY_SCAN_FIXED;
+    }
+    if (raw == "adaptive") {
+        return TEDDY_SCAN_ADAPTIVE;
+    }
+    return std::nullopt;
+}
+
 std::string_view algo_name(findkey_algo algo) {
     switch (algo) {
         case SCALAR:
@@ -141,6 +211,12 @@ std::string_view grouping_strategy_name(
             return "sorted_suffix_partition";
         case TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION:
             return "sorted_suffix_optimal_partition";
+        case TEDDY_COMPILE_BRANCH_AND_BOUND:
+            return "branch_and_bound";
+        case TEDDY_COMPILE_NIBBLE_CLUSTERING:
+            return "nibble_clustering";
+        case TEDDY_COMPILE_AUTO:
+            return "auto";
         default:
             return "unknown";
     }
@@ -154,6 +230,8 @@ std::string_view grouping_score_name(findkey_teddy_grouping_score score) {
             return "paper_nibble";
         case TEDDY_GROUPING_SCORE_NIBBLE_COUNT:
             return "nibble_count";
+        case TEDDY_GROUPING_SCORE_FREQUENCY:
+            return "frequency";
         default:
             return "unknown";
     }
@@ -165,6 +243,40 @@ std::string_view suffix_mode_name(findkey_teddy_suffix_mode suffix_mode) {
             return "raw";
         case TEDDY_SUFFIX_QUOTED:
             return "quote-suffix";
+        case TEDDY_SUFFIX_WINDOW:
+            return "window";
+        case TEDDY_SUFFIX_PREFIX:
+            return "prefix";
+        case TEDDY_SUFFIX_AUTO:
+            return "auto";
+        default:
+            return "unknown";
+    }
+}
+
+std::string_view verifier_name(findkey_teddy_verifier verifier) {
+    switch (verifier) {
+        case TEDDY_VERIFY_DFA:
+            return "dfa";
+        case TEDDY_VERIFY_SUFFIX_TABLE:
+            return "suffix_table";
+        case TEDDY_VERIFY_TOP_TRIE:
+            return "top_trie";
+        case TEDDY_VERIFY_PIPELINED:
+            return "pipelined";
+        case TEDDY_VERIFY_SWAR:
+            return "swar";
+        default:
+            return "unknown";
+    }
+}
+
+std::string_view scan_mode_name(findkey_teddy_scan_mode scan_mode) {
+    switch (scan_mode) {
+        case TEDDY_SCAN_FIXED:
+            return "fixed";
+        case TEDDY_SCAN_ADAPTIVE:
+            return "adaptive";
         default:
             return "unknown";
     }
@@ -2,6 +2,7 @@
 
 #include "findkey.h"
 
+#include <cstdint>
 #include <optional>
 #include <string_view>
 
@@ -20,6 +21,13 @@ std::optional<findkey_teddy_suffix_mode> parse_suffix_mode(
 
 std::optional<int> parse_sigma(std::string_view raw);
 
+// refinement passes and time limits
+std::optional<uint32_t> parse_uint32(std::string_view raw);
+
+std::optional<findkey_teddy_verifier> parse_verifier(std::string_view raw);
+
+std::optional<findkey_teddy_scan_mode> parse_scan_mode(std::string_view raw);
+
 std::string_view algo_name(findkey_algo algo);
 
 std::string_view grouping_strategy_name(
@@ -29,6 +37,10 @@ std::string_view grouping_score_name(findkey_teddy_grouping_score score);
 
 std::string_view suffix_mode_name(findkey_teddy_suffix_mode suffix_mode);
 
+std::string_view verifier_name(findkey_teddy_verifier verifier);
+
+std::string_view scan_mode_name(findkey_teddy_scan_mode scan_mode);
+
 std::string_view status_name(int status);
 
 }  // namespace findkey_options
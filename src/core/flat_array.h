@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+/*
+    Read-only array that owns its elements, or borrows them from a database
+    mapped by findkey_db_map
+    - built from a std::vector, which keeps the elements where they are
+    - copies of a borrowed array borrow the same memory
+    - edit() is the only way to change the elements
+*/
+template <typename T>
+class FlatArray {
+   public:
+    FlatArray() = default;
+
+    // implicit, so compilers fill a std::vector and assign it
+    FlatArray(std::vector<T> elements) noexcept
+        : owned_(std::move(elements)), view_(owned_) {}
+
+    static FlatArray borrow(std::span<const T> elements) noexcept {
+        FlatArray array;
+        array.view_ = elements;
+        array.borrowed_ = true;
+        return array;
+    }
+
+    FlatArray(const FlatArray& other)
+        : owned_(other.owned_),
+          view_(other.borrowed_ ? other.view_ : std::span<const T>(owned_)),
+          borrowed_(other.borrowed_) {}
+
+    FlatArray(FlatArray&& other) noexcept
+        : owned_(std::move(other.owned_)),
+          view_(std::exchange(other.view_, {})),
+          borrowed_(other.borrowed_) {}
+
+    FlatArray& operator=(FlatArray other) noexcept {
+        owned_.swap(other.owned_);
+        std::swap(view_, other.view_);
+        std::swap(borrowed_, other.borrowed_);
+        return *this;
+    }
+
+    [[nodiscard]] const T* data() const noexcept { return view_.data(); }
+    [[nodiscard]] size_t size() const noexcept { return view_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return view_.empty(); }
+    [[nodiscard]] bool borrowed() const noexcept { return borrowed_; }
+
+    [[nodiscard]] const T& operator[](size_t index) const noexcept {
+        return view_.data()[index];
+    }
+    [[nodiscard]] const T& back() const noexcept { return view_.back(); }
+
+    [[nodiscard]] const T* begin() const noexcept { return view_.data(); }
+    [[nodiscard]] const T* end() const noexcept {
+        return view_.data() + view_.size();
+    }
+
+    [[nodiscard]] std::span<const T> span() const noexcept { return view_; }
+
+    // copies borrowed elements once, then edits them in place
+    template <typename Edit>
+    void edit(Edit&& edit) {
+        if (borrowed_) {
+            owned_.assign(view_.begin(), view_.end());
+            borrowed_ = false;
+        }
+        std::forward<Edit>(edit)(owned_);
+        view_ = owned_;
+    }
+
+   private:
+    std::vector<T> owned_;
+    std::span<const T> view_;
+    bool borrowed_ = false;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// a quote preceded by an even number of backslashes ends the key early,
+// so such a key can never be found in JSON
+inline bool key_has_unescaped_quote(std::string_view key) {
+    for (size_t i = 0; i < key.size(); ++i) {
+        if (key[i] != '"') {
+            continue;
+        }
+
+        size_t backslash_count = 0;
+        for (size_t k = i; k > 0 && key[k - 1] == '\\'; --k) {
+            ++backslash_count;
+        }
+        if ((backslash_count % 2) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
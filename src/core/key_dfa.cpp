@@ -1,36 +1,179 @@
 #include "core/key_dfa.h"
 
+#include "core/json_key.h"
+
 #include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
 
-DFA compile_key_dfa(const std::vector<std::string_view>& keys) {
-    DFA dfa;
-    dfa.nodes.emplace_back();  // root
+ShortKeyTable build_short_key_table(const std::vector<std::string_view>& keys) {
+    struct PackedKey {
+        uint64_t lo;
+        uint64_t hi;
+        uint32_t key_id;
+        uint32_t len;
+    };
 
+    std::vector<PackedKey> packed;
+    std::unordered_set<std::string_view> seen;
     for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
         const std::string_view key = keys[key_id];
-        dfa.max_key_len = std::max(dfa.max_key_len, key.size());
+        if (key.empty() || key.size() > SHORT_KEY_MAX_LEN ||
+            key_has_unescaped_quote(key) || !seen.insert(key).second) {
+            continue;
+        }
 
-        int32_t current_node = 0;
-        for (size_t i = key.size(); i > 0; --i) {
-            const uint8_t c = static_cast<uint8_t>(key[i - 1]);
-            if (dfa.nodes[current_node].children[c] == -1) {
-                dfa.nodes[current_node].children[c] =
-                    static_cast<int32_t>(dfa.nodes.size());
-                dfa.nodes.emplace_back();
-            }
-            current_node = dfa.nodes[current_node].children[c];
+        unsigned char bytes[SHORT_KEY_MAX_LEN] = {};
+        std::memcpy(bytes, key.data(), key.size());
+        PackedKey entry{0, 0, key_id, static_cast<uint32_t>(key.size())};
+        std::memcpy(&entry.lo, bytes, sizeof(entry.lo));
+        std::memcpy(&entry.hi, bytes + sizeof(entry.lo), sizeof(entry.hi));
+        packed.push_back(entry);
+    }
+
+    std::sort(packed.begin(), packed.end(),
+              [](const PackedKey& left, const PackedKey& right) {
+                  if (left.len != right.len) {
+                      return left.len < right.len;
+                  }
+                  if (left.hi != right.hi) {
+                      return left.hi < right.hi;
+                  }
+                  return left.lo < right.lo;
+              });
+
+    ShortKeyTable table;
+    std::vector<uint64_t> lo;
+    std::vector<uint64_t> hi;
+    std::vector<uint32_t> key_ids;
+    lo.reserve(packed.size());
+    hi.reserve(packed.size());
+    key_ids.reserve(packed.size());
+    for (const PackedKey& entry : packed) {
+        ++table.bucket_offsets[entry.len + 1];
+        lo.push_back(entry.lo);
+        hi.push_back(entry.hi);
+        key_ids.push_back(entry.key_id);
+    }
+    std::partial_sum(table.bucket_offsets.begin(), table.bucket_offsets.end(),
+                     table.bucket_offsets.begin());
+    table.lo = std::move(lo);
+    table.hi = std::move(hi);
+    table.key_ids = std::move(key_ids);
+
+    return table;
+}
+
+namespace {
+
+// end of the path of key from its last byte, or from its first one when
+// `forward` is set, missing nodes are added
+int32_t add_key_path(std::vector<TrieNode>& nodes,
+                     std::string_view key,
+                     bool forward) {
+    int32_t current_node = 0;
+    for (size_t i = 0; i < key.size(); ++i) {
+        const size_t index = forward ? i : key.size() - 1 - i;
+        const uint8_t c = static_cast<uint8_t>(key[index]);
+        if (nodes[current_node].children[c] == -1) {
+            nodes[current_node].children[c] =
+                static_cast<int32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        current_node = nodes[current_node].children[c];
+    }
+    return current_node;
+}
+
+DFA compile_trie(const std::vector<std::string_view>& keys, bool forward) {
+    DFA dfa;
+    std::vector<TrieNode> nodes;
+    nodes.emplace_back();  // root
+
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        const std::string_view key = keys[key_id];
+        if (key.empty()) {  // removed from a findkey_db
+            continue;
         }
+        dfa.max_key_len = std::max(dfa.max_key_len, key.size());
 
-        if (dfa.nodes[current_node].key_id != -1) {  // duplicated key
+        const int32_t end = add_key_path(nodes, key, forward);
+        if (nodes[end].key_id != -1) {  // duplicated key
             continue;
         }
 
-        dfa.nodes[current_node].key_id = key_id;
+        nodes[end].key_id = key_id;
     }
 
+    dfa.nodes = std::move(nodes);
     return dfa;
 }
 
+// entries of top_nodes starting with `last`
+void fill_top_nodes(std::vector<int32_t>& top_nodes,
+                    const DFA& dfa,
+                    size_t last) {
+    const int32_t child = dfa.nodes[0].children[last];
+    for (size_t second_last = 0; second_last < 256; ++second_last) {
+        top_nodes[last | (second_last << 8)] =
+            child == -1 ? -1 : dfa.nodes[child].children[second_last];
+    }
+}
+
+}  // namespace
+
+DFA compile_key_dfa(const std::vector<std::string_view>& keys) {
+    return compile_trie(keys, false);
+}
+
+DFA compile_forward_key_dfa(const std::vector<std::string_view>& keys) {
+    return compile_trie(keys, true);
+}
+
+DFA compile_key_dfa(const std::vector<std::string_view>& keys,
+                    findkey_teddy_verifier verifier) {
+    DFA dfa = compile_key_dfa(keys);
+    if (verifier == TEDDY_VERIFY_SWAR) {
+        dfa.short_keys = build_short_key_table(keys);
+    }
+    if (verifier != TEDDY_VERIFY_TOP_TRIE) {
+        return dfa;
+    }
+
+    std::vector<int32_t> top_nodes(TOP_TRIE_ENTRIES, -1);
+    for (size_t last = 0; last < 256; ++last) {
+        fill_top_nodes(top_nodes, dfa, last);
+    }
+    dfa.top_nodes = std::move(top_nodes);
+
+    return dfa;
+}
+
+void insert_key(DFA& dfa, std::string_view key, uint32_t key_id, bool forward) {
+    dfa.nodes.edit([&](std::vector<TrieNode>& nodes) {
+        const int32_t end = add_key_path(nodes, key, forward);
+        if (nodes[end].key_id == -1) {
+            nodes[end].key_id = static_cast<int32_t>(key_id);
+        }
+    });
+    dfa.max_key_len = std::max(dfa.max_key_len, key.size());
+
+    if (!dfa.top_nodes.empty()) {
+        dfa.top_nodes.edit([&](std::vector<int32_t>& top_nodes) {
+            fill_top_nodes(top_nodes, dfa,
+                           static_cast<uint8_t>(forward ? key.front()
+                                                        : key.back()));
+        });
+    }
+}
+
+void relabel_key(DFA& dfa, std::string_view key, int32_t key_id, bool forward) {
+    dfa.nodes.edit([&](std::vector<TrieNode>& nodes) {
+        nodes[add_key_path(nodes, key, forward)].key_id = key_id;
+    });
+}
+
 DFACompilationMetadata get_dfa_compilation_metadata(const DFA& dfa) {
     return {
         .nodes = dfa.nodes.size(),
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "core/flat_array.h"
+#include "findkey.h"
+
 #include <array>
 #include <cstddef>
 #include <cstdint>
@@ -13,9 +16,34 @@ struct TrieNode {
     TrieNode() { children.fill(-1); }
 };
 
+inline constexpr size_t TOP_TRIE_ENTRIES = 256 * 256;
+
+inline constexpr size_t SHORT_KEY_MAX_LEN = 16;
+
+/*
+    Keys of up to 16 bytes, zero padded into two words and bucketed by length
+    - bucket L is [bucket_offsets[L], bucket_offsets[L + 1])
+    - every bucket is sorted by (hi, lo) for a branch-free lower bound
+*/
+struct ShortKeyTable {
+    std::array<uint32_t, SHORT_KEY_MAX_LEN + 2> bucket_offsets{};
+    FlatArray<uint64_t> lo;
+    FlatArray<uint64_t> hi;
+    FlatArray<uint32_t> key_ids;
+
+    [[nodiscard]] bool empty() const noexcept { return key_ids.empty(); }
+};
+
 struct DFA {
-    std::vector<TrieNode> nodes;
+    FlatArray<TrieNode> nodes;
     size_t max_key_len = 0;
+
+    // node after the last two key bytes, indexed by last | (second_last << 8)
+    // only built for TEDDY_VERIFY_TOP_TRIE, 256 KiB to stay in L2
+    FlatArray<int32_t> top_nodes;
+
+    // only built for TEDDY_VERIFY_SWAR, longer keys still go through nodes
+    ShortKeyTable short_keys;
 };
 
 struct DFACompilationMetadata {
@@ -25,4 +53,22 @@ struct DFACompilationMetadata {
 
 DFA compile_key_dfa(const std::vector<std::string_view>& keys);
 
+DFA compile_key_dfa(const std::vector<std::string_view>& keys,
+                    findkey_teddy_verifier verifier);
+
+// same trie over the keys read from their first byte, for TEDDY_SUFFIX_PREFIX
+DFA compile_forward_key_dfa(const std::vector<std::string_view>& keys);
+
+// empty keys are skipped by every builder, they stand for keys removed from
+// a findkey_db and keep the ids of the others
+
+ShortKeyTable build_short_key_table(const std::vector<std::string_view>& keys);
+
+// a key already in the trie keeps its id, as in compile_key_dfa
+// patches top_nodes when it is built
+void insert_key(DFA& dfa, std::string_view key, uint32_t key_id, bool forward);
+
+// the path of key now ends with key_id, -1 to drop the key
+void relabel_key(DFA& dfa, std::string_view key, int32_t key_id, bool forward);
+
 DFACompilationMetadata get_dfa_compilation_metadata(const DFA& dfa);
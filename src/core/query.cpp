@@ -0,0 +1,70 @@
+#include "core/query.h"
+
+#include "core/findkey_error.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+ResultQuery::ResultQuery(const findkey_query& query,
+                         const std::vector<std::string_view>& keys)
+    : mode_(query.mode), limit_(query.limit) {
+    switch (mode_) {
+        case FINDKEY_QUERY_ALL:
+        case FINDKEY_QUERY_ANY:
+            break;
+        case FINDKEY_QUERY_LIMIT:
+            if (limit_ == 0) {
+                throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                                   "Query limit must be at least 1");
+            }
+            break;
+        case FINDKEY_QUERY_FIRST_PER_KEY: {
+            // a duplicate key never matches, the first one keeps its id
+            std::unordered_set<std::string_view> distinct_keys;
+            distinct_keys.reserve(keys.size());
+            for (std::string_view key : keys) {
+                if (!key.empty()) {
+                    distinct_keys.insert(key);
+                }
+            }
+            matched_.assign(keys.size(), false);
+            unmatched_keys_ = distinct_keys.size();
+            break;
+        }
+        default:
+            throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                               "Unknown query mode");
+    }
+}
+
+void ResultQuery::finish(std::vector<findkey_result>& results) const {
+    if (mode_ == FINDKEY_QUERY_ALL) {
+        return;
+    }
+
+    // window offsets and batched verifiers may report a later key first
+    std::stable_sort(results.begin(), results.end(),
+                     [](const findkey_result& a, const findkey_result& b) {
+                         return a.position < b.position;
+                     });
+
+    switch (mode_) {
+        case FINDKEY_QUERY_ANY:
+            results.resize(std::min<size_t>(results.size(), 1));
+            break;
+        case FINDKEY_QUERY_LIMIT:
+            results.resize(std::min(results.size(), limit_));
+            break;
+        case FINDKEY_QUERY_FIRST_PER_KEY: {
+            std::vector<bool> kept(matched_.size(), false);
+            std::erase_if(results, [&](const findkey_result& result) {
+                const bool duplicate = kept[result.key_id];
+                kept[result.key_id] = true;
+                return duplicate;
+            });
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "findkey.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+    Early exit of a matcher, see findkey_with_query
+    - matchers pass every result so far to done() between blocks, it only
+      looks at the ones added since the last call
+    - finish() orders the results by position and keeps the answer
+*/
+class ResultQuery {
+   public:
+    // keys numbered as the matcher reports them, removed keys are empty;
+    // throws FindkeyError INVALID_ARGUMENT for a malformed query
+    ResultQuery(const findkey_query& query,
+                const std::vector<std::string_view>& keys);
+
+    // nullptr when every match is wanted anyway, so matchers skip the checks
+    static ResultQuery* active(ResultQuery& query) noexcept {
+        return query.mode_ == FINDKEY_QUERY_ALL ? nullptr : &query;
+    }
+
+    bool done(const std::vector<findkey_result>& results) {
+        switch (mode_) {
+            case FINDKEY_QUERY_ANY:
+                return !results.empty();
+            case FINDKEY_QUERY_LIMIT:
+                return results.size() >= limit_;
+            case FINDKEY_QUERY_FIRST_PER_KEY:
+                for (; checked_ < results.size(); ++checked_) {
+                    const uint32_t key_id = results[checked_].key_id;
+                    if (!matched_[key_id]) {
+                        matched_[key_id] = true;
+                        --unmatched_keys_;
+                    }
+                }
+                return unmatched_keys_ == 0;
+            default:
+                return false;
+        }
+    }
+
+    void finish(std::vector<findkey_result>& results) const;
+
+   private:
+    findkey_query_mode mode_;
+    size_t limit_ = 0;
+
+    // FINDKEY_QUERY_FIRST_PER_KEY, by key id
+    std::vector<bool> matched_;
+    size_t unmatched_keys_ = 0;
+    size_t checked_ = 0;
+};
@@ -0,0 +1,137 @@
+#include "core/result_block.h"
+
+#include "core/findkey_error.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+[[noreturn]] void bad_block(const char* message) {
+    throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT, message);
+}
+
+size_t varint_size(uint64_t value) noexcept {
+    size_t size = 1;
+    for (; value >= 0x80; value >>= 7) {
+        ++size;
+    }
+    return size;
+}
+
+uint8_t* put_varint(uint8_t* out, uint64_t value) noexcept {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+class VarintReader {
+   public:
+    explicit VarintReader(std::span<const uint8_t> in) : in_(in) {}
+
+    uint64_t next() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position_ == in_.size()) {
+                bad_block("Truncated findkey result block");
+            }
+            const uint8_t byte = in_[position_++];
+            // the tenth byte only has room for the top bit
+            if (shift == 63 && byte > 1) {
+                bad_block("Varint overflow in findkey result block");
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        bad_block("Varint overflow in findkey result block");
+    }
+
+    [[nodiscard]] size_t remaining() const noexcept {
+        return in_.size() - position_;
+    }
+
+   private:
+    std::span<const uint8_t> in_;
+    size_t position_ = 0;
+};
+
+uint64_t zigzag(uint64_t delta) noexcept {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+uint64_t unzigzag(uint64_t value) noexcept {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+// emits the varints of the block after its header, in order
+template <typename Fn>
+void for_each_varint(std::span<const findkey_result> results, Fn&& emit) {
+    emit(results.size());
+    uint64_t previous = 0;
+    for (const findkey_result& result : results) {
+        // wraps around for a smaller position, unzigzag undoes it
+        emit(zigzag(uint64_t{result.position} - previous));
+        emit(result.key_id);
+        previous = result.position;
+    }
+}
+
+}  // namespace
+
+size_t encoded_results_size(std::span<const findkey_result> results) {
+    size_t size = sizeof(RESULT_BLOCK_MAGIC) + 1;
+    for_each_varint(results, [&](uint64_t value) {
+        size += varint_size(value);
+    });
+    return size;
+}
+
+void encode_results(std::span<const findkey_result> results, uint8_t* out) {
+    std::memcpy(out, RESULT_BLOCK_MAGIC, sizeof(RESULT_BLOCK_MAGIC));
+    out += sizeof(RESULT_BLOCK_MAGIC);
+    *out++ = RESULT_BLOCK_VERSION;
+    for_each_varint(results,
+                    [&](uint64_t value) { out = put_varint(out, value); });
+}
+
+size_t decode_results(std::span<const uint8_t> bytes,
+                      std::span<findkey_result> out) {
+    const size_t header_size = sizeof(RESULT_BLOCK_MAGIC) + 1;
+    if (bytes.size() < header_size ||
+        std::memcmp(bytes.data(), RESULT_BLOCK_MAGIC,
+                    sizeof(RESULT_BLOCK_MAGIC)) != 0) {
+        bad_block("Not a findkey result block");
+    }
+    if (bytes[sizeof(RESULT_BLOCK_MAGIC)] != RESULT_BLOCK_VERSION) {
+        bad_block("Unsupported findkey result block version");
+    }
+
+    VarintReader reader(bytes.subspan(header_size));
+    const uint64_t count = reader.next();
+    // every result takes two bytes at least
+    if (count > reader.remaining() / 2) {
+        bad_block("Truncated findkey result block");
+    }
+
+    uint64_t position = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        position += unzigzag(reader.next());
+        const uint64_t key_id = reader.next();
+        if (key_id > UINT32_MAX) {
+            bad_block("Key id out of range in findkey result block");
+        }
+        if (i < out.size()) {
+            out[i] = {static_cast<size_t>(position),
+                      static_cast<uint32_t>(key_id)};
+        }
+    }
+    if (reader.remaining() != 0) {
+        bad_block("Trailing bytes after findkey result block");
+    }
+    return count;
+}
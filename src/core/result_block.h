@@ -0,0 +1,26 @@
+#pragma once
+
+#include "findkey.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+inline constexpr char RESULT_BLOCK_MAGIC[4] = {'F', 'K', 'R', 'B'};
+inline constexpr uint8_t RESULT_BLOCK_VERSION = 1;
+
+/*
+    Magic, version byte, varint result count, then one varint pair per
+    result: the zigzag delta of its position from the previous one (0 for
+    the first), and its key id
+    - LEB128 varints, the same bytes on every machine
+*/
+size_t encoded_results_size(std::span<const findkey_result> results);
+
+// writes the block of results, encoded_results_size(results) bytes, to out
+void encode_results(std::span<const findkey_result> results, uint8_t* out);
+
+// writes the first out.size() results and returns the count in the block;
+// checks the whole block, throws FindkeyError INVALID_ARGUMENT otherwise
+size_t decode_results(std::span<const uint8_t> bytes,
+                      std::span<findkey_result> out);
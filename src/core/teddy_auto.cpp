@@ -0,0 +1,95 @@
+#include "core/teddy_auto.h"
+
+#include "matchers/matcher_teddy_baseline.h"
+#include "teddy/byte_histogram.h"
+#include "teddy/configurations.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <utility>
+
+std::vector<findkey_teddy_config> auto_candidate_configs(
+    const findkey_teddy_config& config) {
+    const std::array suffix_modes = {config.suffix_mode};
+    const std::array verifiers = {config.verifier};
+    const std::array scan_modes = {config.scan_mode};
+
+    std::vector<findkey_teddy_config> candidates =
+        teddy::make_teddy_configurations(
+            teddy::ALL_GROUPING_STRATEGIES, teddy::ALL_GROUPING_SCORES,
+            suffix_modes, teddy::ALL_SIGMAS, verifiers, scan_modes);
+    for (auto& candidate : candidates) {
+        candidate.grouping.byte_histogram = config.grouping.byte_histogram;
+        candidate.grouping.refine_max_passes =
+            config.grouping.refine_max_passes;
+        candidate.grouping.refine_time_limit_ms =
+            config.grouping.refine_time_limit_ms;
+    }
+    return candidates;
+}
+
+TeddyAutoSelection select_teddy_config(
+    std::string_view data,
+    const std::vector<std::string_view>& keys,
+    const findkey_teddy_config& config) {
+    const std::vector<findkey_teddy_config> candidates =
+        auto_candidate_configs(config);
+
+    // one histogram shared by the frequency score and window candidates
+    std::optional<findkey_byte_histogram> histogram;
+    if (!config.grouping.byte_histogram) {
+        histogram = teddy::sample_byte_histogram(data);
+    }
+
+    constexpr uint64_t FAILED = std::numeric_limits<uint64_t>::max();
+    std::vector<teddy::CompilationData> compiled(candidates.size());
+    std::vector<uint64_t> hit_lanes(candidates.size(), FAILED);
+    std::vector<std::exception_ptr> errors(candidates.size());
+
+    std::atomic<size_t> next{0};
+    const auto work = [&] {
+        for (size_t index = next++; index < candidates.size();
+             index = next++) {
+            findkey_teddy_config candidate = candidates[index];
+            if (histogram) {
+                candidate.grouping.byte_histogram = &*histogram;
+            }
+            try {
+                compiled[index] = teddy::compile(keys, candidate);
+                uint64_t hits = 0;
+                teddy::for_each_sample_chunk(
+                    data, AUTO_SAMPLE_BYTES, [&](std::string_view chunk) {
+                        hits +=
+                            prefilter_teddy_baseline(chunk, compiled[index]);
+                    });
+                hit_lanes[index] = hits;
+            } catch (...) {
+                errors[index] = std::current_exception();
+            }
+        }
+    };
+
+    const size_t num_threads = std::clamp<size_t>(
+        std::thread::hardware_concurrency(), 1, candidates.size());
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(num_threads - 1);
+        for (size_t i = 1; i < num_threads; ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+    }
+
+    const auto best = std::min_element(hit_lanes.begin(), hit_lanes.end());
+    const size_t index = best - hit_lanes.begin();
+    if (*best == FAILED) {
+        std::rethrow_exception(errors.front());
+    }
+
+    return {candidates[index], std::move(compiled[index]), *best};
+}
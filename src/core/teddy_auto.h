@@ -0,0 +1,35 @@
+#pragma once
+
+#include "findkey.h"
+#include "teddy/compile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// prefilter sample of TEDDY_COMPILE_AUTO, inputs up to this size in full
+inline constexpr size_t AUTO_SAMPLE_BYTES = size_t{256} << 10;
+
+struct TeddyAutoSelection {
+    findkey_teddy_config config;
+    teddy::CompilationData data;
+    uint64_t sample_hit_lanes = 0;
+};
+
+// every grouping and sigma, the rest taken from config
+std::vector<findkey_teddy_config> auto_candidate_configs(
+    const findkey_teddy_config& config);
+
+/*
+    Compiles every candidate on a thread pool and keeps the one with the
+    fewest baseline prefilter hit lanes over the sample
+    - true matches hit under every candidate, so this ranks candidates by
+      their false positive lanes
+    - candidates that fail to compile are skipped, the error of the first
+      one is rethrown when all of them fail
+*/
+TeddyAutoSelection select_teddy_config(
+    std::string_view data,
+    const std::vector<std::string_view>& keys,
+    const findkey_teddy_config& config);
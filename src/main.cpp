@@ -6,10 +6,12 @@
 #include "io/mmap_file.h"
 #include "teddy/compile.h"
 
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 static std::vector<std::string> read_keys_from_file(const char* keys_file) {
@@ -38,6 +40,96 @@ static std::vector<std::string> read_keys_from_file(const char* keys_file) {
     return keys;
 }
 
+// copied rather than mapped, so a damaged file fails the full trie check
+static findkey_db* load_db_or_exit(const char* db_path,
+                                   const PreparedKeys& keys) {
+    const MMapFile db_file(db_path);
+    int status = FINDKEY_OK;
+    findkey_db* db = findkey_db_deserialize(
+        reinterpret_cast<const uint8_t*>(db_file.data()), db_file.size(),
+        &status);
+    if (status != FINDKEY_OK) {
+        std::fprintf(stderr, "Failed to load database: %s\n", db_path);
+        std::exit(EXIT_FAILURE);
+    }
+    const size_t num_keys = keys.views.size();
+    if (findkey_db_num_keys(db) != num_keys) {
+        std::fprintf(stderr,
+                     "Database %s holds %zu keys, the keys file has %zu\n",
+                     db_path, findkey_db_num_keys(db), num_keys);
+        std::exit(EXIT_FAILURE);
+    }
+    // results are printed by key id, so every id has to name the same key
+    for (uint32_t key_id = 0; key_id < num_keys; ++key_id) {
+        size_t key_len = 0;
+        const uint8_t* key = findkey_db_key(db, key_id, &key_len);
+        if (!key || std::string_view(reinterpret_cast<const char*>(key),
+                                     key_len) != keys.views[key_id]) {
+            std::fprintf(stderr,
+                         "Database %s was saved for other keys, key %u of "
+                         "the keys file is %s\n",
+                         db_path, key_id, keys.keys[key_id].c_str());
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return db;
+}
+
+static void save_db_or_exit(const findkey_db* db, const char* db_path) {
+    std::vector<uint8_t> bytes(findkey_db_serialize(db, nullptr, 0, nullptr));
+    findkey_db_serialize(db, bytes.data(), bytes.size(), nullptr);
+
+    std::ofstream outfile(db_path, std::ios::binary);
+    outfile.write(reinterpret_cast<const char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+    if (!outfile) {
+        std::fprintf(stderr, "Failed to write database: %s\n", db_path);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// loading or compiling the database counts as compile time, counts are
+// only filled in with --count
+static size_t findkey_through_db(const ParsedCliArgs& args,
+                                 const PreparedKeys& keys,
+                                 const MMapFile& data,
+                                 const findkey_teddy_config& teddy_config,
+                                 std::vector<findkey_result>& positions,
+                                 std::vector<uint64_t>& counts,
+                                 int* out_status,
+                                 findkey_timing* out_timing) {
+    const auto* data_bytes = reinterpret_cast<const uint8_t*>(data.data());
+    const auto start = std::chrono::steady_clock::now();
+    findkey_db* db = nullptr;
+    if (args.db_path) {
+        db = load_db_or_exit(args.db_path, keys);
+    } else {
+        db = findkey_db_compile(data_bytes, data.size(), keys.ptrs.data(),
+                                keys.lens.data(), keys.ptrs.size(),
+                                &teddy_config, out_status);
+        if (!db) {
+            return 0;
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    if (args.save_db_path) {
+        save_db_or_exit(db, args.save_db_path);
+    }
+
+    const size_t num_found =
+        args.count
+            ? findkey_db_count(db, data_bytes, data.size(), counts.data(),
+                               out_status, out_timing)
+            : findkey_db_match(db, data_bytes, data.size(), positions.data(),
+                               positions.size(), out_status, out_timing);
+    out_timing->compile_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count();
+    findkey_db_free(db);
+    return num_found;
+}
+
 int main(int argc, char** argv) {
     const ParsedCliArgs args = parse_cli_args_or_exit(argc, argv);
 
@@ -51,33 +143,62 @@ int main(int argc, char** argv) {
     MMapFile mmap_file(args.data_path);
 
     constexpr size_t POSITIONS_CAPACITY = 1024 * 1024;
-    std::vector<findkey_result> positions(POSITIONS_CAPACITY);
+    std::vector<findkey_result> positions(args.count ? 0
+                                                     : POSITIONS_CAPACITY);
+    std::vector<uint64_t> counts(args.count ? keys.ptrs.size() : 0);
     int status = 0;
     findkey_teddy_stats teddy_stats = {};
     findkey_timing timing = {};
     teddy::CompilationMetadata teddy_compilation_metadata = {};
     DFACompilationMetadata dfa_compilation_metadata = {};
 
+    // pinned once, so every step below runs the selected config, a loaded
+    // database already holds one
+    findkey_teddy_config teddy_config = args.teddy_config;
+    if ((args.algo != SCALAR || args.collect_stats) && !args.db_path &&
+        teddy_config.grouping.strategy == TEDDY_COMPILE_AUTO) {
+        findkey_teddy_select_config(
+            reinterpret_cast<const uint8_t*>(mmap_file.data()),
+            mmap_file.size(), keys.ptrs.data(), keys.lens.data(),
+            keys.ptrs.size(), &args.teddy_config, &teddy_config, &status);
+        if (status != FINDKEY_OK) {
+            std::fprintf(stderr, "Failed to select a Teddy config\n");
+            return EXIT_FAILURE;
+        }
+        print_selected_teddy_config(teddy_config);
+    }
+
     if (args.collect_stats) {
         const teddy::CompilationData teddy_data =
-            teddy::compile(keys.views, args.teddy_config);
+            teddy::compile(keys.views, teddy_config);
         const DFA dfa = compile_key_dfa(keys.views);
         teddy_compilation_metadata =
             teddy::get_compilation_metadata(teddy_data);
         dfa_compilation_metadata = get_dfa_compilation_metadata(dfa);
     }
 
-    size_t num_found =
-        args.collect_stats
-            ? findkey_with_stats(
-                  reinterpret_cast<const uint8_t*>(mmap_file.data()),
-                  mmap_file.size(), keys.ptrs.data(), keys.lens.data(),
-                  keys.ptrs.size(), &args.teddy_config, &teddy_stats, &status,
-                  &timing)
-            : findkey(reinterpret_cast<const uint8_t*>(mmap_file.data()),
-                      mmap_file.size(), keys.ptrs.data(), keys.lens.data(),
-                      keys.ptrs.size(), args.algo, &args.teddy_config,
-                      positions.data(), positions.size(), &status, &timing);
+    size_t num_found = 0;
+    if (args.save_db_path || args.db_path) {
+        num_found = findkey_through_db(args, keys, mmap_file, teddy_config,
+                                       positions, counts, &status, &timing);
+    } else if (args.collect_stats) {
+        num_found = findkey_with_stats(
+            reinterpret_cast<const uint8_t*>(mmap_file.data()),
+            mmap_file.size(), keys.ptrs.data(), keys.lens.data(),
+            keys.ptrs.size(), &teddy_config, &teddy_stats, &status, &timing);
+    } else if (args.count) {
+        num_found = findkey_count(
+            reinterpret_cast<const uint8_t*>(mmap_file.data()),
+            mmap_file.size(), keys.ptrs.data(), keys.lens.data(),
+            keys.ptrs.size(), args.algo, &teddy_config, counts.data(), &status,
+            &timing);
+    } else {
+        num_found = findkey(reinterpret_cast<const uint8_t*>(mmap_file.data()),
+                            mmap_file.size(), keys.ptrs.data(),
+                            keys.lens.data(), keys.ptrs.size(), args.algo,
+                            &teddy_config, positions.data(), positions.size(),
+                            &status, &timing);
+    }
 
     const uint64_t total_ns = timing.compile_ns + timing.match_ns;
     const double total_duration_s = total_ns / 1e9;
@@ -118,6 +239,12 @@ int main(int argc, char** argv) {
         }
     }
 
+    // repeated keys count under their first line
+    for (size_t key_id = 0; key_id < counts.size(); ++key_id) {
+        std::printf("\tKey: \"%s\" Count: %llu\n", keys.keys[key_id].c_str(),
+                    static_cast<unsigned long long>(counts[key_id]));
+    }
+
     if (args.collect_stats) {
         print_compilation_stats(teddy_compilation_metadata,
                                 dfa_compilation_metadata);
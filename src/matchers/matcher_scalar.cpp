@@ -1,14 +1,17 @@
 #include "matcher_scalar.h"
+#include "matchers/result_sink.h"
+
 #include <cctype>
 #include <cstring>
 #include <unordered_map>
+#include <utility>
 
-std::vector<findkey_result> matcher_scalar(
-    std::string_view data,
-    const std::vector<std::string_view>& keys) {
-    std::vector<findkey_result> result;
-    result.reserve(1024);  // rough estimate
-
+template <typename Sink>
+void matcher_scalar_into(std::string_view data,
+                         const std::vector<std::string_view>& keys,
+                         Sink& sink,
+                         ResultQuery* query,
+                         size_t start) {
     std::unordered_map<std::string_view, uint32_t> key_map;
     key_map.reserve(keys.size());
 
@@ -25,7 +28,7 @@ std::vector<findkey_result> matcher_scalar(
     bool escape = false;
     size_t position = 0;
 
-    for (size_t i = 0; i < len; ++i) {
+    for (size_t i = start; i < len; ++i) {
         const unsigned char c = static_cast<unsigned char>(str[i]);
 
         if (!in_string) {
@@ -62,11 +65,44 @@ std::vector<findkey_result> matcher_scalar(
             std::string_view sv(str + position, key_length);
             auto it = key_map.find(sv);
             if (it != key_map.end()) {
-                result.push_back(findkey_result{position, it->second});
+                sink.add(position, it->second);
+                if (answered(query, sink)) {
+                    break;
+                }
+                // outside any string, nothing to skip from there
+                sink.checkpoint(i + 1);
             }
         }
         in_string = false;
     }
+}
 
-    return result;
+std::vector<findkey_result> matcher_scalar(
+    std::string_view data,
+    const std::vector<std::string_view>& keys,
+    ResultQuery* query) {
+    ResultVector sink;
+    matcher_scalar_into(data, keys, sink, query);
+    return std::move(sink.results);
 }
+
+template void matcher_scalar_into(std::string_view,
+                                  const std::vector<std::string_view>&,
+                                  ResultVector&,
+                                  ResultQuery*,
+                                  size_t);
+template void matcher_scalar_into(std::string_view,
+                                  const std::vector<std::string_view>&,
+                                  KeyCounts&,
+                                  ResultQuery*,
+                                  size_t);
+template void matcher_scalar_into(std::string_view,
+                                  const std::vector<std::string_view>&,
+                                  ResultBuffer&,
+                                  ResultQuery*,
+                                  size_t);
+template void matcher_scalar_into(std::string_view,
+                                  const std::vector<std::string_view>&,
+                                  ResultColumns&,
+                                  ResultQuery*,
+                                  size_t);
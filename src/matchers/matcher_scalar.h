@@ -1,7 +1,10 @@
 #pragma once
 
+#include "core/query.h"
 #include "findkey.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 #include <vector>
 
@@ -9,7 +12,18 @@
     - Scan the data to find JSON keys
         i.e. enclosed in double quotes and followed by a colon (:)
     - Then check if the key exists in the keys list using a hash map
+    - Stops at the match that answers query
 */
 std::vector<findkey_result> matcher_scalar(
     std::string_view data,
-    const std::vector<std::string_view>& keys);
+    const std::vector<std::string_view>& keys,
+    ResultQuery* query = nullptr);
+
+// matcher_scalar into any sink of matchers/result_sink.h, from position
+// start on, which must lie outside any string
+template <typename Sink>
+void matcher_scalar_into(std::string_view data,
+                         const std::vector<std::string_view>& keys,
+                         Sink& sink,
+                         ResultQuery* query = nullptr,
+                         size_t start = 0);
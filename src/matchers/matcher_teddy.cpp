@@ -1,141 +1,111 @@
 #include "matcher_teddy.h"
 
 #include "core/findkey_error.h"
+#include "matchers/result_sink.h"
+
+#include <utility>
 
 #if COMPILER_SUPPORTS_TEDDY
 
+#include "matchers/matcher_teddy_impl.h"
 #include "teddy/compile.h"
 #include "teddy/dispatch.h"
 #include "teddy/verify.h"
 
-#include <tmmintrin.h>
-
-#include <cstdint>
-#include <cstring>
-
+#include <type_traits>
 #include <vector>
 
 namespace {
 
-template <int Sigma>
-std::vector<findkey_result> matcher_impl(
-    std::string_view data,
-    const teddy::CompilationData& teddy_data,
-    const DFA& dfa) {
-    std::vector<findkey_result> results;
-    results.reserve(1024);  // rough estimate
-
-    const char* str = data.data();
-    const size_t len = data.size();
-
-    __m128i low_vector[Sigma]{};
-    __m128i high_vector[Sigma]{};
-    for (int i = 0; i < Sigma; ++i) {
-        low_vector[i] = _mm_loadu_si128(
-            reinterpret_cast<const __m128i*>(teddy_data.low_table[i]));
-        high_vector[i] = _mm_loadu_si128(
-            reinterpret_cast<const __m128i*>(teddy_data.high_table[i]));
-    }
-
-    // for when the found key isn't alligned
-    __m128i prev_V[Sigma]{};
-    for (int i = 0; i < Sigma; ++i) {
-        prev_V[i] = _mm_set1_epi8(-1);  // 0xFF
-    }
-
-    const __m128i mask_0f = _mm_set1_epi8(0x0F);
-    const __m128i group_mask_vector =
-        _mm_set1_epi8(static_cast<char>((1u << teddy_data.num_groups) - 1u));
-    const __m128i zero_vector = _mm_setzero_si128();
-
-    for (size_t base = 0; base < len; base += 16) {
-        __m128i bytes;
-        if (base + 16 > len) {
-            alignas(16) unsigned char chunk[16];
-            // dummy fill, 0xF reduces false positives
-            std::memset(chunk, 0xFF, sizeof(chunk));
-            std::memcpy(chunk, str + base, len - base);
-            bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk));
-        } else {
-            bytes =
-                _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + base));
-        }
-
-        const __m128i low_nibbles = _mm_and_si128(bytes, mask_0f);
-        const __m128i high_nibbles =
-            _mm_and_si128(_mm_srli_epi16(bytes, 4), mask_0f);
-
-        //  (1) load σ vectors for each character from the transition table
-        __m128i V[Sigma]{};
-        for (int i = 0; i < Sigma; ++i) {
-            const __m128i a = _mm_shuffle_epi8(low_vector[i], low_nibbles);
-            const __m128i b = _mm_shuffle_epi8(high_vector[i], high_nibbles);
-            V[i] = _mm_or_si128(a, b);
-        }
-
-        //  (2) Shift σ − 1 vectors for Bit-Or
-        __m128i shift_or = V[Sigma - 1];
-        for (int i = 0; i < Sigma - 1; ++i) {
-            const int shift_offset = Sigma - 1 - i;
-            // shift V to the right, fill left blank spaces with prev_V
-            const __m128i shifted_V =
-                _mm_alignr_epi8(V[i], prev_V[i], 16 - shift_offset);
-            //  (3) Bit-Or vectors σ − 1 times
-            shift_or = _mm_or_si128(shift_or, shifted_V);
-        }
-
-        __m128i match = _mm_andnot_si128(shift_or, group_mask_vector);
-        __m128i is_zero = _mm_cmpeq_epi8(match, zero_vector);
-        uint16_t hit_mask = ~static_cast<uint16_t>(_mm_movemask_epi8(is_zero));
-
-        while (hit_mask) {
-            const int i = __builtin_ctz(hit_mask);
-            hit_mask &= hit_mask - 1;
-
-            if (base + i >= len) {
-                break;
-            }
-
-            const size_t last_char = base + i;
-            const size_t end_quote = last_char + teddy_data.end_quote_offset;
-
-            const teddy::candidate_result cr =
-                teddy::verify_json_key_candidate(str, len, end_quote, dfa);
-            if (cr.type == teddy::CANDIDATE_TYPE_MATCH) {
-                results.push_back({cr.position, cr.key_id});
-            }
-        }
-
-        for (int i = 0; i < Sigma; ++i) {
-            prev_V[i] = V[i];
-        }
-    }
-
-    return results;
+// out of line: inlined into the dispatch every scan loop lands in one
+// function too large for the verifiers to be inlined
+template <typename Shape, typename Verifier, typename Sink>
+[[gnu::noinline]] void scan_shape(std::string_view data,
+                                  const teddy::CompilationData& teddy_data,
+                                  Verifier verify,
+                                  Sink& sink,
+                                  ResultQuery* query,
+                                  size_t start) {
+    teddy::scan_impl<Shape>(data, teddy_data, verify, sink, query, start);
 }
 
 }  // namespace
 
-std::vector<findkey_result> matcher_teddy(
-    std::string_view data,
-    const teddy::CompilationData& teddy_data,
-    const DFA& dfa) {
-    return teddy::dispatch_sigma(teddy_data.sigma, [&]<int Sigma>() {
-        return matcher_impl<Sigma>(data, teddy_data, dfa);
+template <typename Sink>
+void matcher_teddy_into(std::string_view data,
+                        const teddy::CompilationData& teddy_data,
+                        const DFA& dfa,
+                        Sink& sink,
+                        ResultQuery* query,
+                        size_t start) {
+    teddy::dispatch_kernel(teddy_data, [&]<typename Shape>() {
+        teddy::dispatch_verifier<Shape::sigma>(
+            teddy_data, dfa, [&](const auto& verify) {
+                using Verifier = std::decay_t<decltype(verify)>;
+                if constexpr (Verifier::BATCHED && resumable_sink<Sink>) {
+                    scan_shape<Shape>(data, teddy_data,
+                                      teddy::DfaVerifier(dfa), sink, query,
+                                      start);
+                } else {
+                    scan_shape<Shape>(data, teddy_data, verify, sink, query,
+                                      start);
+                }
+            });
     });
 }
 
 #else
 
-std::vector<findkey_result> matcher_teddy(
-    std::string_view data,
-    const teddy::CompilationData& teddy_data,
-    const DFA& dfa) {
+template <typename Sink>
+void matcher_teddy_into(std::string_view data,
+                        const teddy::CompilationData& teddy_data,
+                        const DFA& dfa,
+                        Sink& sink,
+                        ResultQuery* query,
+                        size_t start) {
     (void)data;
     (void)teddy_data;
     (void)dfa;
+    (void)sink;
+    (void)query;
+    (void)start;
     throw FindkeyError(FindkeyErrorCode::NOT_SUPPORTED,
                        "Teddy is not supported by this compiler");
 }
 
 #endif
+
+std::vector<findkey_result> matcher_teddy(
+    std::string_view data,
+    const teddy::CompilationData& teddy_data,
+    const DFA& dfa,
+    ResultQuery* query) {
+    ResultVector sink;
+    matcher_teddy_into(data, teddy_data, dfa, sink, query);
+    return std::move(sink.results);
+}
+
+template void matcher_teddy_into(std::string_view,
+                                 const teddy::CompilationData&,
+                                 const DFA&,
+                                 ResultVector&,
+                                 ResultQuery*,
+                                 size_t);
+template void matcher_teddy_into(std::string_view,
+                                 const teddy::CompilationData&,
+                                 const DFA&,
+                                 KeyCounts&,
+                                 ResultQuery*,
+                                 size_t);
+template void matcher_teddy_into(std::string_view,
+                                 const teddy::CompilationData&,
+                                 const DFA&,
+                                 ResultBuffer&,
+                                 ResultQuery*,
+                                 size_t);
+template void matcher_teddy_into(std::string_view,
+                                 const teddy::CompilationData&,
+                                 const DFA&,
+                                 ResultColumns&,
+                                 ResultQuery*,
+                                 size_t);
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "core/key_dfa.h"
+#include "core/query.h"
 #include "findkey.h"
 #include "teddy/compile.h"
 
+#include <cstddef>
 #include <string_view>
 #include <vector>
 
@@ -12,8 +14,20 @@
     - For each potential match, veryfy if it's a valid key in JSON format
         i.e. enclosed in double quotes and followed by a colon (:)
     - Then check if the key exists in the keys list using a hash map
+    - Checks query between blocks, see teddy::scan_impl
 */
 std::vector<findkey_result> matcher_teddy(
     std::string_view data,
     const teddy::CompilationData& teddy_data,
-    const DFA& dfa);
+    const DFA& dfa,
+    ResultQuery* query = nullptr);
+
+// matcher_teddy into any sink of matchers/result_sink.h, from the block
+// boundary start on
+template <typename Sink>
+void matcher_teddy_into(std::string_view data,
+                        const teddy::CompilationData& teddy_data,
+                        const DFA& dfa,
+                        Sink& sink,
+                        ResultQuery* query = nullptr,
+                        size_t start = 0);
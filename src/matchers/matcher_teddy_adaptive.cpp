@@ -0,0 +1,392 @@
+#include "matcher_teddy_adaptive.h"
+
+#include "core/findkey_error.h"
+#include "matchers/result_sink.h"
+
+#include <utility>
+
+#if COMPILER_SUPPORTS_TEDDY
+
+#include "matchers/teddy_kernel.h"
+#include "teddy/compile.h"
+#include "teddy/dispatch.h"
+#include "teddy/verify.h"
+
+#include <tmmintrin.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// density is measured over windows of 256 blocks (4 KiB)
+constexpr size_t WINDOW_BYTES = 4096;
+
+// rejected Teddy candidates per window: leave Teddy at or above HIGH, and
+// only forget earlier dense windows below LOW
+constexpr uint32_t REJECT_HIGH = 512;
+constexpr uint32_t REJECT_LOW = 128;
+
+// tokenizer windows before probing Teddy again, doubled every time the probe
+// is still dense
+constexpr size_t MAX_TOKENIZER_WINDOWS = 64;
+
+inline void count_reject(findkey_teddy_stats& stats,
+                         teddy::candidate_type type) {
+    switch (type) {
+        case teddy::CANDIDATE_BAD_END_QUOTE:
+            ++stats.reject_bad_end_quote;
+            break;
+        case teddy::CANDIDATE_INVALID_QUOTE:
+            ++stats.reject_invalid_quote;
+            break;
+        case teddy::CANDIDATE_MISSING_COLON:
+            ++stats.reject_missing_colon;
+            break;
+        case teddy::CANDIDATE_MISSING_OPEN_QUOTE:
+            ++stats.reject_missing_open_quote;
+            break;
+        case teddy::CANDIDATE_KEY_NOT_FOUND:
+            ++stats.reject_key_not_found;
+            break;
+        default:
+            break;
+    }
+}
+
+template <int Sigma, bool CollectStats, typename Verifier, typename Sink>
+void matcher_impl(std::string_view data,
+                  const teddy::CompilationData& teddy_data,
+                  const DFA& dfa,
+                  Verifier verify,
+                  Sink& sink,
+                  struct findkey_teddy_stats* stats,
+                  ResultQuery* query) {
+    const char* str = data.data();
+    const size_t len = data.size();
+
+    // one block past the one that answers query, see teddy::matcher_impl
+    size_t scan_end = len;
+    const auto check_query = [&](size_t base) {
+        if (scan_end == len && answered(query, sink)) {
+            scan_end = std::min(len, base + 32);
+        }
+    };
+
+    teddy::TeddyKernel<Sigma> kernel(teddy_data);
+    const bool windowed = !teddy_data.key_window_offsets.empty();
+
+    // one past the closing quote of the key the candidate at `end_quote`
+    // belongs to, matched or not, 0 if it is not a key; a prefix candidate
+    // is the hit, sigma - 1 bytes after the opening quote
+    const auto past_key = [&](size_t end_quote) -> size_t {
+        if (teddy_data.prefix) {
+            const size_t sigma = static_cast<size_t>(teddy_data.sigma);
+            if (end_quote + 1 < sigma) {
+                return 0;
+            }
+            const size_t open_quote = end_quote + 1 - sigma;
+            if (str[open_quote] != '"' ||
+                !teddy::is_valid_quote(str, open_quote)) {
+                return 0;
+            }
+            end_quote = teddy::closing_quote(str, len, open_quote + 1);
+        }
+        return teddy::verify_json_key_terminator(str, len, end_quote) ==
+                       teddy::CANDIDATE_TYPE_MATCH
+                   ? end_quote + 1
+                   : 0;
+    };
+
+    /*
+        Reports keys whose closing quote is at or after `position`, returns
+        where the tokenizer takes over, or len
+        - in a dense window any key hands off, matched or not, one past its
+          closing quote
+        - candidates from later blocks may end before that, so blocks are
+          scanned on until none can, reporting only what ends before it
+    */
+    const auto scan_teddy = [&](size_t position, bool probing,
+                                size_t& tokenizer_windows) {
+        // restart one block early so windows straddling `position` are seen
+        kernel.reset();
+        size_t base = position >= 16 ? position - 16 : 0;
+        bool leave = false;
+        size_t handoff = len;
+
+        while (base < scan_end) {
+            const size_t window_end = base + WINDOW_BYTES;
+            uint32_t rejects = 0;
+
+            for (; base < scan_end && base < window_end; base += 16) {
+                if (base + teddy_data.end_quote_offset >= handoff) {
+                    return handoff;
+                }
+
+                uint16_t hit_mask = kernel.scan(str, len, base);
+                uint8_t lane_groups[16];
+                if (windowed && hit_mask) {
+                    kernel.store_lane_groups(lane_groups);
+                }
+
+                while (hit_mask) {
+                    const int i = __builtin_ctz(hit_mask);
+                    hit_mask &= hit_mask - 1;
+
+                    if (base + i >= len) {
+                        break;
+                    }
+
+                    const uint8_t groups =
+                        windowed ? lane_groups[i] : uint8_t{0};
+                    for (uint32_t offsets = teddy::hit_window_offsets(
+                             teddy_data, groups, str, len,
+                             base + i + teddy_data.end_quote_offset);
+                         offsets != 0; offsets &= offsets - 1) {
+                        const uint32_t offset = __builtin_ctz(offsets);
+                        const size_t end_quote =
+                            base + i + teddy_data.end_quote_offset + offset;
+                        if (end_quote < position || end_quote >= handoff) {
+                            continue;
+                        }
+
+                        const teddy::candidate_result cr =
+                            teddy::at_window_offset(
+                                teddy_data, verify(str, len, end_quote),
+                                offset);
+                        if constexpr (CollectStats) {
+                            ++stats->prefilter_hit_lanes;
+                        }
+
+                        if (cr.type != teddy::CANDIDATE_TYPE_MATCH) {
+                            ++rejects;
+                            if constexpr (CollectStats) {
+                                count_reject(*stats, cr.type);
+                            }
+                        } else {
+                            sink.add(cr.position, cr.key_id);
+                            if constexpr (CollectStats) {
+                                ++stats->exact_matches;
+                            }
+                        }
+
+                        if (leave && handoff == len) {
+                            if (const size_t next = past_key(end_quote)) {
+                                handoff = next;
+                            }
+                        }
+                    }
+                }
+
+                check_query(base);
+            }
+
+            if (rejects >= REJECT_HIGH) {
+                if (probing) {
+                    tokenizer_windows =
+                        std::min(2 * tokenizer_windows, MAX_TOKENIZER_WINDOWS);
+                }
+                leave = true;
+            } else {
+                if (rejects < REJECT_LOW) {
+                    tokenizer_windows = 1;
+                }
+                leave = false;
+            }
+            probing = false;
+        }
+
+        return handoff;
+    };
+
+    // starts outside of a string, returns the first block boundary outside
+    // of a string after `budget` bytes, or len
+    const auto scan_tokenizer = [&](size_t start, size_t budget) {
+        const __m128i quote_vector = _mm_set1_epi8('"');
+        const __m128i backslash_vector = _mm_set1_epi8('\\');
+
+        bool in_string = false;
+        size_t escaped = len;
+
+        for (size_t base = start; base < scan_end; base += 16) {
+            __m128i bytes;
+            if (base + 16 > len) {
+                alignas(16) unsigned char chunk[16] = {};
+                std::memcpy(chunk, str + base, len - base);
+                bytes =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk));
+            } else {
+                bytes = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(str + base));
+            }
+
+            const uint32_t quotes = static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote_vector)));
+            const uint32_t backslashes = static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, backslash_vector)));
+
+            uint32_t special = quotes | backslashes;
+            while (special) {
+                const int i = __builtin_ctz(special);
+                special &= special - 1;
+
+                const size_t position = base + i;
+                if (position == escaped) {
+                    continue;
+                }
+                if ((backslashes >> i) & 1u) {
+                    if (in_string) {
+                        escaped = position + 1;
+                    }
+                    continue;
+                }
+                if (!in_string) {
+                    in_string = true;
+                    continue;
+                }
+
+                // closing quote, same verification as a Teddy candidate;
+                // a prefix verifier wants the hit, so walk the reverse trie
+                in_string = false;
+                const teddy::candidate_result cr =
+                    teddy_data.prefix
+                        ? teddy::verify_json_key_candidate(str, len, position,
+                                                           dfa)
+                        : verify(str, len, position);
+                if (cr.type == teddy::CANDIDATE_TYPE_MATCH) {
+                    sink.add(cr.position, cr.key_id);
+                    if constexpr (CollectStats) {
+                        ++stats->exact_matches;
+                    }
+                }
+            }
+
+            check_query(base);
+            if (!in_string && base + 16 - start >= budget) {
+                return std::min(base + 16, len);
+            }
+        }
+
+        return len;
+    };
+
+    size_t position = 0;
+    size_t tokenizer_windows = 1;
+    bool probing = false;
+
+    while (position < scan_end) {
+        position = scan_teddy(position, probing, tokenizer_windows);
+        if (position >= scan_end) {
+            break;
+        }
+
+        const size_t tokenizer_start = position;
+        position = scan_tokenizer(position, tokenizer_windows * WINDOW_BYTES);
+        probing = true;
+
+        if constexpr (CollectStats) {
+            ++stats->switches_to_tokenizer;
+            stats->tokenizer_bytes += position - tokenizer_start;
+            if (position < len) {
+                ++stats->switches_to_teddy;
+            }
+        }
+    }
+}
+
+template <int Sigma, typename Verifier, typename Sink>
+void run_matcher(std::string_view data,
+                 const teddy::CompilationData& teddy_data,
+                 const DFA& dfa,
+                 const Verifier& verify,
+                 Sink& sink,
+                 struct findkey_teddy_stats* stats,
+                 ResultQuery* query) {
+    if (stats) {
+        matcher_impl<Sigma, true>(data, teddy_data, dfa, verify, sink, stats,
+                                  query);
+    } else {
+        matcher_impl<Sigma, false>(data, teddy_data, dfa, verify, sink,
+                                   nullptr, query);
+    }
+}
+
+}  // namespace
+
+template <typename Sink>
+void matcher_teddy_adaptive_into(std::string_view data,
+                                 const teddy::CompilationData& teddy_data,
+                                 const DFA& dfa,
+                                 Sink& sink,
+                                 struct findkey_teddy_stats* stats,
+                                 ResultQuery* query) {
+    teddy::dispatch_sigma(teddy_data.sigma, [&]<int Sigma>() {
+        teddy::dispatch_verifier<Sigma>(
+            teddy_data, dfa, [&](const auto& verify) {
+                using Verifier = std::decay_t<decltype(verify)>;
+                // a handoff needs every verdict before the next candidate
+                if constexpr (Verifier::BATCHED) {
+                    run_matcher<Sigma>(data, teddy_data, dfa,
+                                       teddy::DfaVerifier(dfa), sink, stats,
+                                       query);
+                } else {
+                    run_matcher<Sigma>(data, teddy_data, dfa, verify, sink,
+                                       stats, query);
+                }
+            });
+    });
+}
+
+#else
+
+template <typename Sink>
+void matcher_teddy_adaptive_into(std::string_view data,
+                                 const teddy::CompilationData& teddy_data,
+                                 const DFA& dfa,
+                                 Sink& sink,
+                                 struct findkey_teddy_stats* stats,
+                                 ResultQuery* query) {
+    (void)data;
+    (void)teddy_data;
+    (void)dfa;
+    (void)sink;
+    (void)stats;
+    (void)query;
+    throw FindkeyError(FindkeyErrorCode::NOT_SUPPORTED,
+                       "Teddy is not supported by this compiler");
+}
+
+#endif
+
+std::vector<findkey_result> matcher_teddy_adaptive(
+    std::string_view data,
+    const teddy::CompilationData& teddy_data,
+    const DFA& dfa,
+    struct findkey_teddy_stats* stats,
+    ResultQuery* query) {
+    ResultVector sink;
+    matcher_teddy_adaptive_into(data, teddy_data, dfa, sink, stats, query);
+    return std::move(sink.results);
+}
+
+template void matcher_teddy_adaptive_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          ResultVector&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*);
+template void matcher_teddy_adaptive_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          KeyCounts&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*);
+template void matcher_teddy_adaptive_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          ResultColumns&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/key_dfa.h"
+#include "core/query.h"
+#include "findkey.h"
+#include "teddy/compile.h"
+
+#include <string_view>
+#include <vector>
+
+/*
+    - Runs matcher_teddy until a window of candidates is mostly rejected,
+      then tokenizes strings with SIMD quote/backslash masks instead
+    - Hands control back to Teddy after an exponentially growing number of
+      tokenizer windows to probe the density again
+    - Switches only where the string state is known: after the closing quote
+      of a verified key, or at a block boundary outside of a string
+    - Checks query between blocks of either scan, as matcher_teddy does
+*/
+std::vector<findkey_result> matcher_teddy_adaptive(
+    std::string_view data,
+    const teddy::CompilationData& teddy_data,
+    const DFA& dfa,
+    struct findkey_teddy_stats* stats = nullptr,
+    ResultQuery* query = nullptr);
+
+// matcher_teddy_adaptive into the sinks of matchers/result_sink.h but
+// ResultBuffer, which needs block boundaries the tokenizer does not keep
+template <typename Sink>
+void matcher_teddy_adaptive_into(std::string_view data,
+                                 const teddy::CompilationData& teddy_data,
+                                 const DFA& dfa,
+                                 Sink& sink,
+                                 struct findkey_teddy_stats* stats = nullptr,
+                                 ResultQuery* query = nullptr);
@@ -1,4 +1,5 @@
 #include "matcher_teddy_baseline.h"
+#include "matchers/result_sink.h"
 #include "teddy/compile.h"
 #include "teddy/dispatch.h"
 #include "teddy/verify.h"
@@ -7,76 +8,51 @@
 #include <cctype>
 #include <cstring>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace {
 
-template <int Sigma, bool CollectStats>
-std::vector<findkey_result> matcher_impl(
-    std::string_view data,
-    const teddy::CompilationData& teddy_data,
-    const DFA& dfa,
-    struct findkey_teddy_stats* stats) {
-    std::vector<findkey_result> results;
-    results.reserve(1024);  // rough estimate
+// groups whose suffix may end at position
+template <int Sigma>
+uint8_t prefilter_hits(const char* str,
+                       size_t position,
+                       const teddy::CompilationData& teddy_data,
+                       uint8_t group_mask) {
+    uint8_t shift_or = 0;
+
+    for (int i = 0; i < Sigma; ++i) {
+        const uint8_t c = static_cast<uint8_t>(str[position - Sigma + 1 + i]);
+        const uint8_t low_nibble = c & 0x0F;
+        const uint8_t high_nibble = (c >> 4) & 0x0F;
+
+        shift_or |= teddy_data.low_table[i][low_nibble] |
+                    teddy_data.high_table[i][high_nibble];
+    }
+
+    return ~shift_or & group_mask;
+}
 
+template <int Sigma, bool CollectStats, typename Verifier, typename Sink>
+void matcher_impl(std::string_view data,
+                  const teddy::CompilationData& teddy_data,
+                  Verifier verify,
+                  Sink& sink,
+                  struct findkey_teddy_stats* stats,
+                  ResultQuery* query,
+                  size_t start = 0) {
     const char* str = data.data();
     const size_t len = data.size();
 
-    const uint8_t group_mask = (1u << teddy_data.num_groups) - 1u;
-
-    for (size_t position = Sigma - 1; position < len; ++position) {
-        uint8_t shift_or = 0;
-
-        for (int i = 0; i < Sigma; ++i) {
-            const uint8_t c =
-                static_cast<uint8_t>(str[position - Sigma + 1 + i]);
-            const uint8_t low_nibble = c & 0x0F;
-            const uint8_t high_nibble = (c >> 4) & 0x0F;
-
-            shift_or |= teddy_data.low_table[i][low_nibble] |
-                        teddy_data.high_table[i][high_nibble];
-        }
-
-        const uint8_t hits = ~shift_or & group_mask;
-
-        if (!hits) {
-            continue;
-        }
-
-        bool any_exact_suffix = false;
-        if constexpr (CollectStats) {
-            if (stats) {
-                ++stats->prefilter_hit_lanes;
-                stats->prefilter_hit_groups += __builtin_popcount(hits);
-
-                uint8_t suffix[Sigma];
-                for (int i = 0; i < Sigma; ++i) {
-                    suffix[i] =
-                        static_cast<uint8_t>(str[position - Sigma + 1 + i]);
-                }
-
-                uint8_t group_hits = hits;
-                while (group_hits) {
-                    const uint32_t group = __builtin_ctz(group_hits);
-                    group_hits &= group_hits - 1;
-
-                    if (teddy::group_has_exact_suffix<Sigma>(teddy_data, group,
-                                                             suffix)) {
-                        any_exact_suffix = true;
-                    } else {
-                        ++stats->fp_type1_groups;
-                    }
-                }
-            }
-        }
-
-        const size_t end_quote = position + teddy_data.end_quote_offset;
+    // tag: window offset << 1 | any exact suffix
+    const auto handle = [&](const teddy::candidate_result& verified,
+                            uint32_t tag) {
         const teddy::candidate_result cr =
-            teddy::verify_json_key_candidate(str, len, end_quote, dfa);
-
+            teddy::at_window_offset(teddy_data, verified, tag >> 1);
+        const bool any_exact_suffix = tag & 1u;
         if (cr.type == teddy::CANDIDATE_TYPE_MATCH) {
-            results.push_back({cr.position, cr.key_id});
+            sink.add(cr.position, cr.key_id);
             if constexpr (CollectStats) {
                 if (stats) {
                     ++stats->exact_matches;
@@ -112,24 +88,152 @@ std::vector<findkey_result> matcher_impl(
                 }
             }
         }
+    };
+
+    const uint8_t group_mask = (1u << teddy_data.num_groups) - 1u;
+
+    size_t scan_end = len;
+    for (size_t position = std::max<size_t>(start, Sigma - 1);
+         position < scan_end; ++position) {
+        sink.checkpoint(position);
+        // 16 more positions once answered, see teddy::matcher_impl
+        if (position % 16 == 0 && scan_end == len &&
+            answered(query, sink)) {
+            scan_end = std::min(len, position + 16);
+        }
+
+        const uint8_t hits =
+            prefilter_hits<Sigma>(str, position, teddy_data, group_mask);
+
+        if (!hits) {
+            continue;
+        }
+
+        bool any_exact_suffix = false;
+        if constexpr (CollectStats) {
+            if (stats) {
+                ++stats->prefilter_hit_lanes;
+                stats->prefilter_hit_groups += __builtin_popcount(hits);
+
+                uint8_t suffix[Sigma];
+                for (int i = 0; i < Sigma; ++i) {
+                    suffix[i] =
+                        static_cast<uint8_t>(str[position - Sigma + 1 + i]);
+                }
+
+                // suffixes are unique, so at most one group holds it
+                const int exact_group =
+                    teddy::exact_suffix_group<Sigma>(teddy_data, suffix);
+                any_exact_suffix =
+                    exact_group >= 0 && ((hits >> exact_group) & 1u);
+                stats->fp_type1_groups +=
+                    __builtin_popcount(hits) - (any_exact_suffix ? 1 : 0);
+            }
+        }
+
+        for (uint32_t offsets = teddy::hit_window_offsets(
+                 teddy_data, hits, str, len,
+                 position + teddy_data.end_quote_offset);
+             offsets != 0; offsets &= offsets - 1) {
+            const uint32_t offset = __builtin_ctz(offsets);
+            const size_t end_quote =
+                position + teddy_data.end_quote_offset + offset;
+            const uint32_t tag = offset << 1 | any_exact_suffix;
+            if constexpr (Verifier::BATCHED) {
+                verify.submit(str, len, end_quote, tag, handle);
+            } else {
+                handle(verify(str, len, end_quote), tag);
+            }
+        }
     }
 
-    return results;
+    if constexpr (Verifier::BATCHED) {
+        verify.flush(str, handle);
+    }
 }
 
 }  // namespace
 
+template <typename Sink>
+void matcher_teddy_baseline_into(std::string_view data,
+                                 const teddy::CompilationData& teddy_data,
+                                 const DFA& dfa,
+                                 Sink& sink,
+                                 struct findkey_teddy_stats* stats,
+                                 ResultQuery* query,
+                                 size_t start) {
+    teddy::dispatch_sigma(teddy_data.sigma, [&]<int Sigma>() {
+        teddy::dispatch_verifier<Sigma>(
+            teddy_data, dfa, [&](const auto& verify) {
+                const auto run = [&](const auto& verifier) {
+                    if (stats) {
+                        matcher_impl<Sigma, true>(data, teddy_data, verifier,
+                                                  sink, stats, query, start);
+                    } else {
+                        matcher_impl<Sigma, false>(data, teddy_data, verifier,
+                                                   sink, nullptr, query,
+                                                   start);
+                    }
+                };
+                using Verifier = std::decay_t<decltype(verify)>;
+                if constexpr (Verifier::BATCHED && resumable_sink<Sink>) {
+                    run(teddy::DfaVerifier(dfa));
+                } else {
+                    run(verify);
+                }
+            });
+    });
+}
+
 std::vector<findkey_result> matcher_teddy_baseline(
     std::string_view data,
     const teddy::CompilationData& teddy_data,
     const DFA& dfa,
-    struct findkey_teddy_stats* stats) {
-    if (stats) {
-        return teddy::dispatch_sigma(teddy_data.sigma, [&]<int Sigma>() {
-            return matcher_impl<Sigma, true>(data, teddy_data, dfa, stats);
-        });
-    }
+    struct findkey_teddy_stats* stats,
+    ResultQuery* query) {
+    ResultVector sink;
+    matcher_teddy_baseline_into(data, teddy_data, dfa, sink, stats, query);
+    return std::move(sink.results);
+}
+
+template void matcher_teddy_baseline_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          ResultVector&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*,
+                                          size_t);
+template void matcher_teddy_baseline_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          KeyCounts&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*,
+                                          size_t);
+template void matcher_teddy_baseline_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          ResultBuffer&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*,
+                                          size_t);
+template void matcher_teddy_baseline_into(std::string_view,
+                                          const teddy::CompilationData&,
+                                          const DFA&,
+                                          ResultColumns&,
+                                          struct findkey_teddy_stats*,
+                                          ResultQuery*,
+                                          size_t);
+
+uint64_t prefilter_teddy_baseline(std::string_view data,
+                                  const teddy::CompilationData& teddy_data) {
     return teddy::dispatch_sigma(teddy_data.sigma, [&]<int Sigma>() {
-        return matcher_impl<Sigma, false>(data, teddy_data, dfa, nullptr);
+        const uint8_t group_mask = (1u << teddy_data.num_groups) - 1u;
+        uint64_t hit_lanes = 0;
+        for (size_t position = Sigma - 1; position < data.size(); ++position) {
+            hit_lanes += prefilter_hits<Sigma>(data.data(), position,
+                                               teddy_data, group_mask) != 0;
+        }
+        return hit_lanes;
     });
 }
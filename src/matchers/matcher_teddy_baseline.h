@@ -1,18 +1,38 @@
 #pragma once
 
 #include "core/key_dfa.h"
+#include "core/query.h"
 #include "findkey.h"
 #include "teddy/compile.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 #include <vector>
 
 /*
     Acts as baseline teddy matcher without SIMD for matcher_teddy.cpp
+    - checks query every 16 positions, like the blocks of matcher_teddy
 */
 
 std::vector<findkey_result> matcher_teddy_baseline(
     std::string_view data,
     const teddy::CompilationData& teddy_data,
     const DFA& dfa,
-    struct findkey_teddy_stats* stats = nullptr);
+    struct findkey_teddy_stats* stats = nullptr,
+    ResultQuery* query = nullptr);
+
+// matcher_teddy_baseline into any sink of matchers/result_sink.h, from
+// position start on
+template <typename Sink>
+void matcher_teddy_baseline_into(std::string_view data,
+                                 const teddy::CompilationData& teddy_data,
+                                 const DFA& dfa,
+                                 Sink& sink,
+                                 struct findkey_teddy_stats* stats = nullptr,
+                                 ResultQuery* query = nullptr,
+                                 size_t start = 0);
+
+// prefilter_hit_lanes of matcher_teddy_baseline, without verifying
+uint64_t prefilter_teddy_baseline(std::string_view data,
+                                  const teddy::CompilationData& teddy_data);
@@ -0,0 +1,128 @@
+#pragma once
+
+// only include from translation units compiled with -mssse3
+
+#include "core/query.h"
+#include "findkey.h"
+#include "matchers/result_sink.h"
+#include "matchers/teddy_kernel.h"
+#include "teddy/dispatch.h"
+#include "teddy/verify.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace teddy {
+
+/*
+    Teddy scan of data, every hit is checked by verify and matches go to sink
+    - Shape is a KernelShape, what it leaves ANY is read from teddy_data
+    - Data is a CompilationData, or the constant tables of a matcher
+      generated by tools/generate_matcher.cpp, which the compiler folds
+    - Verifier::BATCHED verifiers get submit() and flush() calls instead
+    - once query is answered one more block is scanned, a hit may verify a
+      key ending up to MAX_WINDOW_OFFSET bytes into it
+    - start: a block boundary, the block before it is scanned for the
+      kernel state only; every block is a sink checkpoint
+*/
+template <typename Shape, typename Data, typename Verifier, typename Sink>
+void scan_impl(std::string_view data,
+               const Data& teddy_data,
+               Verifier verify,
+               Sink& sink,
+               ResultQuery* query = nullptr,
+               size_t start = 0) {
+    // tag: window offset
+    const auto handle = [&](const candidate_result& verified, uint32_t tag) {
+        const candidate_result cr = at_window_offset(teddy_data, verified, tag);
+        if (cr.type == CANDIDATE_TYPE_MATCH) {
+            sink.add(cr.position, cr.key_id);
+        }
+    };
+
+    const char* str = data.data();
+    const size_t len = data.size();
+
+    TeddyKernel<Shape::sigma, Shape::full_groups> kernel(teddy_data);
+    const bool known_suffix = Shape::suffix != SuffixClass::ANY;
+    const size_t end_quote_offset = known_suffix
+                                        ? Shape::end_quote_offset
+                                        : teddy_data.end_quote_offset;
+    const bool windowed = known_suffix
+                              ? Shape::windowed
+                              : !teddy_data.key_window_offsets.empty();
+
+    if (start >= 16) {
+        kernel.scan(str, len, start - 16);
+    }
+
+    size_t scan_end = len;
+    for (size_t base = start; base < scan_end; base += 16) {
+        sink.checkpoint(base);
+        uint16_t hit_mask = kernel.scan(str, len, base);
+        uint8_t lane_groups[16];
+        if (windowed && hit_mask) {
+            kernel.store_lane_groups(lane_groups);
+        }
+
+        while (hit_mask) {
+            const int i = __builtin_ctz(hit_mask);
+            hit_mask &= hit_mask - 1;
+
+            if (base + i >= len) {
+                break;
+            }
+
+            const size_t last_char = base + i;
+            if (windowed) {
+                for (uint32_t offsets = hit_window_offsets(
+                         teddy_data, lane_groups[i], str, len,
+                         last_char + end_quote_offset);
+                     offsets != 0; offsets &= offsets - 1) {
+                    const uint32_t offset = __builtin_ctz(offsets);
+                    const size_t end_quote =
+                        last_char + end_quote_offset + offset;
+                    if constexpr (Verifier::BATCHED) {
+                        verify.submit(str, len, end_quote, offset, handle);
+                    } else {
+                        handle(verify(str, len, end_quote), offset);
+                    }
+                }
+                continue;
+            }
+
+            const size_t end_quote = last_char + end_quote_offset;
+
+            if constexpr (Verifier::BATCHED) {
+                verify.submit(str, len, end_quote, 0, handle);
+            } else {
+                handle(verify(str, len, end_quote), 0);
+            }
+        }
+
+        if (scan_end == len && answered(query, sink)) {
+            scan_end = std::min(len, base + 32);
+        }
+    }
+
+    if constexpr (Verifier::BATCHED) {
+        verify.flush(str, handle);
+    }
+}
+
+// scan_impl into a ResultVector
+template <typename Shape, typename Data, typename Verifier>
+std::vector<findkey_result> matcher_impl(std::string_view data,
+                                         const Data& teddy_data,
+                                         Verifier verify,
+                                         ResultQuery* query = nullptr) {
+    ResultVector sink;
+    scan_impl<Shape>(data, teddy_data, verify, sink, query);
+    return std::move(sink.results);
+}
+
+}  // namespace teddy
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "core/query.h"
+#include "findkey.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/*
+    Where the matchers put verified keys
+    - ResultVector keeps every (position, key id) pair, as findkey returns
+    - KeyCounts only bumps the counter of the key id, nothing is allocated
+    - ResultBuffer writes into the caller's array, see findkey_with_cursor
+    - ResultColumns into the caller's columns, see findkey_columns
+    - matchers call checkpoint() where a scan may restart and find the same
+      matches again, the others ignore it
+*/
+struct ResultVector {
+    std::vector<findkey_result> results;
+
+    ResultVector() { results.reserve(1024); }  // rough estimate
+
+    void add(size_t position, uint32_t key_id) {
+        results.push_back({position, key_id});
+    }
+
+    void checkpoint(size_t) {}
+};
+
+struct KeyCounts {
+    std::span<uint64_t> counts;
+
+    void add(size_t, uint32_t key_id) { ++counts[key_id]; }
+
+    void checkpoint(size_t) {}
+};
+
+/*
+    - the first cursor.skip matches found from cursor.offset were returned
+      by an earlier call
+    - once out is full the next match is dropped, next() resumes at the
+      last checkpoint with every match found since then skipped
+*/
+class ResultBuffer {
+   public:
+    ResultBuffer(std::span<findkey_result> out, const findkey_cursor& cursor)
+        : out_(out), restart_(cursor.offset), skip_(cursor.skip) {}
+
+    void add(size_t position, uint32_t key_id) {
+        if (full_) {
+            return;
+        }
+        if (found_ < skip_) {
+            ++found_;
+            return;
+        }
+        if (size_ == out_.size()) {
+            full_ = true;
+            return;
+        }
+        out_[size_++] = {position, key_id};
+        ++found_;
+    }
+
+    void checkpoint(size_t offset) {
+        if (!full_ && offset != restart_) {
+            restart_ = offset;
+            found_ = 0;
+            skip_ = 0;
+        }
+    }
+
+    bool full() const { return full_; }
+    size_t size() const { return size_; }
+
+    // len: the size of the scanned data
+    findkey_cursor next(size_t len) const {
+        if (full_) {
+            return {restart_, found_, 0};
+        }
+        return {len, 0, 1};
+    }
+
+   private:
+    std::span<findkey_result> out_;
+    size_t size_ = 0;
+    size_t restart_;
+    // matches found since restart_, returned or skipped
+    size_t found_ = 0;
+    size_t skip_;
+    bool full_ = false;
+};
+
+// the first out.capacity matches in findkey's order, counts every one
+class ResultColumns {
+   public:
+    explicit ResultColumns(const findkey_result_columns& out) : out_(out) {}
+
+    void add(size_t position, uint32_t key_id) {
+        if (size_ < out_.capacity) {
+            if (out_.positions32) {
+                out_.positions32[size_] = static_cast<uint32_t>(position);
+            } else {
+                out_.positions[size_] = position;
+            }
+            if (out_.key_ids16) {
+                out_.key_ids16[size_] = static_cast<uint16_t>(key_id);
+            } else {
+                out_.key_ids[size_] = key_id;
+            }
+        }
+        ++size_;
+    }
+
+    void checkpoint(size_t) {}
+
+    size_t size() const { return size_; }
+
+   private:
+    findkey_result_columns out_;
+    size_t size_ = 0;
+};
+
+// a ResultBuffer needs every match in the block that checkpointed it, so
+// scans into it verify one candidate at a time
+template <typename Sink>
+inline constexpr bool resumable_sink = std::is_same_v<Sink, ResultBuffer>;
+
+inline bool answered(ResultQuery* query, ResultVector& sink) {
+    return query && query->done(sink.results);
+}
+
+// counting reads every match, there is no query
+inline bool answered(ResultQuery*, KeyCounts&) {
+    return false;
+}
+
+inline bool answered(ResultQuery*, ResultBuffer& sink) {
+    return sink.full();
+}
+
+// counts every match like findkey, there is no query either
+inline bool answered(ResultQuery*, ResultColumns&) {
+    return false;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+// only include from translation units compiled with -mssse3
+
+#include "teddy/compile.h"
+
+#include <tmmintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace teddy {
+
+/*
+    SSSE3 Teddy prefilter over 16-byte blocks
+    - scan() returns one bit per lane whose sigma-byte window may end a key
+    - blocks must be scanned in order, reset() forgets the previous block
+      so the scan can restart anywhere
+    - FullGroups: every group is in use, the groups past num_groups need no
+      masking out
+*/
+template <int Sigma, bool FullGroups = false>
+class TeddyKernel {
+   public:
+    // Tables: CompilationData, or the constant tables of a generated matcher
+    template <typename Tables>
+    explicit TeddyKernel(const Tables& teddy_data)
+        : group_mask_vector_(_mm_set1_epi8(
+              static_cast<char>((1u << teddy_data.num_groups) - 1u))) {
+        for (int i = 0; i < Sigma; ++i) {
+            low_vector_[i] = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(teddy_data.low_table[i]));
+            high_vector_[i] = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(teddy_data.high_table[i]));
+        }
+        reset();
+    }
+
+    void reset() {
+        // for when the found key isn't alligned
+        for (int i = 0; i < Sigma; ++i) {
+            prev_V_[i] = _mm_set1_epi8(-1);  // 0xFF
+        }
+    }
+
+    uint16_t scan(const char* str, size_t len, size_t base) {
+        __m128i bytes;
+        if (base + 16 > len) {
+            alignas(16) unsigned char chunk[16];
+            // dummy fill, 0xF reduces false positives
+            std::memset(chunk, 0xFF, sizeof(chunk));
+            std::memcpy(chunk, str + base, len - base);
+            bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk));
+        } else {
+            bytes =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + base));
+        }
+
+        const __m128i mask_0f = _mm_set1_epi8(0x0F);
+        const __m128i low_nibbles = _mm_and_si128(bytes, mask_0f);
+        const __m128i high_nibbles =
+            _mm_and_si128(_mm_srli_epi16(bytes, 4), mask_0f);
+
+        //  (1) load σ vectors for each character from the transition table
+        __m128i V[Sigma]{};
+        for (int i = 0; i < Sigma; ++i) {
+            const __m128i a = _mm_shuffle_epi8(low_vector_[i], low_nibbles);
+            const __m128i b = _mm_shuffle_epi8(high_vector_[i], high_nibbles);
+            V[i] = _mm_or_si128(a, b);
+        }
+
+        //  (2) Shift σ − 1 vectors for Bit-Or
+        __m128i shift_or = V[Sigma - 1];
+        for (int i = 0; i < Sigma - 1; ++i) {
+            const int shift_offset = Sigma - 1 - i;
+            // shift V to the right, fill left blank spaces with prev_V
+            const __m128i shifted_V =
+                _mm_alignr_epi8(V[i], prev_V_[i], 16 - shift_offset);
+            //  (3) Bit-Or vectors σ − 1 times
+            shift_or = _mm_or_si128(shift_or, shifted_V);
+        }
+
+        for (int i = 0; i < Sigma; ++i) {
+            prev_V_[i] = V[i];
+        }
+
+        shift_or_ = shift_or;
+        if constexpr (FullGroups) {
+            // a lane misses when all of its group bits are set
+            const __m128i missed =
+                _mm_cmpeq_epi8(shift_or, _mm_set1_epi8(-1));
+            return ~static_cast<uint16_t>(_mm_movemask_epi8(missed));
+        } else {
+            const __m128i is_zero = _mm_cmpeq_epi8(
+                _mm_andnot_si128(shift_or, group_mask_vector_),
+                _mm_setzero_si128());
+            return ~static_cast<uint16_t>(_mm_movemask_epi8(is_zero));
+        }
+    }
+
+    // groups hit at every lane of the last scanned block
+    void store_lane_groups(uint8_t (&groups)[16]) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(groups),
+                         _mm_andnot_si128(shift_or_, group_mask_vector_));
+    }
+
+   private:
+    __m128i low_vector_[Sigma]{};
+    __m128i high_vector_[Sigma]{};
+    __m128i prev_V_[Sigma]{};
+    __m128i group_mask_vector_;
+    __m128i shift_or_ = _mm_set1_epi8(-1);
+};
+
+}  // namespace teddy
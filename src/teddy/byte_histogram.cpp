@@ -0,0 +1,23 @@
+#include "teddy/byte_histogram.h"
+
+#include <cstdint>
+
+namespace teddy {
+
+static void count_bytes(std::string_view bytes,
+                        findkey_byte_histogram& histogram) {
+    for (const char c : bytes) {
+        ++histogram.counts[static_cast<uint8_t>(c)];
+    }
+}
+
+findkey_byte_histogram sample_byte_histogram(std::string_view data) {
+    findkey_byte_histogram histogram{};
+    for_each_sample_chunk(data, HISTOGRAM_SAMPLE_BYTES,
+                          [&](std::string_view chunk) {
+                              count_bytes(chunk, histogram);
+                          });
+    return histogram;
+}
+
+}  // namespace teddy
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "findkey.h"
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+namespace teddy {
+
+// inputs up to this size are counted in full
+inline constexpr size_t HISTOGRAM_SAMPLE_BYTES = size_t{1} << 20;
+inline constexpr size_t HISTOGRAM_CHUNK_BYTES = 4096;
+
+// chunks spread evenly over data, sample_bytes in total, or all of data
+template <typename Visit>
+void for_each_sample_chunk(std::string_view data,
+                           size_t sample_bytes,
+                           Visit&& visit) {
+    if (data.size() <= sample_bytes) {
+        std::forward<Visit>(visit)(data);
+        return;
+    }
+
+    const size_t num_chunks = sample_bytes / HISTOGRAM_CHUNK_BYTES;
+    const size_t stride = data.size() / num_chunks;
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        visit(data.substr(chunk * stride, HISTOGRAM_CHUNK_BYTES));
+    }
+}
+
+/*
+    Byte counts for TEDDY_GROUPING_SCORE_FREQUENCY
+    - larger inputs are sampled in HISTOGRAM_CHUNK_BYTES chunks spread
+      evenly over the whole input, HISTOGRAM_SAMPLE_BYTES in total
+*/
+findkey_byte_histogram sample_byte_histogram(std::string_view data);
+
+}  // namespace teddy
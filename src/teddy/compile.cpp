@@ -3,7 +3,9 @@
 #include "core/findkey_error.h"
 #include "teddy/dispatch.h"
 #include "teddy/grouping.h"
+#include "teddy/window.h"
 
+#include <algorithm>
 #include <utility>
 
 namespace teddy {
@@ -44,16 +46,83 @@ static void build_compilation_tables(CompilationData& data) {
     }
 }
 
+// suffixes are already grouped
+static CompilationData assemble(
+    SuffixSet suffixes,
+    std::vector<std::vector<uint32_t>> group_suffix_ids) {
+    CompilationData data{};
+    data.sigma = suffixes.sigma;
+    data.end_quote_offset = suffixes.end_quote_offset;
+    data.prefix = suffixes.prefix;
+    data.suffixes = std::move(suffixes.data);
+    data.group_suffix_ids = std::move(group_suffix_ids);
+    data.num_groups = static_cast<int>(data.group_suffix_ids.size());
+
+    // windows that all end at the key end match like TEDDY_SUFFIX_RAW
+    if (std::all_of(suffixes.key_window_offsets.begin(),
+                    suffixes.key_window_offsets.end(),
+                    [](uint8_t offset) { return offset == 0; })) {
+        suffixes.key_window_offsets.clear();
+    }
+    data.key_window_offsets = std::move(suffixes.key_window_offsets);
+    data.group_window_offsets.fill(1);
+    if (!data.key_window_offsets.empty()) {
+        data.window_offsets = 0;
+        for (int group = 0; group < data.num_groups; ++group) {
+            uint8_t offsets = 0;
+            for (uint32_t suffix_id : data.group_suffix_ids[group]) {
+                offsets |= suffixes.suffix_window_offsets[suffix_id];
+            }
+            data.group_window_offsets[group] = offsets;
+            data.window_offsets |= offsets;
+        }
+    }
+
+    dispatch_sigma(data.sigma,
+                   [&]<int Sigma>() { build_compilation_tables<Sigma>(data); });
+
+    return data;
+}
+
 CompilationData compile(const std::vector<std::string_view>& keys,
                         const findkey_teddy_config& config) {
+    if (config.verifier < 0 ||
+        config.verifier >= FINDKEY_TEDDY_VERIFIER_COUNT) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Unknown Teddy verifier");
+    }
+    if (config.scan_mode < 0 ||
+        config.scan_mode >= FINDKEY_TEDDY_SCAN_MODE_COUNT) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Unknown Teddy scan mode");
+    }
+
     SuffixSet suffixes = prepare_suffixes(keys, config);
-    return compile(std::move(suffixes), config.grouping);
+    std::vector<uint32_t> key_suffix_ids = suffixes.key_suffix_ids;
+
+    CompilationData data = compile(suffixes, config.grouping);
+    if (config.suffix_mode == TEDDY_SUFFIX_WINDOW) {
+        WindowAssignment assignment =
+            shift_windows(keys, suffixes, data.group_suffix_ids,
+                          config.grouping.byte_histogram);
+        key_suffix_ids = assignment.suffixes.key_suffix_ids;
+        data = assemble(std::move(assignment.suffixes),
+                        std::move(assignment.group_suffix_ids));
+    }
+
+    data.verifier = config.verifier;
+    if (data.prefix) {
+        data.forward_dfa = compile_forward_key_dfa(keys);
+    } else if (data.verifier == TEDDY_VERIFY_SUFFIX_TABLE) {
+        data.suffix_table =
+            build_suffix_table(keys, key_suffix_ids, data.suffixes,
+                               data.group_suffix_ids, data.sigma);
+    }
+    return data;
 }
 
 CompilationData compile(SuffixSet suffixes,
                         findkey_teddy_grouping_config grouping_config) {
-    CompilationData data{};
-
     if (suffixes.sigma <= 0 || suffixes.sigma > FINDKEY_TEDDY_MAX_SIGMA) {
         throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
                            "Compiled Teddy suffix length is out of range");
@@ -67,18 +136,9 @@ CompilationData compile(SuffixSet suffixes,
                            "Invalid Teddy end quote offset");
     }
 
-    data.sigma = suffixes.sigma;
-    data.end_quote_offset = suffixes.end_quote_offset;
-    data.suffixes = std::move(suffixes.data);
-    data.group_suffix_ids =
-        build_groups(data.suffixes, grouping_config, data.sigma);
-
-    data.num_groups = static_cast<int>(data.group_suffix_ids.size());
-
-    dispatch_sigma(data.sigma,
-                   [&]<int Sigma>() { build_compilation_tables<Sigma>(data); });
-
-    return data;
+    std::vector<std::vector<uint32_t>> group_suffix_ids =
+        build_groups(suffixes.data, grouping_config, suffixes.sigma);
+    return assemble(std::move(suffixes), std::move(group_suffix_ids));
 }
 
 CompilationMetadata get_compilation_metadata(const CompilationData& data) {
@@ -88,4 +148,31 @@ CompilationMetadata get_compilation_metadata(const CompilationData& data) {
     };
 }
 
+double group_pass_rate(const CompilationData& data,
+                       int group,
+                       const Suffix* added) {
+    const uint8_t mask = static_cast<uint8_t>(1u << group);
+    double rate = 1.0;
+    for (int i = 0; i < data.sigma; ++i) {
+        int low = 0;
+        int high = 0;
+        for (int nibble = 0; nibble < 16; ++nibble) {
+            low += !(data.low_table[i][nibble] & mask) ||
+                   (added && ((*added)[i] & 0x0F) == nibble);
+            high += !(data.high_table[i][nibble] & mask) ||
+                    (added && ((*added)[i] >> 4) == nibble);
+        }
+        rate *= (low / 16.0) * (high / 16.0);
+    }
+    return rate;
+}
+
+double estimated_pass_rate(const CompilationData& data) {
+    double rate = 0;
+    for (int group = 0; group < data.num_groups; ++group) {
+        rate += group_pass_rate(data, group);
+    }
+    return rate;
+}
+
 }  // namespace teddy
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "core/key_dfa.h"
 #include "findkey.h"
 #include "teddy/suffix.h"
+#include "teddy/suffix_table.h"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <string_view>
@@ -22,6 +25,7 @@ struct CompilationData {
     // offset from last character to the closing quote
     // 1 for RAW mode
     // 0 for QUOTED mode
+    // 0 for PREFIX mode, whose verifier starts from the last character
     size_t end_quote_offset = 1;
 
     alignas(16) uint8_t low_table[FINDKEY_TEDDY_MAX_SIGMA][16] = {};
@@ -29,6 +33,25 @@ struct CompilationData {
 
     std::vector<Suffix> suffixes;
     std::vector<std::vector<uint32_t>> group_suffix_ids;
+
+    findkey_teddy_verifier verifier = TEDDY_VERIFY_DFA;
+
+    // empty unless TEDDY_SUFFIX_WINDOW moved some window off the key end:
+    // bytes between the window and the end of every key, a hit of group g
+    // is verified at every offset k set in group_window_offsets[g], on top
+    // of end_quote_offset
+    std::vector<uint8_t> key_window_offsets;
+    std::array<uint8_t, MAX_GROUPS> group_window_offsets{};
+    // union over all groups
+    uint8_t window_offsets = 1;
+
+    // only built for TEDDY_VERIFY_SUFFIX_TABLE
+    SuffixTable suffix_table;
+
+    // TEDDY_SUFFIX_PREFIX only: hits are verified forward from the opening
+    // quote through forward_dfa, whatever the verifier
+    bool prefix = false;
+    DFA forward_dfa;
 };
 
 struct CompilationMetadata {
@@ -44,4 +67,13 @@ CompilationData compile(SuffixSet suffixes,
 
 CompilationMetadata get_compilation_metadata(const CompilationData& data);
 
+// chance that a window of uniformly random bytes passes the masks of group,
+// nibbles taken as independent, with `added` in the group when given
+double group_pass_rate(const CompilationData& data,
+                       int group,
+                       const Suffix* added = nullptr);
+
+// expected hit groups per input byte over uniformly random input
+double estimated_pass_rate(const CompilationData& data);
+
 }  // namespace teddy
@@ -13,11 +13,12 @@ std::vector<findkey_teddy_grouping_config> make_grouping_configurations(
     for (const auto strategy : strategies) {
         if (grouping::grouping_strategy_uses_score(strategy)) {
             for (const auto score : scores) {
-                configurations.push_back({strategy, score});
+                configurations.push_back({strategy, score, nullptr, 0, 0});
             }
             continue;
         }
-        configurations.push_back({strategy, TEDDY_GROUPING_SCORE_PAPER});
+        configurations.push_back(
+            {strategy, TEDDY_GROUPING_SCORE_PAPER, nullptr, 0, 0});
     }
 
     return configurations;
@@ -32,17 +33,25 @@ std::vector<findkey_teddy_config> make_teddy_configurations(
     std::span<const findkey_teddy_compile_grouping_strategy> strategies,
     std::span<const findkey_teddy_grouping_score> scores,
     std::span<const findkey_teddy_suffix_mode> suffix_modes,
-    std::span<const int> sigmas) {
+    std::span<const int> sigmas,
+    std::span<const findkey_teddy_verifier> verifiers,
+    std::span<const findkey_teddy_scan_mode> scan_modes) {
     const auto groupings = make_grouping_configurations(strategies, scores);
 
     std::vector<findkey_teddy_config> configurations;
     configurations.reserve(groupings.size() * suffix_modes.size() *
-                           sigmas.size());
+                           sigmas.size() * verifiers.size() *
+                           scan_modes.size());
 
     for (const auto grouping : groupings) {
         for (const auto suffix_mode : suffix_modes) {
             for (const int sigma : sigmas) {
-                configurations.push_back({grouping, suffix_mode, sigma});
+                for (const auto verifier : verifiers) {
+                    for (const auto scan_mode : scan_modes) {
+                        configurations.push_back({grouping, suffix_mode, sigma,
+                                                  verifier, scan_mode});
+                    }
+                }
             }
         }
     }
@@ -53,7 +62,8 @@ std::vector<findkey_teddy_config> make_teddy_configurations(
 std::vector<findkey_teddy_config> all_teddy_configurations() {
     return make_teddy_configurations(ALL_GROUPING_STRATEGIES,
                                      ALL_GROUPING_SCORES, ALL_SUFFIX_MODES,
-                                     ALL_SIGMAS);
+                                     ALL_SIGMAS, ALL_VERIFIERS,
+                                     ALL_SCAN_MODES);
 }
 
 }  // namespace teddy
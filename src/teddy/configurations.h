@@ -19,17 +19,36 @@ inline constexpr std::array ALL_GROUPING_STRATEGIES = {
     TEDDY_COMPILE_SORTED_SUFFIX_ROUND_ROBIN,
     TEDDY_COMPILE_SORTED_SUFFIX_PARTITION,
     TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION,
+    TEDDY_COMPILE_BRANCH_AND_BOUND,
+    TEDDY_COMPILE_NIBBLE_CLUSTERING,
 };
 
 inline constexpr std::array ALL_GROUPING_SCORES = {
     TEDDY_GROUPING_SCORE_PAPER,
     TEDDY_GROUPING_SCORE_PAPER_NIBBLE,
     TEDDY_GROUPING_SCORE_NIBBLE_COUNT,
+    TEDDY_GROUPING_SCORE_FREQUENCY,
 };
 
 inline constexpr std::array ALL_SUFFIX_MODES = {
     TEDDY_SUFFIX_RAW,
     TEDDY_SUFFIX_QUOTED,
+    TEDDY_SUFFIX_WINDOW,
+    TEDDY_SUFFIX_PREFIX,
+    TEDDY_SUFFIX_AUTO,
+};
+
+inline constexpr std::array ALL_VERIFIERS = {
+    TEDDY_VERIFY_DFA,
+    TEDDY_VERIFY_SUFFIX_TABLE,
+    TEDDY_VERIFY_TOP_TRIE,
+    TEDDY_VERIFY_PIPELINED,
+    TEDDY_VERIFY_SWAR,
+};
+
+inline constexpr std::array ALL_SCAN_MODES = {
+    TEDDY_SCAN_FIXED,
+    TEDDY_SCAN_ADAPTIVE,
 };
 
 inline constexpr auto ALL_SIGMAS = [] {
@@ -44,6 +63,8 @@ static_assert(ALL_GROUPING_STRATEGIES.size() ==
               FINDKEY_TEDDY_COMPILE_GROUPING_STRATEGY_COUNT);
 static_assert(ALL_GROUPING_SCORES.size() == FINDKEY_TEDDY_GROUPING_SCORE_COUNT);
 static_assert(ALL_SUFFIX_MODES.size() == FINDKEY_TEDDY_SUFFIX_MODE_COUNT);
+static_assert(ALL_VERIFIERS.size() == FINDKEY_TEDDY_VERIFIER_COUNT);
+static_assert(ALL_SCAN_MODES.size() == FINDKEY_TEDDY_SCAN_MODE_COUNT);
 
 std::vector<findkey_teddy_grouping_config> make_grouping_configurations(
     std::span<const findkey_teddy_compile_grouping_strategy> strategies,
@@ -55,7 +76,9 @@ std::vector<findkey_teddy_config> make_teddy_configurations(
     std::span<const findkey_teddy_compile_grouping_strategy> strategies,
     std::span<const findkey_teddy_grouping_score> scores,
     std::span<const findkey_teddy_suffix_mode> suffix_modes,
-    std::span<const int> sigmas);
+    std::span<const int> sigmas,
+    std::span<const findkey_teddy_verifier> verifiers,
+    std::span<const findkey_teddy_scan_mode> scan_modes);
 
 std::vector<findkey_teddy_config> all_teddy_configurations();
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "core/findkey_error.h"
+#include "teddy/compile.h"
 
+#include <cstddef>
 #include <utility>
 
 namespace teddy {
@@ -25,4 +27,62 @@ decltype(auto) dispatch_sigma(int sigma, Function&& function) {
     }
 }
 
+// ANY: read from CompilationData at runtime
+enum class GroupCount {
+    ANY,
+    FULL,  // all MAX_GROUPS groups, the kernel needs no group mask
+};
+
+enum class SuffixClass {
+    ANY,
+    RAW,       // closing quote right after the hit
+    QUOTED,    // the hit ends on the closing quote, also TEDDY_SUFFIX_PREFIX
+    WINDOWED,  // TEDDY_SUFFIX_WINDOW with windows off the key ends
+};
+
+/*
+    What a Teddy scan knows at compile time, see dispatch_kernel
+    - end_quote_offset and windowed only hold for a known SuffixClass
+*/
+template <int Sigma, GroupCount Groups, SuffixClass Suffix>
+struct KernelShape {
+    static constexpr int sigma = Sigma;
+    static constexpr GroupCount groups = Groups;
+    static constexpr SuffixClass suffix = Suffix;
+
+    static constexpr bool full_groups = Groups == GroupCount::FULL;
+    static constexpr size_t end_quote_offset =
+        Suffix == SuffixClass::QUOTED ? 0 : 1;
+    static constexpr bool windowed = Suffix == SuffixClass::WINDOWED;
+};
+
+template <int Sigma>
+using AnyKernelShape = KernelShape<Sigma, GroupCount::ANY, SuffixClass::ANY>;
+
+// calls function.template operator()<KernelShape>() with the sigma, group
+// count class and suffix class of data
+template <typename Function>
+decltype(auto) dispatch_kernel(const CompilationData& data,
+                               Function&& function) {
+    return dispatch_sigma(data.sigma, [&]<int Sigma>() -> decltype(auto) {
+        const auto with_groups =
+            [&]<GroupCount Groups>() -> decltype(auto) {
+            if (!data.key_window_offsets.empty()) {
+                return function.template operator()<
+                    KernelShape<Sigma, Groups, SuffixClass::WINDOWED>>();
+            }
+            if (data.end_quote_offset == 0) {
+                return function.template operator()<
+                    KernelShape<Sigma, Groups, SuffixClass::QUOTED>>();
+            }
+            return function.template operator()<
+                KernelShape<Sigma, Groups, SuffixClass::RAW>>();
+        };
+        if (data.num_groups == MAX_GROUPS) {
+            return with_groups.template operator()<GroupCount::FULL>();
+        }
+        return with_groups.template operator()<GroupCount::ANY>();
+    });
+}
+
 }  // namespace teddy
@@ -2,65 +2,135 @@
 
 #include "core/findkey_error.h"
 #include "teddy/dispatch.h"
+#include "teddy/grouping/branch_and_bound.h"
 #include "teddy/grouping/builder.h"
+#include "teddy/grouping/clustering.h"
 #include "teddy/grouping/greedy.h"
 #include "teddy/grouping/hash.h"
+#include "teddy/grouping/refine.h"
 #include "teddy/grouping/scores/dispatch.h"
 #include "teddy/grouping/sorted.h"
 
+#include <chrono>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
 namespace teddy {
 
+// FrequencyScore groups are seeded with the input byte frequencies
+template <grouping::GroupingScore ScoreModel>
+static ScoreModel make_empty_score(
+    const std::optional<grouping::ByteFrequencies>& frequencies) {
+    if constexpr (std::is_constructible_v<ScoreModel,
+                                          const grouping::ByteFrequencies&>) {
+        return ScoreModel(*frequencies);
+    } else {
+        return ScoreModel{};
+    }
+}
+
+template <int Sigma>
+static grouping::GroupedSuffixIds build_strategy_groups(
+    const std::vector<Suffix>& suffixes,
+    findkey_teddy_grouping_config grouping_config,
+    const std::optional<grouping::ByteFrequencies>& frequencies) {
+    switch (grouping_config.strategy) {
+        case TEDDY_COMPILE_GREEDY_PAPER_POLICY:
+            return grouping::dispatch_grouping_score<Sigma>(
+                grouping_config.score,
+                [&]<grouping::GroupingScore ScoreModel>() {
+                    return grouping::GreedyGroupingBuilder<
+                               Sigma, ScoreModel,
+                               grouping::GreedySelectionPolicy::Paper>(
+                               suffixes,
+                               make_empty_score<ScoreModel>(frequencies))
+                        .build();
+                });
+        case TEDDY_COMPILE_GREEDY_MIN_DELTA:
+            return grouping::dispatch_grouping_score<Sigma>(
+                grouping_config.score,
+                [&]<grouping::GroupingScore ScoreModel>() {
+                    return grouping::GreedyGroupingBuilder<
+                               Sigma, ScoreModel,
+                               grouping::GreedySelectionPolicy::MinDelta>(
+                               suffixes,
+                               make_empty_score<ScoreModel>(frequencies))
+                        .build();
+                });
+        case TEDDY_COMPILE_HASH_STD:
+        case TEDDY_COMPILE_HASH_ADLER32:
+        case TEDDY_COMPILE_HASH_CRC32:
+        case TEDDY_COMPILE_HASH_XXHASH:
+        case TEDDY_COMPILE_HASH_FNV1A:
+            return grouping::HashGroupingBuilder<Sigma>(
+                       suffixes, grouping_config.strategy)
+                .build();
+        case TEDDY_COMPILE_SORTED_SUFFIX_ROUND_ROBIN:
+        case TEDDY_COMPILE_SORTED_SUFFIX_PARTITION:
+            return grouping::SortedGroupingBuilder<Sigma>(
+                       suffixes, grouping_config.strategy)
+                .build();
+        case TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION:
+            return grouping::dispatch_grouping_score<Sigma>(
+                grouping_config.score,
+                [&]<grouping::GroupingScore ScoreModel>() {
+                    return grouping::SortedOptimalGroupingBuilder<Sigma,
+                                                                  ScoreModel>(
+                               suffixes,
+                               make_empty_score<ScoreModel>(frequencies))
+                        .build();
+                });
+        case TEDDY_COMPILE_BRANCH_AND_BOUND:
+            return grouping::dispatch_grouping_score<Sigma>(
+                grouping_config.score,
+                [&]<grouping::GroupingScore ScoreModel>() {
+                    return grouping::BranchAndBoundGroupingBuilder<Sigma,
+                                                                   ScoreModel>(
+                               suffixes,
+                               make_empty_score<ScoreModel>(frequencies))
+                        .build();
+                });
+        case TEDDY_COMPILE_NIBBLE_CLUSTERING:
+            return grouping::ClusteringGroupingBuilder<Sigma>(suffixes).build();
+        default:
+            throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                               "Unknown Teddy grouping strategy");
+    }
+}
+
 std::vector<std::vector<uint32_t>> build_groups(
     const std::vector<Suffix>& suffixes,
     findkey_teddy_grouping_config grouping_config,
     int sigma) {
+    std::optional<grouping::ByteFrequencies> frequencies;
+    if (grouping_config.score == TEDDY_GROUPING_SCORE_FREQUENCY) {
+        if (grouping_config.byte_histogram) {
+            frequencies.emplace(*grouping_config.byte_histogram);
+        } else {
+            frequencies.emplace();
+        }
+    }
+
     return dispatch_sigma(sigma, [&]<int Sigma>() {
-        switch (grouping_config.strategy) {
-            case TEDDY_COMPILE_GREEDY_PAPER_POLICY:
-                return grouping::dispatch_grouping_score<Sigma>(
-                    grouping_config.score,
-                    [&]<grouping::GroupingScore ScoreModel>() {
-                        return grouping::GreedyGroupingBuilder<
-                                   Sigma, ScoreModel,
-                                   grouping::GreedySelectionPolicy::Paper>(
-                                   suffixes)
-                            .build();
-                    });
-            case TEDDY_COMPILE_GREEDY_MIN_DELTA:
-                return grouping::dispatch_grouping_score<Sigma>(
-                    grouping_config.score,
-                    [&]<grouping::GroupingScore ScoreModel>() {
-                        return grouping::GreedyGroupingBuilder<
-                                   Sigma, ScoreModel,
-                                   grouping::GreedySelectionPolicy::MinDelta>(
-                                   suffixes)
-                            .build();
-                    });
-            case TEDDY_COMPILE_HASH_STD:
-            case TEDDY_COMPILE_HASH_ADLER32:
-            case TEDDY_COMPILE_HASH_CRC32:
-            case TEDDY_COMPILE_HASH_XXHASH:
-            case TEDDY_COMPILE_HASH_FNV1A:
-                return grouping::HashGroupingBuilder<Sigma>(
-                           suffixes, grouping_config.strategy)
-                    .build();
-            case TEDDY_COMPILE_SORTED_SUFFIX_ROUND_ROBIN:
-            case TEDDY_COMPILE_SORTED_SUFFIX_PARTITION:
-                return grouping::SortedGroupingBuilder<Sigma>(
-                           suffixes, grouping_config.strategy)
-                    .build();
-            case TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION:
-                return grouping::dispatch_grouping_score<Sigma>(
-                    grouping_config.score,
-                    [&]<grouping::GroupingScore ScoreModel>() {
-                        return grouping::SortedOptimalGroupingBuilder<
-                                   Sigma, ScoreModel>(suffixes)
-                            .build();
-                    });
-            default:
-                throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
-                                   "Unknown Teddy grouping strategy");
+        grouping::GroupedSuffixIds group_suffix_ids =
+            build_strategy_groups<Sigma>(suffixes, grouping_config,
+                                         frequencies);
+        if (grouping_config.refine_max_passes == 0) {
+            return group_suffix_ids;
         }
+
+        // refined with the configured score, whatever the strategy
+        return grouping::dispatch_grouping_score<Sigma>(
+            grouping_config.score,
+            [&]<grouping::GroupingScore ScoreModel>() {
+                return grouping::LocalSearchRefiner<Sigma, ScoreModel>(
+                           suffixes, make_empty_score<ScoreModel>(frequencies),
+                           grouping_config.refine_max_passes,
+                           std::chrono::milliseconds(
+                               grouping_config.refine_time_limit_ms))
+                    .refine(std::move(group_suffix_ids));
+            });
     });
 }
 
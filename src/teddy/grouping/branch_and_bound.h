@@ -0,0 +1,175 @@
+#pragma once
+
+#include "teddy/compile.h"
+#include "teddy/grouping/builder.h"
+#include "teddy/grouping/greedy.h"
+#include "teddy/grouping/score.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace teddy::grouping {
+
+/*
+    Exact minimum total score over every assignment into min(suffixes,
+    MAX_GROUPS) groups, the group count the other strategies produce
+    - suffixes are placed one by one into a used group or the first unused
+      one, so group relabelings are never enumerated twice
+    - scores only grow as groups grow, so a branch is cut when its total
+      plus the cheapest placement of some remaining suffix is no better
+      than the best assignment so far
+    - the MinDelta greedy grouping is the starting bound and the fallback
+      above MAX_EXACT_SUFFIXES suffixes or MAX_NODES search nodes, which
+      keeps the result deterministic
+*/
+template <int Sigma, GroupingScore ScoreModel>
+class BranchAndBoundGroupingBuilder final : public GroupingBuilder<Sigma> {
+   public:
+    static constexpr size_t MAX_EXACT_SUFFIXES = 24;
+    static constexpr uint64_t MAX_NODES = uint64_t{1} << 18;
+
+    explicit BranchAndBoundGroupingBuilder(
+        const std::vector<Suffix>& suffixes,
+        const ScoreModel& empty_score = {})
+        : GroupingBuilder<Sigma>(suffixes, TEDDY_COMPILE_BRANCH_AND_BOUND),
+          empty_score_(empty_score) {}
+
+    GroupedSuffixIds build() const {
+        GroupedSuffixIds greedy =
+            GreedyGroupingBuilder<Sigma, ScoreModel,
+                                  GreedySelectionPolicy::MinDelta>(
+                this->suffixes_, empty_score_)
+                .build();
+        const size_t num_suffixes = this->suffixes_.size();
+        if (num_suffixes > MAX_EXACT_SUFFIXES) {
+            return greedy;
+        }
+
+        Search search{};
+        search.num_groups = std::min(num_suffixes, size_t{MAX_GROUPS});
+        search.group_of.assign(num_suffixes, 0);
+        search.best_group_of.assign(num_suffixes, 0);
+        search.groups.fill(empty_score_);
+        search.best_total = 0;
+        for (uint32_t group = 0; group < greedy.size(); ++group) {
+            ScoreModel score = empty_score_;
+            for (const uint32_t suffix_id : greedy[group]) {
+                score.add(this->suffixes_[suffix_id]);
+                search.best_group_of[suffix_id] = group;
+            }
+            search.best_total += score.value();
+        }
+
+        // costly suffixes first, they tighten the bound early
+        search.order.resize(num_suffixes);
+        std::iota(search.order.begin(), search.order.end(), uint32_t{0});
+        std::stable_sort(search.order.begin(), search.order.end(),
+                         [&](uint32_t left, uint32_t right) {
+                             return singleton_value(left) >
+                                    singleton_value(right);
+                         });
+
+        search_from(search, 0, 0, 0);
+        if (!search.improved) {
+            return greedy;
+        }
+
+        GroupedSuffixIds group_suffix_ids(MAX_GROUPS);
+        for (uint32_t suffix_id = 0; suffix_id < num_suffixes; ++suffix_id) {
+            group_suffix_ids[search.best_group_of[suffix_id]].push_back(
+                suffix_id);
+        }
+        std::erase_if(group_suffix_ids,
+                      [](const auto& group) { return group.empty(); });
+        return group_suffix_ids;
+    }
+
+   private:
+    struct Search {
+        std::vector<uint32_t> order;
+        std::array<ScoreModel, MAX_GROUPS> groups;
+        std::array<uint64_t, MAX_GROUPS> values{};
+        std::vector<uint32_t> group_of;
+        std::vector<uint32_t> best_group_of;
+        size_t num_groups = 0;
+        uint64_t best_total = 0;
+        uint64_t nodes = 0;
+        bool improved = false;
+    };
+
+    uint64_t singleton_value(uint32_t suffix_id) const noexcept {
+        ScoreModel score = empty_score_;
+        score.add(this->suffixes_[suffix_id]);
+        return score.value();
+    }
+
+    // cheapest placement of any single remaining suffix
+    uint64_t lower_bound(const Search& search,
+                         size_t depth,
+                         size_t used) const noexcept {
+        uint64_t bound = 0;
+        for (size_t next = depth; next < search.order.size(); ++next) {
+            const Suffix& suffix = this->suffixes_[search.order[next]];
+            uint64_t cheapest = used < search.num_groups
+                                    ? singleton_value(search.order[next])
+                                    : std::numeric_limits<uint64_t>::max();
+            for (size_t group = 0; group < used && cheapest != 0; ++group) {
+                ScoreModel grown = search.groups[group];
+                grown.add(suffix);
+                cheapest =
+                    std::min(cheapest, grown.value() - search.values[group]);
+            }
+            bound = std::max(bound, cheapest);
+        }
+        return bound;
+    }
+
+    void search_from(Search& search,
+                     size_t depth,
+                     size_t used,
+                     uint64_t total) const {
+        if (search.nodes++ >= MAX_NODES) {
+            return;
+        }
+        const size_t remaining = search.order.size() - depth;
+        if (remaining < search.num_groups - used) {
+            return;
+        }
+        if (remaining == 0) {
+            if (total < search.best_total) {
+                search.best_total = total;
+                search.best_group_of = search.group_of;
+                search.improved = true;
+            }
+            return;
+        }
+        if (total + lower_bound(search, depth, used) >= search.best_total) {
+            return;
+        }
+
+        const uint32_t suffix_id = search.order[depth];
+        const size_t choices = std::min(used + 1, search.num_groups);
+        for (size_t group = 0; group < choices; ++group) {
+            const ScoreModel saved_score = search.groups[group];
+            const uint64_t saved_value = search.values[group];
+
+            search.groups[group].add(this->suffixes_[suffix_id]);
+            search.values[group] = search.groups[group].value();
+            search.group_of[suffix_id] = static_cast<uint32_t>(group);
+
+            search_from(search, depth + 1, std::max(used, group + 1),
+                        total - saved_value + search.values[group]);
+
+            search.groups[group] = saved_score;
+            search.values[group] = saved_value;
+        }
+    }
+
+    const ScoreModel empty_score_;
+};
+
+}  // namespace teddy::grouping
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "teddy/compile.h"
+#include "teddy/grouping/builder.h"
+#include "teddy/grouping/scores/packed.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace teddy::grouping {
+
+/*
+    k-medoids over nibble signatures, one bit per (position, low nibble)
+    and (position, high nibble) of a suffix
+    - every signature has 2 * Sigma bits, so the Jaccard distance of two
+      suffixes only falls as their shared bits grow, and the nearest medoid
+      is the one sharing the most bits, a popcount of an AND
+    - medoids start farthest first from suffix 0
+    - the new medoid of a cluster is the member sharing the most bits with
+      the other members, which the per-bit member counts give in linear time
+    - ties go to the smaller cluster, then the lower medoid
+    - stops when no suffix changes cluster or after MAX_ITERATIONS
+*/
+template <int Sigma>
+class ClusteringGroupingBuilder final : public GroupingBuilder<Sigma> {
+   public:
+    static constexpr int MAX_ITERATIONS = 16;
+
+    explicit ClusteringGroupingBuilder(const std::vector<Suffix>& suffixes)
+        : GroupingBuilder<Sigma>(suffixes, TEDDY_COMPILE_NIBBLE_CLUSTERING) {}
+
+    GroupedSuffixIds build() const {
+        const size_t num_suffixes = this->suffixes_.size();
+        const size_t num_groups =
+            std::min(num_suffixes, static_cast<size_t>(MAX_GROUPS));
+        if (num_groups == 0) {
+            return {};
+        }
+
+        std::vector<Words> signatures(num_suffixes);
+        for (size_t id = 0; id < num_suffixes; ++id) {
+            signatures[id] = signature(this->suffixes_[id]);
+        }
+
+        std::vector<uint32_t> medoids = farthest_first(signatures, num_groups);
+        std::vector<uint32_t> cluster_of(num_suffixes, num_groups);
+        for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+            if (!assign(signatures, medoids, cluster_of)) {
+                break;
+            }
+            update_medoids(signatures, cluster_of, medoids);
+        }
+
+        GroupedSuffixIds group_suffix_ids(num_groups);
+        for (uint32_t id = 0; id < num_suffixes; ++id) {
+            group_suffix_ids[cluster_of[id]].push_back(id);
+        }
+        std::erase_if(group_suffix_ids,
+                      [](const auto& group) { return group.empty(); });
+        return group_suffix_ids;
+    }
+
+   private:
+    // a low and a high nibble lane per position
+    using Lanes = detail::PackedLanes<16, 2 * Sigma>;
+    using Words = typename Lanes::Words;
+
+    static Words signature(const Suffix& suffix) noexcept {
+        Words words{};
+        for (int i = 0; i < Sigma; ++i) {
+            Lanes::set(words, 2 * i, uint64_t{1} << (suffix[i] & 0x0F));
+            Lanes::set(words, 2 * i + 1, uint64_t{1} << (suffix[i] >> 4));
+        }
+        return words;
+    }
+
+    static int shared_bits(const Words& left, const Words& right) noexcept {
+        int shared = 0;
+        for (size_t word = 0; word < Lanes::WORDS; ++word) {
+            shared += std::popcount(left[word] & right[word]);
+        }
+        return shared;
+    }
+
+    static std::vector<uint32_t> farthest_first(
+        const std::vector<Words>& signatures,
+        size_t num_groups) {
+        std::vector<uint32_t> medoids = {0};
+        // most bits shared with any medoid so far
+        std::vector<int> closest(signatures.size());
+        for (size_t id = 0; id < signatures.size(); ++id) {
+            closest[id] = shared_bits(signatures[id], signatures[0]);
+        }
+
+        while (medoids.size() < num_groups) {
+            const auto farthest = static_cast<uint32_t>(
+                std::min_element(closest.begin(), closest.end()) -
+                closest.begin());
+            medoids.push_back(farthest);
+            for (size_t id = 0; id < signatures.size(); ++id) {
+                closest[id] =
+                    std::max(closest[id],
+                             shared_bits(signatures[id], signatures[farthest]));
+            }
+        }
+        return medoids;
+    }
+
+    // false when no suffix changed cluster
+    static bool assign(const std::vector<Words>& signatures,
+                       const std::vector<uint32_t>& medoids,
+                       std::vector<uint32_t>& cluster_of) {
+        const size_t num_groups = medoids.size();
+        std::array<Words, MAX_GROUPS> centers{};
+        for (size_t cluster = 0; cluster < num_groups; ++cluster) {
+            centers[cluster] = signatures[medoids[cluster]];
+        }
+
+        std::array<size_t, MAX_GROUPS> sizes{};
+        bool changed = false;
+        for (size_t id = 0; id < signatures.size(); ++id) {
+            std::array<int, MAX_GROUPS> shared{};
+            for (size_t cluster = 0; cluster < num_groups; ++cluster) {
+                shared[cluster] = shared_bits(signatures[id], centers[cluster]);
+            }
+
+            uint32_t best = 0;
+            for (uint32_t cluster = 1; cluster < num_groups; ++cluster) {
+                if (shared[cluster] > shared[best] ||
+                    (shared[cluster] == shared[best] &&
+                     sizes[cluster] < sizes[best])) {
+                    best = cluster;
+                }
+            }
+
+            ++sizes[best];
+            changed |= cluster_of[id] != best;
+            cluster_of[id] = best;
+        }
+        return changed;
+    }
+
+    static void update_medoids(const std::vector<Words>& signatures,
+                               const std::vector<uint32_t>& cluster_of,
+                               std::vector<uint32_t>& medoids) {
+        constexpr int BITS = 64 * static_cast<int>(Lanes::WORDS);
+        std::vector<std::array<uint32_t, BITS>> bit_counts(medoids.size());
+        for (size_t id = 0; id < signatures.size(); ++id) {
+            auto& counts = bit_counts[cluster_of[id]];
+            for_each_bit(signatures[id], [&](int bit) { ++counts[bit]; });
+        }
+
+        std::vector<uint64_t> best_shared(medoids.size(), 0);
+        for (size_t cluster = 0; cluster < medoids.size(); ++cluster) {
+            best_shared[cluster] =
+                shared_with_cluster(signatures[medoids[cluster]],
+                                    bit_counts[cluster]);
+        }
+        for (uint32_t id = 0; id < signatures.size(); ++id) {
+            const uint32_t cluster = cluster_of[id];
+            const uint64_t shared =
+                shared_with_cluster(signatures[id], bit_counts[cluster]);
+            if (shared > best_shared[cluster]) {
+                best_shared[cluster] = shared;
+                medoids[cluster] = id;
+            }
+        }
+    }
+
+    template <size_t Bits>
+    static uint64_t shared_with_cluster(
+        const Words& signature,
+        const std::array<uint32_t, Bits>& counts) noexcept {
+        uint64_t shared = 0;
+        for_each_bit(signature, [&](int bit) { shared += counts[bit]; });
+        return shared;
+    }
+
+    template <typename Visit>
+    static void for_each_bit(const Words& words, Visit&& visit) {
+        for (size_t word = 0; word < Lanes::WORDS; ++word) {
+            for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1) {
+                visit(static_cast<int>(word * 64) + std::countr_zero(bits));
+            }
+        }
+    }
+};
+
+}  // namespace teddy::grouping
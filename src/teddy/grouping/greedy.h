@@ -3,11 +3,18 @@
 #include "teddy/compile.h"
 #include "teddy/grouping/builder.h"
 #include "teddy/grouping/group.h"
+#include "teddy/grouping/merge_deltas.h"
 #include "teddy/grouping/score.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <limits>
+#include <numeric>
+#include <queue>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 namespace teddy::grouping {
 
@@ -23,14 +30,20 @@ class GreedyGroupingBuilder final : public GroupingBuilder<Sigma> {
     using Group = SuffixGroup<ScoreModel>;
 
    public:
-    explicit GreedyGroupingBuilder(const std::vector<Suffix>& suffixes)
-        : GroupingBuilder<Sigma>(suffixes, strategy()) {}
+    explicit GreedyGroupingBuilder(const std::vector<Suffix>& suffixes,
+                                   const ScoreModel& empty_score = {})
+        : GroupingBuilder<Sigma>(suffixes, strategy()),
+          empty_score_(empty_score) {}
 
     GroupedSuffixIds build() const {
+        if constexpr (SelectionPolicy == GreedySelectionPolicy::MinDelta) {
+            return build_min_delta();
+        }
+
         std::vector<Group> groups;
         groups.reserve(this->suffixes_.size());
         for (uint32_t i = 0; i < this->suffixes_.size(); ++i) {
-            groups.emplace_back(i, this->suffixes_[i]);
+            groups.emplace_back(i, this->suffixes_[i], empty_score_);
         }
 
         while (groups.size() > MAX_GROUPS) {
@@ -48,6 +61,8 @@ class GreedyGroupingBuilder final : public GroupingBuilder<Sigma> {
     }
 
    private:
+    // pairs are scored one by one, the Paper policy usually stops within a
+    // few partners of each row, too early for a batch to pay off
     bool merge_best_pair(std::vector<Group>& groups) const {
         int64_t best = std::numeric_limits<int64_t>::max();
         size_t best_i = groups.size();
@@ -95,12 +110,173 @@ class GreedyGroupingBuilder final : public GroupingBuilder<Sigma> {
         return true;
     }
 
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    struct Partner {
+        int64_t delta = std::numeric_limits<int64_t>::max();
+        uint32_t slot = NO_SLOT;
+    };
+
+    struct Candidate {
+        int64_t delta;
+        uint32_t slot;
+        uint32_t partner;
+        uint32_t version;
+
+        // min-heap on (delta, slot, partner), the order the quadratic scan
+        // over (i < j) visits pairs
+        bool operator>(const Candidate& other) const noexcept {
+            return std::tie(delta, slot, partner) >
+                   std::tie(other.delta, other.slot, other.partner);
+        }
+    };
+
+    /*
+        Same merges as repeating merge_best_pair with MinDelta, without
+        rescanning every pair per merge
+        - slot s starts as suffix s and never moves, a merge keeps the lower
+          slot like erasing the higher group from the vector did
+        - best[s] is the lowest (delta, partner) over live partners above s,
+          the heap holds one entry per publish and drops stale versions
+        - after merging j into i only pairs touching i or j change, so only
+          best[i], slots that pointed at i or j and slots below i that might
+          now prefer i are revisited
+        - rows mirrors live, so a slot is scored against every live slot
+          above it in one batch
+    */
+    GroupedSuffixIds build_min_delta() const {
+        const size_t num_suffixes = this->suffixes_.size();
+
+        std::vector<Group> slots;
+        slots.reserve(num_suffixes);
+        for (uint32_t i = 0; i < num_suffixes; ++i) {
+            slots.emplace_back(i, this->suffixes_[i], empty_score_);
+        }
+
+        std::vector<uint32_t> live(num_suffixes);
+        std::iota(live.begin(), live.end(), uint32_t{0});
+
+        MergeDeltas<ScoreModel> rows;
+        for (const Group& group : slots) {
+            rows.push_back(group);
+        }
+        std::vector<int64_t> row_deltas(num_suffixes);
+        std::vector<int64_t> target_deltas(num_suffixes);
+
+        std::vector<Partner> best(num_suffixes);
+        std::vector<uint32_t> versions(num_suffixes, 0);
+        std::priority_queue<Candidate, std::vector<Candidate>,
+                            std::greater<Candidate>>
+            heap;
+
+        const auto publish = [&](uint32_t slot) {
+            ++versions[slot];
+            if (best[slot].slot != NO_SLOT) {
+                heap.push({best[slot].delta, slot, best[slot].slot,
+                           versions[slot]});
+            }
+        };
+
+        const auto refresh = [&](uint32_t slot) {
+            Partner partner;
+            const size_t first = static_cast<size_t>(
+                std::upper_bound(live.begin(), live.end(), slot) -
+                live.begin());
+            rows.compute(slots[slot], first, live.size(), row_deltas.data());
+            for (size_t row = first; row < live.size(); ++row) {
+                const int64_t delta = row_deltas[row - first];
+                if (delta < partner.delta) {
+                    partner = {delta, live[row]};
+                }
+            }
+            best[slot] = partner;
+            publish(slot);
+        };
+
+        if (live.size() > MAX_GROUPS) {
+            for (const uint32_t slot : live) {
+                refresh(slot);
+            }
+        }
+
+        while (live.size() > MAX_GROUPS && !heap.empty()) {
+            const Candidate top = heap.top();
+            heap.pop();
+            if (top.version != versions[top.slot]) {
+                continue;
+            }
+
+            const uint32_t target = top.slot;
+            const uint32_t source = top.partner;
+            slots[target].absorb(std::move(slots[source]));
+            const auto source_it =
+                std::lower_bound(live.begin(), live.end(), source);
+            rows.erase(static_cast<size_t>(source_it - live.begin()));
+            live.erase(source_it);
+            ++versions[source];
+
+            const size_t target_row = static_cast<size_t>(
+                std::lower_bound(live.begin(), live.end(), target) -
+                live.begin());
+            rows.update(target_row);
+            refresh(target);
+
+            // merging is symmetric, so one batch covers (slot, target) for
+            // every slot below target
+            rows.compute(slots[target], 0, target_row, target_deltas.data());
+
+            for (size_t row = 0; row < live.size(); ++row) {
+                const uint32_t slot = live[row];
+                // partners of later slots are all above source
+                if (slot >= source) {
+                    break;
+                }
+                if (slot == target) {
+                    continue;
+                }
+                if (best[slot].slot == source) {
+                    refresh(slot);
+                    continue;
+                }
+                // pairs (target, slot) belong to best[target]
+                if (slot > target) {
+                    continue;
+                }
+
+                const int64_t delta = target_deltas[row];
+                if (best[slot].slot == target) {
+                    if (delta <= best[slot].delta) {
+                        best[slot].delta = delta;
+                        publish(slot);
+                    } else {
+                        refresh(slot);
+                    }
+                } else if (delta < best[slot].delta ||
+                           (delta == best[slot].delta &&
+                            target < best[slot].slot)) {
+                    best[slot] = {delta, target};
+                    publish(slot);
+                }
+            }
+        }
+
+        GroupedSuffixIds group_suffix_ids;
+        group_suffix_ids.reserve(live.size());
+        for (const uint32_t slot : live) {
+            group_suffix_ids.push_back(
+                std::move(slots[slot]).take_suffix_ids());
+        }
+        return group_suffix_ids;
+    }
+
     static constexpr findkey_teddy_compile_grouping_strategy strategy() {
         if constexpr (SelectionPolicy == GreedySelectionPolicy::Paper) {
             return TEDDY_COMPILE_GREEDY_PAPER_POLICY;
         }
         return TEDDY_COMPILE_GREEDY_MIN_DELTA;
     }
+
+    const ScoreModel empty_score_;
 };
 
 }  // namespace teddy::grouping
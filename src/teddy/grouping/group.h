@@ -13,13 +13,20 @@ namespace teddy::grouping {
 template <GroupingScore ScoreModel>
 class SuffixGroup final {
    public:
-    SuffixGroup(uint32_t suffix_id, const Suffix& suffix)
-        : suffix_ids_{suffix_id} {
+    // `empty` carries the score's settings, such as input byte frequencies
+    SuffixGroup(uint32_t suffix_id,
+                const Suffix& suffix,
+                const ScoreModel& empty = {})
+        : suffix_ids_{suffix_id}, score_(empty) {
         score_.add(suffix);
     }
 
     [[nodiscard]] uint64_t score() const noexcept { return score_.value(); }
 
+    [[nodiscard]] const ScoreModel& score_model() const noexcept {
+        return score_;
+    }
+
     [[nodiscard]] uint64_t score_if_merged_with(
         const SuffixGroup& other) const noexcept {
         ScoreModel merged = score_;
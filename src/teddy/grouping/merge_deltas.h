@@ -0,0 +1,116 @@
+#pragma once
+
+#include "teddy/grouping/group.h"
+#include "teddy/grouping/score.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace teddy::grouping {
+
+// score change of merging two groups, negative when the merge is cheaper
+template <GroupingScore ScoreModel>
+[[nodiscard]] int64_t merge_delta(
+    uint64_t merged_score,
+    const SuffixGroup<ScoreModel>& left,
+    const SuffixGroup<ScoreModel>& right) noexcept {
+    const uint64_t old_score = left.score() + right.score();
+    return static_cast<int64_t>(merged_score) -
+           static_cast<int64_t>(old_score);
+}
+
+/*
+    Ordered rows of groups that one group can be scored against at once
+    - rows point at groups owned by the caller, which must not move them
+    - batched scores keep the packed states and scores of the rows
+      contiguous and go through merged_values, the others merge pair by pair
+*/
+template <GroupingScore ScoreModel,
+          bool Batched = BatchGroupingScore<ScoreModel>>
+class MergeDeltas {
+    using Group = SuffixGroup<ScoreModel>;
+
+   public:
+    void push_back(const Group& group) { rows_.push_back(&group); }
+
+    // the group in `row` was merged into
+    void update(size_t row) noexcept { (void)row; }
+
+    void erase(size_t row) { rows_.erase(rows_.begin() + row); }
+
+    [[nodiscard]] size_t size() const noexcept { return rows_.size(); }
+
+    // out[k] = delta of merging `group` with row first + k
+    void compute(const Group& group,
+                 size_t first,
+                 size_t last,
+                 int64_t* out) const noexcept {
+        for (size_t row = first; row < last; ++row) {
+            const Group& other = *rows_[row];
+            out[row - first] = merge_delta(group.score_if_merged_with(other),
+                                           group, other);
+        }
+    }
+
+   private:
+    std::vector<const Group*> rows_;
+};
+
+template <GroupingScore ScoreModel>
+class MergeDeltas<ScoreModel, true> {
+    using Group = SuffixGroup<ScoreModel>;
+    using Packed = typename ScoreModel::Packed;
+
+    // rows merged per merged_values call, on the stack
+    static constexpr size_t CHUNK = 64;
+
+   public:
+    void push_back(const Group& group) {
+        rows_.push_back(&group);
+        packed_.push_back(group.score_model().packed());
+        scores_.push_back(group.score());
+    }
+
+    void update(size_t row) noexcept {
+        packed_[row] = rows_[row]->score_model().packed();
+        scores_[row] = rows_[row]->score();
+    }
+
+    void erase(size_t row) {
+        rows_.erase(rows_.begin() + row);
+        packed_.erase(packed_.begin() + row);
+        scores_.erase(scores_.begin() + row);
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return rows_.size(); }
+
+    void compute(const Group& group,
+                 size_t first,
+                 size_t last,
+                 int64_t* out) const noexcept {
+        const std::span<const Packed> packed(packed_);
+        const uint64_t score = group.score();
+
+        uint64_t merged[CHUNK];
+        for (size_t chunk = first; chunk < last; chunk += CHUNK) {
+            const size_t count = std::min(CHUNK, last - chunk);
+            merged_values<ScoreModel>(group.score_model().packed(),
+                                      packed.subspan(chunk, count), merged);
+            for (size_t k = 0; k < count; ++k) {
+                out[chunk - first + k] =
+                    static_cast<int64_t>(merged[k]) -
+                    static_cast<int64_t>(score + scores_[chunk + k]);
+            }
+        }
+    }
+
+   private:
+    std::vector<const Group*> rows_;
+    std::vector<Packed> packed_;
+    std::vector<uint64_t> scores_;
+};
+
+}  // namespace teddy::grouping
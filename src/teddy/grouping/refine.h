@@ -0,0 +1,200 @@
+#pragma once
+
+#include "teddy/compile.h"
+#include "teddy/grouping/builder.h"
+#include "teddy/grouping/score.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace teddy::grouping {
+
+/*
+    Hill climbing over a finished grouping, whatever strategy built it
+    - moves each suffix to the group where it lowers the total score most,
+      or swaps it with a sampled suffix of another group when no move helps
+    - a group keeps prefix and suffix scores of its members, so its score
+      without one member is a single merge
+    - groups never become empty
+    - stops after max_passes passes over all suffixes, after a pass without
+      improvement, or at the time limit (none when zero)
+*/
+template <int Sigma, GroupingScore ScoreModel>
+class LocalSearchRefiner final {
+   public:
+    LocalSearchRefiner(const std::vector<Suffix>& suffixes,
+                       const ScoreModel& empty_score,
+                       uint32_t max_passes,
+                       std::chrono::milliseconds time_limit)
+        : suffixes_(suffixes),
+          empty_score_(empty_score),
+          max_passes_(max_passes),
+          time_limit_(time_limit) {}
+
+    GroupedSuffixIds refine(GroupedSuffixIds group_suffix_ids) const {
+        if (group_suffix_ids.size() < 2 || max_passes_ == 0) {
+            return group_suffix_ids;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + time_limit_;
+        const auto out_of_time = [&] {
+            return time_limit_.count() != 0 &&
+                   std::chrono::steady_clock::now() >= deadline;
+        };
+
+        std::vector<Members> groups(group_suffix_ids.size());
+        std::vector<uint32_t> group_of(suffixes_.size());
+        std::vector<uint32_t> index_of(suffixes_.size());
+        for (uint32_t group = 0; group < groups.size(); ++group) {
+            groups[group].ids = std::move(group_suffix_ids[group]);
+            rebuild(groups[group], group, group_of, index_of);
+        }
+
+        std::mt19937 rng(SEED);
+        std::uniform_int_distribution<uint32_t> any_suffix(
+            0, static_cast<uint32_t>(suffixes_.size() - 1));
+
+        for (uint32_t pass = 0; pass < max_passes_; ++pass) {
+            bool improved = false;
+
+            for (uint32_t id = 0; id < suffixes_.size(); ++id) {
+                if (id % TIME_CHECK_INTERVAL == 0 && out_of_time()) {
+                    break;
+                }
+
+                const uint32_t from = group_of[id];
+                Members& source = groups[from];
+                if (source.ids.size() < 2) {
+                    continue;
+                }
+                const ScoreModel without = source.without(index_of[id]);
+                const int64_t kept = static_cast<int64_t>(without.value()) -
+                                     static_cast<int64_t>(source.score());
+
+                // best move
+                int64_t best_delta = 0;
+                uint32_t best_group = from;
+                for (uint32_t to = 0; to < groups.size(); ++to) {
+                    if (to == from) {
+                        continue;
+                    }
+                    const int64_t delta =
+                        kept + static_cast<int64_t>(
+                                   groups[to].with(suffixes_[id]).value()) -
+                        static_cast<int64_t>(groups[to].score());
+                    if (delta < best_delta) {
+                        best_delta = delta;
+                        best_group = to;
+                    }
+                }
+
+                if (best_group != from) {
+                    Members& target = groups[best_group];
+                    source.ids[index_of[id]] = source.ids.back();
+                    source.ids.pop_back();
+                    target.ids.push_back(id);
+                    rebuild(source, from, group_of, index_of);
+                    rebuild(target, best_group, group_of, index_of);
+                    improved = true;
+                    continue;
+                }
+
+                // sampled swaps
+                for (int sample = 0; sample < SWAP_SAMPLES; ++sample) {
+                    const uint32_t other = any_suffix(rng);
+                    const uint32_t to = group_of[other];
+                    if (to == from) {
+                        continue;
+                    }
+                    Members& target = groups[to];
+
+                    ScoreModel source_after = without;
+                    source_after.add(suffixes_[other]);
+                    ScoreModel target_after = target.without(index_of[other]);
+                    target_after.add(suffixes_[id]);
+
+                    const int64_t delta =
+                        static_cast<int64_t>(source_after.value()) +
+                        static_cast<int64_t>(target_after.value()) -
+                        static_cast<int64_t>(source.score()) -
+                        static_cast<int64_t>(target.score());
+                    if (delta < 0) {
+                        source.ids[index_of[id]] = other;
+                        target.ids[index_of[other]] = id;
+                        rebuild(source, from, group_of, index_of);
+                        rebuild(target, to, group_of, index_of);
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!improved || out_of_time()) {
+                break;
+            }
+        }
+
+        for (uint32_t group = 0; group < groups.size(); ++group) {
+            group_suffix_ids[group] = std::move(groups[group].ids);
+        }
+        return group_suffix_ids;
+    }
+
+   private:
+    static constexpr uint32_t SEED = 1;
+    static constexpr int SWAP_SAMPLES = 4;
+    static constexpr uint32_t TIME_CHECK_INTERVAL = 256;
+
+    struct Members {
+        std::vector<uint32_t> ids;
+        // prefix[i] scores ids[0, i), suffix[i] scores ids[i, size)
+        std::vector<ScoreModel> prefix;
+        std::vector<ScoreModel> suffix;
+
+        [[nodiscard]] uint64_t score() const noexcept {
+            return prefix.back().value();
+        }
+
+        [[nodiscard]] ScoreModel without(size_t index) const noexcept {
+            ScoreModel score = prefix[index];
+            score.merge(suffix[index + 1]);
+            return score;
+        }
+
+        [[nodiscard]] ScoreModel with(const Suffix& added) const noexcept {
+            ScoreModel score = prefix.back();
+            score.add(added);
+            return score;
+        }
+    };
+
+    void rebuild(Members& members,
+                 uint32_t group,
+                 std::vector<uint32_t>& group_of,
+                 std::vector<uint32_t>& index_of) const {
+        const size_t size = members.ids.size();
+        members.prefix.assign(size + 1, empty_score_);
+        members.suffix.assign(size + 1, empty_score_);
+        for (size_t i = 0; i < size; ++i) {
+            members.prefix[i + 1] = members.prefix[i];
+            members.prefix[i + 1].add(suffixes_[members.ids[i]]);
+
+            const size_t back = size - 1 - i;
+            members.suffix[back] = members.suffix[back + 1];
+            members.suffix[back].add(suffixes_[members.ids[back]]);
+
+            group_of[members.ids[i]] = group;
+            index_of[members.ids[i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    const std::vector<Suffix>& suffixes_;
+    const ScoreModel empty_score_;
+    const uint32_t max_passes_;
+    const std::chrono::milliseconds time_limit_;
+};
+
+}  // namespace teddy::grouping
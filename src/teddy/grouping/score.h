@@ -3,7 +3,10 @@
 #include "teddy/suffix.h"
 
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <span>
+#include <tuple>
 #include <type_traits>
 
 namespace teddy::grouping {
@@ -19,4 +22,35 @@ concept GroupingScore =
         { score.value() } noexcept -> std::same_as<uint64_t>;
     };
 
+/*
+    Optional for scores whose group state packs into fixed-width bitsets
+    - packed_value(a | b), word by word, is the value of a merged with b
+    - lets builders score one group against many in a single batch
+*/
+template <typename ScoreModel>
+concept BatchGroupingScore =
+    GroupingScore<ScoreModel> &&
+    requires(const ScoreModel score,
+             const typename ScoreModel::Packed& packed) {
+        { score.packed() } noexcept
+            -> std::same_as<const typename ScoreModel::Packed&>;
+        { ScoreModel::packed_value(packed) } noexcept
+            -> std::same_as<uint64_t>;
+    };
+
+// out[k] = value of candidate merged with groups[k]
+template <BatchGroupingScore ScoreModel>
+void merged_values(const typename ScoreModel::Packed& candidate,
+                   std::span<const typename ScoreModel::Packed> groups,
+                   uint64_t* out) noexcept {
+    constexpr size_t words = std::tuple_size_v<typename ScoreModel::Packed>;
+    for (size_t k = 0; k < groups.size(); ++k) {
+        typename ScoreModel::Packed merged;
+        for (size_t word = 0; word < words; ++word) {
+            merged[word] = candidate[word] | groups[k][word];
+        }
+        out[k] = ScoreModel::packed_value(merged);
+    }
+}
+
 }  // namespace teddy::grouping
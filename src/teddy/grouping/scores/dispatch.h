@@ -2,6 +2,7 @@
 
 #include "core/findkey_error.h"
 #include "findkey.h"
+#include "teddy/grouping/scores/frequency.h"
 #include "teddy/grouping/scores/nibble_count.h"
 #include "teddy/grouping/scores/paper.h"
 #include "teddy/grouping/scores/paper_nibble.h"
@@ -23,6 +24,9 @@ decltype(auto) dispatch_grouping_score(findkey_teddy_grouping_score score,
         case TEDDY_GROUPING_SCORE_NIBBLE_COUNT:
             return std::forward<Function>(function)
                 .template operator()<NibbleCountScore<Sigma>>();
+        case TEDDY_GROUPING_SCORE_FREQUENCY:
+            return std::forward<Function>(function)
+                .template operator()<FrequencyScore<Sigma>>();
         default:
             throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
                                "Unknown Teddy grouping score");
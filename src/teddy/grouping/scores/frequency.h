@@ -0,0 +1,123 @@
+#pragma once
+
+#include "findkey.h"
+#include "teddy/grouping/score.h"
+#include "teddy/grouping/scores/packed.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace teddy::grouping {
+
+/*
+    Input byte frequencies, indexed by the nibble sets of a Teddy position
+    - a byte passes a position when its low nibble is in the low set and
+      its high nibble is in the high set, so a position lets through the
+      mass of that cross product
+    - masses are in units of 2^-16 after add-one smoothing of the counts
+*/
+class ByteFrequencies final {
+   public:
+    static constexpr int MASS_BITS = 16;
+
+    // every byte equally likely
+    ByteFrequencies() noexcept : ByteFrequencies(findkey_byte_histogram{}) {}
+
+    explicit ByteFrequencies(const findkey_byte_histogram& histogram) noexcept {
+        double total = 256.0;
+        for (const uint64_t count : histogram.counts) {
+            total += static_cast<double>(count);
+        }
+
+        for (int byte = 0; byte < 256; ++byte) {
+            const double share =
+                (static_cast<double>(histogram.counts[byte]) + 1.0) / total;
+            const auto mass = static_cast<uint32_t>(
+                std::lround(share * (uint32_t{1} << MASS_BITS)));
+
+            // every low nibble set byte that contains this low nibble
+            const int low = byte & 0x0F;
+            auto& half = rows_[byte >> 4][low >> 3];
+            for (int set = 0; set < 256; ++set) {
+                if ((set >> (low & 7)) & 1) {
+                    half[set] += mass;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] static const ByteFrequencies& uniform() noexcept {
+        static const ByteFrequencies frequencies;
+        return frequencies;
+    }
+
+    // mass of the bytes with a low nibble in `low` and a high one in `high`
+    [[nodiscard]] uint64_t mass(uint16_t low, uint16_t high) const noexcept {
+        uint64_t total = 0;
+        for (unsigned bits = high; bits != 0; bits &= bits - 1) {
+            const auto& row = rows_[std::countr_zero(bits)];
+            total += row[0][low & 0xFF] + row[1][low >> 8];
+        }
+        return total;
+    }
+
+   private:
+    // rows_[high nibble][low nibbles 0-7 or 8-15][set of those low nibbles]
+    std::array<std::array<std::array<uint32_t, 256>, 2>, 16> rows_{};
+};
+
+// Expected false positive rate of a group in units of 2^-40 per input byte:
+// the product over positions of the input mass its nibble sets let through
+template <int Sigma>
+class FrequencyScore final {
+    // 16-bit sets of the low then high nibble values of every position
+    using Lanes = detail::PackedLanes<16, 2 * Sigma>;
+
+    static constexpr int VALUE_BITS = 40;
+
+   public:
+    FrequencyScore() noexcept : frequencies_(&ByteFrequencies::uniform()) {}
+
+    explicit FrequencyScore(const ByteFrequencies& frequencies) noexcept
+        : frequencies_(&frequencies) {}
+
+    void add(const Suffix& suffix) noexcept {
+        for (int i = 0; i < Sigma; ++i) {
+            const uint8_t byte = suffix[i];
+            Lanes::set(sets_, 2 * i, uint64_t{1} << (byte & 0x0F));
+            Lanes::set(sets_, 2 * i + 1, uint64_t{1} << (byte >> 4));
+        }
+        update_value();
+    }
+
+    void merge(const FrequencyScore& other) noexcept {
+        for (size_t word = 0; word < sets_.size(); ++word) {
+            sets_[word] |= other.sets_[word];
+        }
+        update_value();
+    }
+
+    [[nodiscard]] uint64_t value() const noexcept { return value_; }
+
+   private:
+    void update_value() noexcept {
+        value_ = uint64_t{1} << VALUE_BITS;
+        for (int i = 0; i < Sigma; ++i) {
+            const auto low = static_cast<uint16_t>(Lanes::get(sets_, 2 * i));
+            const auto high =
+                static_cast<uint16_t>(Lanes::get(sets_, 2 * i + 1));
+            value_ = value_ * frequencies_->mass(low, high) >>
+                     ByteFrequencies::MASS_BITS;
+        }
+    }
+
+    typename Lanes::Words sets_{};
+    uint64_t value_ = 0;
+    const ByteFrequencies* frequencies_;
+};
+
+static_assert(GroupingScore<FrequencyScore<FINDKEY_TEDDY_MAX_SIGMA>>);
+
+}  // namespace teddy::grouping
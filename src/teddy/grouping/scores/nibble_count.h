@@ -1,9 +1,8 @@
 #pragma once
 
 #include "teddy/grouping/score.h"
+#include "teddy/grouping/scores/packed.h"
 
-#include <array>
-#include <bit>
 #include <cstdint>
 
 namespace teddy::grouping {
@@ -12,43 +11,41 @@ namespace teddy::grouping {
 // then take their product as the score
 template <int Sigma>
 class NibbleCountScore final {
+    // 16-bit sets of the low then high nibble values of every position
+    using Lanes = detail::PackedLanes<16, 2 * Sigma>;
+
    public:
+    using Packed = typename Lanes::Words;
+
     void add(const Suffix& suffix) noexcept {
         for (int i = 0; i < Sigma; ++i) {
             const uint8_t byte = suffix[i];
-            low_nibbles_[i] |= nibble_bit(byte & 0x0F);
-            high_nibbles_[i] |= nibble_bit(byte >> 4);
+            Lanes::set(packed_, 2 * i, uint64_t{1} << (byte & 0x0F));
+            Lanes::set(packed_, 2 * i + 1, uint64_t{1} << (byte >> 4));
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     void merge(const NibbleCountScore& other) noexcept {
-        for (int i = 0; i < Sigma; ++i) {
-            low_nibbles_[i] |= other.low_nibbles_[i];
-            high_nibbles_[i] |= other.high_nibbles_[i];
+        for (size_t word = 0; word < packed_.size(); ++word) {
+            packed_[word] |= other.packed_[word];
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     [[nodiscard]] uint64_t value() const noexcept { return value_; }
 
-   private:
-    static uint16_t nibble_bit(uint8_t nibble) noexcept {
-        return static_cast<uint16_t>(uint16_t{1} << nibble);
-    }
+    [[nodiscard]] const Packed& packed() const noexcept { return packed_; }
 
-    void update_value() noexcept {
-        value_ = 1;
-        for (int i = 0; i < Sigma; ++i) {
-            value_ *= std::popcount(static_cast<unsigned int>(low_nibbles_[i]));
-            value_ *=
-                std::popcount(static_cast<unsigned int>(high_nibbles_[i]));
-        }
+    [[nodiscard]] static uint64_t packed_value(const Packed& packed) noexcept {
+        return Lanes::product(packed);
     }
 
-    std::array<uint16_t, Sigma> low_nibbles_{};
-    std::array<uint16_t, Sigma> high_nibbles_{};
+   private:
+    Packed packed_{};
     uint64_t value_ = 0;
 };
 
+static_assert(BatchGroupingScore<NibbleCountScore<FINDKEY_TEDDY_MAX_SIGMA>>);
+
 }  // namespace teddy::grouping
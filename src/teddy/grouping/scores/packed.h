@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace teddy::grouping::detail {
+
+// popcount of every LaneBits wide lane of a word, kept in place
+template <int LaneBits>
+constexpr uint64_t lane_popcounts(uint64_t word) noexcept {
+    static_assert(LaneBits == 4 || LaneBits == 8 || LaneBits == 16,
+                  "Unsupported packed score lane width");
+
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) +
+           ((word >> 2) & 0x3333333333333333ull);
+    if constexpr (LaneBits == 4) {
+        return word;
+    }
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    if constexpr (LaneBits == 8) {
+        return word;
+    }
+    return (word + (word >> 8)) & 0x00FF00FF00FF00FFull;
+}
+
+/*
+    Group state of a score packed into fixed-width bitsets
+    - Lanes unions of LaneBits bits each, LANES_PER_WORD per 64-bit word
+    - the score is the product of the lane popcounts, so merging two groups
+      is a word-wise OR
+*/
+template <int LaneBits, int Lanes>
+struct PackedLanes {
+    static constexpr int LANES_PER_WORD = 64 / LaneBits;
+    static constexpr size_t WORDS =
+        (Lanes + LANES_PER_WORD - 1) / LANES_PER_WORD;
+
+    using Words = std::array<uint64_t, WORDS>;
+
+    static constexpr void set(Words& words, int lane, uint64_t bits) noexcept {
+        words[lane / LANES_PER_WORD] |= bits
+                                        << (lane % LANES_PER_WORD * LaneBits);
+    }
+
+    static constexpr uint64_t get(const Words& words, int lane) noexcept {
+        constexpr uint64_t lane_mask = (uint64_t{1} << LaneBits) - 1;
+        return (words[lane / LANES_PER_WORD] >>
+                (lane % LANES_PER_WORD * LaneBits)) &
+               lane_mask;
+    }
+
+    static constexpr uint64_t product(const Words& words) noexcept {
+        constexpr uint64_t lane_mask = (uint64_t{1} << LaneBits) - 1;
+
+        uint64_t value = 1;
+        for (size_t word = 0; word < WORDS; ++word) {
+            const uint64_t counts = lane_popcounts<LaneBits>(words[word]);
+            for (int lane = 0; lane < LANES_PER_WORD; ++lane) {
+                if (static_cast<int>(word) * LANES_PER_WORD + lane >= Lanes) {
+                    break;
+                }
+                value *= (counts >> (lane * LaneBits)) & lane_mask;
+            }
+        }
+        return value;
+    }
+};
+
+}  // namespace teddy::grouping::detail
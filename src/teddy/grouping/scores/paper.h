@@ -1,44 +1,48 @@
 #pragma once
 
 #include "teddy/grouping/score.h"
+#include "teddy/grouping/scores/packed.h"
 
-#include <array>
-#include <bit>
 #include <cstdint>
 
 namespace teddy::grouping {
 
 template <int Sigma>
 class PaperScore final {
+    // one 8-bit union of the suffix bytes per position
+    using Lanes = detail::PackedLanes<8, Sigma>;
+
    public:
+    using Packed = typename Lanes::Words;
+
     void add(const Suffix& suffix) noexcept {
         for (int i = 0; i < Sigma; ++i) {
-            byte_unions_[i] |= suffix[i];
+            Lanes::set(packed_, i, suffix[i]);
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     void merge(const PaperScore& other) noexcept {
-        for (int i = 0; i < Sigma; ++i) {
-            byte_unions_[i] |= other.byte_unions_[i];
+        for (size_t word = 0; word < packed_.size(); ++word) {
+            packed_[word] |= other.packed_[word];
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     [[nodiscard]] uint64_t value() const noexcept { return value_; }
 
-   private:
-    void update_value() noexcept {
-        value_ = 1;
-        for (uint8_t byte_union : byte_unions_) {
-            value_ *= std::popcount(static_cast<unsigned int>(byte_union));
-        }
+    [[nodiscard]] const Packed& packed() const noexcept { return packed_; }
+
+    [[nodiscard]] static uint64_t packed_value(const Packed& packed) noexcept {
+        return Lanes::product(packed);
     }
 
-    std::array<uint8_t, Sigma> byte_unions_{};
+   private:
+    Packed packed_{};
     uint64_t value_ = 0;
 };
 
 static_assert(GroupingScore<PaperScore<1>>);
+static_assert(BatchGroupingScore<PaperScore<FINDKEY_TEDDY_MAX_SIGMA>>);
 
 }  // namespace teddy::grouping
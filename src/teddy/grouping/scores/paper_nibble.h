@@ -1,9 +1,8 @@
 #pragma once
 
 #include "teddy/grouping/score.h"
+#include "teddy/grouping/scores/packed.h"
 
-#include <array>
-#include <bit>
 #include <cstdint>
 
 namespace teddy::grouping {
@@ -11,40 +10,41 @@ namespace teddy::grouping {
 // Similar to PaperScore, but uses nibbles for score
 template <int Sigma>
 class PaperNibbleScore final {
+    // 4-bit unions of the low then high nibbles of every position
+    using Lanes = detail::PackedLanes<4, 2 * Sigma>;
+
    public:
+    using Packed = typename Lanes::Words;
+
     void add(const Suffix& suffix) noexcept {
         for (int i = 0; i < Sigma; ++i) {
             const uint8_t byte = suffix[i];
-            low_nibble_unions_[i] |= byte & 0x0F;
-            high_nibble_unions_[i] |= byte >> 4;
+            Lanes::set(packed_, 2 * i, byte & 0x0F);
+            Lanes::set(packed_, 2 * i + 1, byte >> 4);
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     void merge(const PaperNibbleScore& other) noexcept {
-        for (int i = 0; i < Sigma; ++i) {
-            low_nibble_unions_[i] |= other.low_nibble_unions_[i];
-            high_nibble_unions_[i] |= other.high_nibble_unions_[i];
+        for (size_t word = 0; word < packed_.size(); ++word) {
+            packed_[word] |= other.packed_[word];
         }
-        update_value();
+        value_ = packed_value(packed_);
     }
 
     [[nodiscard]] uint64_t value() const noexcept { return value_; }
 
-   private:
-    void update_value() noexcept {
-        value_ = 1;
-        for (int i = 0; i < Sigma; ++i) {
-            value_ *=
-                std::popcount(static_cast<unsigned int>(low_nibble_unions_[i]));
-            value_ *= std::popcount(
-                static_cast<unsigned int>(high_nibble_unions_[i]));
-        }
+    [[nodiscard]] const Packed& packed() const noexcept { return packed_; }
+
+    [[nodiscard]] static uint64_t packed_value(const Packed& packed) noexcept {
+        return Lanes::product(packed);
     }
 
-    std::array<uint8_t, Sigma> low_nibble_unions_{};
-    std::array<uint8_t, Sigma> high_nibble_unions_{};
+   private:
+    Packed packed_{};
     uint64_t value_ = 0;
 };
 
+static_assert(BatchGroupingScore<PaperNibbleScore<FINDKEY_TEDDY_MAX_SIGMA>>);
+
 }  // namespace teddy::grouping
@@ -6,8 +6,13 @@
 #include "teddy/grouping/score.h"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <numeric>
+#include <tuple>
+#include <vector>
 
 namespace teddy::grouping {
 
@@ -95,79 +100,113 @@ class SortedGroupingBuilder final : public GroupingBuilder<Sigma> {
     }
 };
 
+namespace detail {
+
+// range minimum over a layer that is filled front to back
+class LayerMinTree {
+   public:
+    explicit LayerMinTree(size_t size) {
+        while (leaves_ < size) {
+            leaves_ *= 2;
+        }
+        nodes_.assign(2 * leaves_, std::numeric_limits<uint64_t>::max());
+    }
+
+    void set(size_t index, uint64_t value) noexcept {
+        index += leaves_;
+        nodes_[index] = value;
+        for (index /= 2; index > 0; index /= 2) {
+            nodes_[index] = std::min(nodes_[2 * index], nodes_[2 * index + 1]);
+        }
+    }
+
+    // minimum over [first, last]
+    [[nodiscard]] uint64_t min(size_t first, size_t last) const noexcept {
+        uint64_t result = std::numeric_limits<uint64_t>::max();
+        for (first += leaves_, last += leaves_ + 1; first < last;
+             first /= 2, last /= 2) {
+            if (first & 1) {
+                result = std::min(result, nodes_[first++]);
+            }
+            if (last & 1) {
+                result = std::min(result, nodes_[--last]);
+            }
+        }
+        return result;
+    }
+
+   private:
+    size_t leaves_ = 1;
+    std::vector<uint64_t> nodes_;
+};
+
+}  // namespace detail
+
+/*
+    Optimal split of the sorted suffixes into contiguous groups
+    - dp over (groups, prefix length) minimizing the total score, then the
+      largest group, then the earlier boundary
+    - every score depends only on the set of bytes seen at each position, so
+      the score of [begin, end) only changes at begins where a (position,
+      byte) pair is seen for the last time before end; the suffixes holding
+      such last occurrences are kept in a list, newest first
+    - each run of begins with the same score is skipped when the minimum of
+      the previous layer over the run cannot reach the best total, and
+      scanned otherwise
+*/
 template <int Sigma, GroupingScore ScoreModel>
 class SortedOptimalGroupingBuilder final : public GroupingBuilder<Sigma> {
    public:
-    explicit SortedOptimalGroupingBuilder(const std::vector<Suffix>& suffixes)
-        : GroupingBuilder<Sigma>(
-              suffixes,
-              TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION) {}
+    explicit SortedOptimalGroupingBuilder(const std::vector<Suffix>& suffixes,
+                                          const ScoreModel& empty_score = {})
+        : GroupingBuilder<Sigma>(suffixes,
+                                 TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION),
+          empty_score_(empty_score) {}
 
     GroupedSuffixIds build() const {
         const std::vector<uint32_t> suffix_ids =
             detail::sorted_suffix_ids<Sigma>(this->suffixes_);
+        const size_t num_suffixes = suffix_ids.size();
         const size_t num_groups =
-            std::min(suffix_ids.size(), static_cast<size_t>(MAX_GROUPS));
+            std::min(num_suffixes, static_cast<size_t>(MAX_GROUPS));
+
+        // layer g of every table covers prefixes [0, num_suffixes]
+        Layers layers(num_groups, num_suffixes);
+        layers.score(0, 0) = 0;
+        layers.largest(0, 0) = 0;
+        layers.previous(0, 0) = 0;
+        std::vector<detail::LayerMinTree> minimums(
+            num_groups, detail::LayerMinTree(num_suffixes + 1));
+        minimums[0].set(0, 0);
+
+        LastOccurrences last_occurrences(num_suffixes);
+
+        for (size_t end = 1; end <= num_suffixes; ++end) {
+            last_occurrences.push(end - 1,
+                                  this->suffixes_[suffix_ids[end - 1]]);
+
+            ScoreModel partition_score = empty_score_;
+            for (uint32_t last = last_occurrences.newest(); last != NO_SUFFIX;
+                 last = last_occurrences.older(last)) {
+                partition_score.add(this->suffixes_[suffix_ids[last]]);
+                const uint32_t older = last_occurrences.older(last);
+                const size_t first_begin = older == NO_SUFFIX ? 0 : older + 1;
 
-        struct PartitionState {
-            uint64_t score = std::numeric_limits<uint64_t>::max();
-            size_t largest_group = std::numeric_limits<size_t>::max();
-            size_t previous_boundary = std::numeric_limits<size_t>::max();
-        };
-
-        // dp[g][s] = best partitioning the first s suffixes into g groups
-        std::vector<std::vector<PartitionState>> dp(
-            num_groups + 1, std::vector<PartitionState>(suffix_ids.size() + 1));
-
-        dp[0][0] = {
-            .score = 0,
-            .largest_group = 0,
-            .previous_boundary = 0,
-        };
-
-        // loop through all partitions [begin, end)
-        for (size_t begin = 0; begin < suffix_ids.size(); ++begin) {
-            ScoreModel partition_score;
-            for (size_t end = begin + 1; end <= suffix_ids.size(); ++end) {
-                partition_score.add(this->suffixes_[suffix_ids[end - 1]]);
-                const uint64_t group_score = partition_score.value();
-                const size_t max_group_count = std::min(num_groups, begin + 1);
-
-                for (size_t g = 1; g <= max_group_count; ++g) {
-                    const PartitionState& prev = dp[g - 1][begin];
-
-                    if (prev.score == std::numeric_limits<uint64_t>::max()) {
-                        continue;
-                    }
-
-                    // overflow
-                    if (group_score >
-                        std::numeric_limits<uint64_t>::max() - prev.score) {
-                        continue;
-                    }
-
-                    const uint64_t candidate_score = prev.score + group_score;
-                    const size_t candidate_largest_group =
-                        std::max(prev.largest_group, end - begin);
-                    PartitionState& current = dp[g][end];
-
-                    if (candidate_score < current.score ||
-                        (candidate_score == current.score &&
-                         candidate_largest_group < current.largest_group)) {
-                        current = {
-                            .score = candidate_score,
-                            .largest_group = candidate_largest_group,
-                            .previous_boundary = begin,
-                        };
-                    }
+                for (size_t g = 1; g <= num_groups; ++g) {
+                    relax(layers, minimums[g - 1], g, end, first_begin, last,
+                          partition_score.value());
                 }
             }
+
+            for (size_t g = 1; g < num_groups; ++g) {
+                minimums[g].set(end, layers.score(g, end));
+            }
         }
 
         GroupedSuffixIds group_suffix_ids(num_groups);
-        size_t end = suffix_ids.size();
+        size_t end = num_suffixes;
         for (size_t group_count = num_groups; group_count > 0; --group_count) {
-            const size_t begin = dp[group_count][end].previous_boundary;
+            const size_t begin = layers.previous(group_count, end);
             if (begin >= end) {
                 throw FindkeyError(
                     FindkeyErrorCode::INVALID_ARGUMENT,
@@ -181,6 +220,130 @@ class SortedOptimalGroupingBuilder final : public GroupingBuilder<Sigma> {
 
         return group_suffix_ids;
     }
+
+   private:
+    static constexpr uint64_t NO_SCORE = std::numeric_limits<uint64_t>::max();
+    static constexpr uint32_t NO_SUFFIX = std::numeric_limits<uint32_t>::max();
+
+    // flat (num_groups + 1) x (num_suffixes + 1) tables
+    class Layers {
+       public:
+        Layers(size_t num_groups, size_t num_suffixes)
+            : width_(num_suffixes + 1),
+              scores_((num_groups + 1) * width_, NO_SCORE),
+              largest_((num_groups + 1) * width_, NO_SUFFIX),
+              previous_((num_groups + 1) * width_, NO_SUFFIX) {}
+
+        uint64_t& score(size_t g, size_t s) { return scores_[g * width_ + s]; }
+        uint32_t& largest(size_t g, size_t s) {
+            return largest_[g * width_ + s];
+        }
+        uint32_t& previous(size_t g, size_t s) {
+            return previous_[g * width_ + s];
+        }
+
+       private:
+        size_t width_;
+        std::vector<uint64_t> scores_;
+        std::vector<uint32_t> largest_;
+        std::vector<uint32_t> previous_;
+    };
+
+    // suffixes still holding the last occurrence of a (position, byte) pair
+    class LastOccurrences {
+       public:
+        explicit LastOccurrences(size_t num_suffixes)
+            : references_(num_suffixes, 0),
+              older_(num_suffixes, NO_SUFFIX),
+              newer_(num_suffixes, NO_SUFFIX) {
+            for (auto& position : last_) {
+                position.fill(NO_SUFFIX);
+            }
+        }
+
+        void push(size_t index, const Suffix& suffix) {
+            const auto suffix_index = static_cast<uint32_t>(index);
+            for (int i = 0; i < Sigma; ++i) {
+                uint32_t& last = last_[i][suffix[i]];
+                if (last != NO_SUFFIX && --references_[last] == 0) {
+                    unlink(last);
+                }
+                last = suffix_index;
+                ++references_[suffix_index];
+            }
+
+            older_[suffix_index] = newest_;
+            if (newest_ != NO_SUFFIX) {
+                newer_[newest_] = suffix_index;
+            }
+            newest_ = suffix_index;
+        }
+
+        [[nodiscard]] uint32_t newest() const noexcept { return newest_; }
+
+        [[nodiscard]] uint32_t older(uint32_t index) const noexcept {
+            return older_[index];
+        }
+
+       private:
+        void unlink(uint32_t index) noexcept {
+            if (newer_[index] != NO_SUFFIX) {
+                older_[newer_[index]] = older_[index];
+            } else {
+                newest_ = older_[index];
+            }
+            if (older_[index] != NO_SUFFIX) {
+                newer_[older_[index]] = newer_[index];
+            }
+        }
+
+        std::array<std::array<uint32_t, 256>, Sigma> last_;
+        std::vector<uint32_t> references_;
+        std::vector<uint32_t> older_;
+        std::vector<uint32_t> newer_;
+        uint32_t newest_ = NO_SUFFIX;
+    };
+
+    // best of dp[g - 1][begin] + group_score over begin in [first, last]
+    static void relax(Layers& layers,
+                      const detail::LayerMinTree& previous_layer,
+                      size_t g,
+                      size_t end,
+                      size_t first,
+                      size_t last,
+                      uint64_t group_score) {
+        const uint64_t lowest = previous_layer.min(first, last);
+        if (lowest == NO_SCORE || group_score > NO_SCORE - lowest ||
+            lowest + group_score > layers.score(g, end)) {
+            return;
+        }
+
+        for (size_t begin = first; begin <= last; ++begin) {
+            const uint64_t previous_score = layers.score(g - 1, begin);
+
+            // unreachable or overflow
+            if (previous_score == NO_SCORE ||
+                group_score > NO_SCORE - previous_score) {
+                continue;
+            }
+
+            const uint64_t candidate_score = previous_score + group_score;
+            const auto candidate_largest = static_cast<uint32_t>(
+                std::max<size_t>(layers.largest(g - 1, begin), end - begin));
+            uint64_t& score = layers.score(g, end);
+            uint32_t& largest = layers.largest(g, end);
+            uint32_t& previous = layers.previous(g, end);
+
+            if (std::tie(candidate_score, candidate_largest, begin) <
+                std::tie(score, largest, previous)) {
+                score = candidate_score;
+                largest = candidate_largest;
+                previous = static_cast<uint32_t>(begin);
+            }
+        }
+    }
+
+    const ScoreModel empty_score_;
 };
 
 }  // namespace teddy::grouping
@@ -11,6 +11,7 @@ inline constexpr std::array SCORE_BASED_STRATEGIES = {
     TEDDY_COMPILE_GREEDY_PAPER_POLICY,
     TEDDY_COMPILE_GREEDY_MIN_DELTA,
     TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION,
+    TEDDY_COMPILE_BRANCH_AND_BOUND,
 };
 
 [[nodiscard]] constexpr bool grouping_strategy_uses_score(
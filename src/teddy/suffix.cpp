@@ -1,8 +1,10 @@
 #include "teddy/suffix.h"
 
 #include "core/findkey_error.h"
+#include "teddy/window.h"
 
 #include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace teddy {
@@ -12,8 +14,10 @@ size_t virtual_key_length(std::string_view key,
                           findkey_teddy_suffix_mode suffix_mode) {
     switch (suffix_mode) {
         case TEDDY_SUFFIX_RAW:
+        case TEDDY_SUFFIX_WINDOW:
             return key.size();
         case TEDDY_SUFFIX_QUOTED:
+        case TEDDY_SUFFIX_PREFIX:
             return key.size() + 1;
         default:
             throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
@@ -25,6 +29,12 @@ uint8_t suffix_byte(std::string_view key,
                     int sigma,
                     int suffix_index,
                     findkey_teddy_suffix_mode suffix_mode) {
+    // for PREFIX mode, the opening quote (") comes before the first byte
+    if (suffix_mode == TEDDY_SUFFIX_PREFIX) {
+        return suffix_index == 0 ? '"'
+                                 : static_cast<uint8_t>(key[suffix_index - 1]);
+    }
+
     const size_t virtual_len = virtual_key_length(key, suffix_mode);
     const size_t key_index = virtual_len - sigma + suffix_index;
 
@@ -37,7 +47,20 @@ uint8_t suffix_byte(std::string_view key,
     return '"';
 }
 
-uint64_t encode_suffix(const Suffix& suffix, int sigma) {
+size_t distinct_fingerprints(const std::vector<std::string_view>& keys,
+                             size_t length,
+                             bool from_start) {
+    std::unordered_set<std::string_view> seen;
+    for (const std::string_view key : keys) {
+        seen.insert(from_start ? key.substr(0, length)
+                               : key.substr(key.size() - length));
+    }
+    return seen.size();
+}
+
+}  // namespace
+
+uint64_t encode_suffix(const uint8_t* suffix, int sigma) noexcept {
     uint64_t encoded = 0;
     for (int i = 0; i < sigma; ++i) {
         encoded = (encoded << 8) | suffix[i];
@@ -45,8 +68,6 @@ uint64_t encode_suffix(const Suffix& suffix, int sigma) {
     return encoded;
 }
 
-}  // namespace
-
 SuffixSet prepare_suffixes(const std::vector<std::string_view>& keys,
                            const findkey_teddy_config& config) {
     SuffixSet prepared;
@@ -60,8 +81,8 @@ SuffixSet prepare_suffixes(const std::vector<std::string_view>& keys,
                            "Teddy suffix length is out of range");
     }
 
-    if (config.suffix_mode != TEDDY_SUFFIX_RAW &&
-        config.suffix_mode != TEDDY_SUFFIX_QUOTED) {
+    if (config.suffix_mode < 0 ||
+        config.suffix_mode >= FINDKEY_TEDDY_SUFFIX_MODE_COUNT) {
         throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
                            "Unknown Teddy suffix mode");
     }
@@ -72,35 +93,80 @@ SuffixSet prepare_suffixes(const std::vector<std::string_view>& keys,
                            "Teddy keys must not be empty");
     }
 
-    size_t min_len = virtual_key_length(keys[0], config.suffix_mode);
+    const findkey_teddy_suffix_mode suffix_mode =
+        config.suffix_mode == TEDDY_SUFFIX_AUTO
+            ? resolve_suffix_mode(keys, config.sigma)
+            : config.suffix_mode;
+
+    size_t min_len = virtual_key_length(keys[0], suffix_mode);
     for (std::string_view key : keys) {
-        min_len =
-            std::min(min_len, virtual_key_length(key, config.suffix_mode));
+        min_len = std::min(min_len, virtual_key_length(key, suffix_mode));
     }
 
-    const int requested_sigma = config.suffix_mode == TEDDY_SUFFIX_QUOTED
-                                    ? config.sigma + 1
-                                    : config.sigma;
+    const bool quoted = suffix_mode == TEDDY_SUFFIX_QUOTED ||
+                        suffix_mode == TEDDY_SUFFIX_PREFIX;
+    const int requested_sigma = quoted ? config.sigma + 1 : config.sigma;
     prepared.sigma = std::min(static_cast<int>(min_len), requested_sigma);
-    prepared.end_quote_offset =
-        config.suffix_mode == TEDDY_SUFFIX_QUOTED ? 0 : 1;
+    prepared.end_quote_offset = quoted ? 0 : 1;
+    prepared.prefix = suffix_mode == TEDDY_SUFFIX_PREFIX;
+
+    if (suffix_mode == TEDDY_SUFFIX_WINDOW) {
+        // grouped on the key ends, shifted once groups are known
+        return window_suffixes(keys, prepared.sigma,
+                               std::vector<uint8_t>(keys.size(), 0));
+    }
 
     prepared.data.reserve(keys.size());
-    std::unordered_set<uint64_t> seen;
+    prepared.key_suffix_ids.reserve(keys.size());
+    std::unordered_map<uint64_t, uint32_t> seen;
     seen.reserve(keys.size());
 
     for (std::string_view key : keys) {
         Suffix suffix{};
         for (int i = 0; i < prepared.sigma; ++i) {
-            suffix[i] = suffix_byte(key, prepared.sigma, i, config.suffix_mode);
+            suffix[i] = suffix_byte(key, prepared.sigma, i, suffix_mode);
         }
 
-        if (seen.insert(encode_suffix(suffix, prepared.sigma)).second) {
+        const auto [it, inserted] =
+            seen.try_emplace(encode_suffix(suffix.data(), prepared.sigma),
+                             static_cast<uint32_t>(prepared.data.size()));
+        if (inserted) {
             prepared.data.push_back(suffix);
         }
+        prepared.key_suffix_ids.push_back(it->second);
     }
 
     return prepared;
 }
 
+std::optional<Suffix> key_suffix(std::string_view key,
+                                 int sigma,
+                                 findkey_teddy_suffix_mode suffix_mode,
+                                 int offset) {
+    if (virtual_key_length(key, suffix_mode) <
+        static_cast<size_t>(sigma + offset)) {
+        return std::nullopt;
+    }
+
+    const std::string_view window = key.substr(0, key.size() - offset);
+    Suffix suffix{};
+    for (int i = 0; i < sigma; ++i) {
+        suffix[i] = suffix_byte(window, sigma, i, suffix_mode);
+    }
+    return suffix;
+}
+
+findkey_teddy_suffix_mode resolve_suffix_mode(
+    const std::vector<std::string_view>& keys,
+    int sigma) {
+    size_t length = static_cast<size_t>(std::max(sigma, 0));
+    for (const std::string_view key : keys) {
+        length = std::min(length, key.size());
+    }
+    return distinct_fingerprints(keys, length, true) >
+                   distinct_fingerprints(keys, length, false)
+               ? TEDDY_SUFFIX_PREFIX
+               : TEDDY_SUFFIX_RAW;
+}
+
 }  // namespace teddy
@@ -5,6 +5,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -12,14 +13,46 @@ namespace teddy {
 
 using Suffix = std::array<uint8_t, FINDKEY_TEDDY_MAX_SIGMA>;
 
+// TEDDY_SUFFIX_WINDOW windows end at most this many bytes before the key end
+inline constexpr int MAX_WINDOW_OFFSET = 7;
+
 struct SuffixSet {
     int sigma = 0;
     size_t end_quote_offset = 1;
 
     std::vector<Suffix> data;
+
+    // index into data for every input key
+    std::vector<uint32_t> key_suffix_ids;
+
+    // TEDDY_SUFFIX_WINDOW only, empty otherwise
+    // bytes between the window and the end of every input key
+    std::vector<uint8_t> key_window_offsets;
+    // bit k of every suffix: some key has it as its window at offset k
+    std::vector<uint8_t> suffix_window_offsets;
+
+    // TEDDY_SUFFIX_PREFIX: data holds the opening quote and first key bytes
+    bool prefix = false;
 };
 
+uint64_t encode_suffix(const uint8_t* suffix, int sigma) noexcept;
+
+// TEDDY_SUFFIX_AUTO resolves through resolve_suffix_mode
 SuffixSet prepare_suffixes(const std::vector<std::string_view>& keys,
                            const findkey_teddy_config& config);
 
+// suffix prepare_suffixes gives key under a resolved suffix mode, for
+// TEDDY_SUFFIX_WINDOW the window `offset` bytes before the key end
+// nullopt when the key is too short for it
+std::optional<Suffix> key_suffix(std::string_view key,
+                                 int sigma,
+                                 findkey_teddy_suffix_mode suffix_mode,
+                                 int offset);
+
+// TEDDY_SUFFIX_PREFIX or TEDDY_SUFFIX_RAW by the distinct first and last
+// min(sigma, shortest key) bytes of the keys, the key end on ties
+findkey_teddy_suffix_mode resolve_suffix_mode(
+    const std::vector<std::string_view>& keys,
+    int sigma);
+
 }  // namespace teddy
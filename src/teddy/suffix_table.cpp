@@ -0,0 +1,105 @@
+#include "teddy/suffix_table.h"
+
+#include "core/findkey_error.h"
+#include "core/json_key.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <unordered_set>
+
+namespace teddy {
+
+SuffixTable build_suffix_table(
+    const std::vector<std::string_view>& keys,
+    const std::vector<uint32_t>& key_suffix_ids,
+    const std::vector<Suffix>& suffixes,
+    const std::vector<std::vector<uint32_t>>& group_suffix_ids,
+    int sigma) {
+    if (keys.size() != key_suffix_ids.size()) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Teddy suffix ids do not match the key set");
+    }
+
+    const size_t capacity = std::bit_ceil(std::max<size_t>(
+        2 * suffixes.size(), 16));
+    std::vector<uint64_t> slot_suffixes(capacity, SuffixTable::EMPTY_SLOT);
+    std::vector<uint32_t> slot_suffix_ids(capacity, NO_SUFFIX);
+    const uint64_t slot_mask = capacity - 1;
+
+    for (uint32_t suffix_id = 0; suffix_id < suffixes.size(); ++suffix_id) {
+        const uint64_t encoded =
+            encode_suffix(suffixes[suffix_id].data(), sigma);
+        uint64_t slot = suffix_table_slot(encoded);
+        while (slot_suffixes[slot & slot_mask] != SuffixTable::EMPTY_SLOT) {
+            ++slot;
+        }
+        slot_suffixes[slot & slot_mask] = encoded;
+        slot_suffix_ids[slot & slot_mask] = suffix_id;
+    }
+
+    // counting sort of the keys by suffix id
+    std::unordered_set<std::string_view> seen;
+    seen.reserve(keys.size());
+    std::vector<bool> usable(keys.size(), false);
+    std::vector<uint32_t> candidate_offsets(suffixes.size() + 1, 0);
+    size_t total_bytes = 0;
+
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        const std::string_view key = keys[key_id];
+        if (key_suffix_ids[key_id] == NO_SUFFIX ||
+            key_has_unescaped_quote(key) || !seen.insert(key).second) {
+            continue;
+        }
+        usable[key_id] = true;
+        ++candidate_offsets[key_suffix_ids[key_id] + 1];
+        total_bytes += key.size();
+    }
+
+    if (total_bytes > std::numeric_limits<uint32_t>::max()) {
+        throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                           "Teddy suffix table keys are too large");
+    }
+
+    for (size_t i = 1; i < candidate_offsets.size(); ++i) {
+        candidate_offsets[i] += candidate_offsets[i - 1];
+    }
+
+    std::vector<SuffixTableCandidate> candidates(candidate_offsets.back());
+    std::vector<char> key_bytes;
+    key_bytes.reserve(total_bytes);
+
+    std::vector<uint32_t> next = candidate_offsets;
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        if (!usable[key_id]) {
+            continue;
+        }
+
+        const std::string_view key = keys[key_id];
+        candidates[next[key_suffix_ids[key_id]]++] = {
+            .key_offset = static_cast<uint32_t>(key_bytes.size()),
+            .key_len = static_cast<uint32_t>(key.size()),
+            .key_id = key_id,
+        };
+        key_bytes.insert(key_bytes.end(), key.begin(), key.end());
+    }
+
+    std::vector<uint8_t> suffix_groups(suffixes.size(), 0);
+    for (size_t group = 0; group < group_suffix_ids.size(); ++group) {
+        for (uint32_t suffix_id : group_suffix_ids[group]) {
+            suffix_groups[suffix_id] = static_cast<uint8_t>(group);
+        }
+    }
+
+    SuffixTable table;
+    table.slot_suffixes = std::move(slot_suffixes);
+    table.slot_suffix_ids = std::move(slot_suffix_ids);
+    table.slot_mask = slot_mask;
+    table.candidate_offsets = std::move(candidate_offsets);
+    table.candidates = std::move(candidates);
+    table.key_bytes = std::move(key_bytes);
+    table.suffix_groups = std::move(suffix_groups);
+    return table;
+}
+
+}  // namespace teddy
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/flat_array.h"
+#include "teddy/suffix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace teddy {
+
+struct SuffixTableCandidate {
+    uint32_t key_offset = 0;  // into SuffixTable::key_bytes
+    uint32_t key_len = 0;
+    uint32_t key_id = 0;
+};
+
+/*
+    Maps the exact sigma-byte suffix of a Teddy hit to the keys ending with it
+    - open addressing over the encoded suffix, one probe in the common case
+    - candidates of suffix s are
+        candidates[candidate_offsets[s] .. candidate_offsets[s + 1])
+*/
+struct SuffixTable {
+    static constexpr uint64_t EMPTY_SLOT = ~uint64_t{0};
+
+    FlatArray<uint64_t> slot_suffixes;
+    FlatArray<uint32_t> slot_suffix_ids;
+    uint64_t slot_mask = 0;
+
+    FlatArray<uint32_t> candidate_offsets;
+    FlatArray<SuffixTableCandidate> candidates;
+    FlatArray<char> key_bytes;
+
+    // group of every suffix id, used to classify false positives
+    FlatArray<uint8_t> suffix_groups;
+
+    [[nodiscard]] bool empty() const noexcept { return slot_suffixes.empty(); }
+};
+
+inline constexpr uint32_t NO_SUFFIX = ~uint32_t{0};
+
+[[nodiscard]] inline uint64_t suffix_table_slot(uint64_t encoded) noexcept {
+    return (encoded * 0x9E3779B97F4A7C15ull) >> 32;
+}
+
+[[nodiscard]] inline uint32_t find_suffix_id(const SuffixTable& table,
+                                             uint64_t encoded) noexcept {
+    for (uint64_t slot = suffix_table_slot(encoded);; ++slot) {
+        const uint64_t stored = table.slot_suffixes[slot & table.slot_mask];
+        if (stored == encoded) {
+            return table.slot_suffix_ids[slot & table.slot_mask];
+        }
+        if (stored == SuffixTable::EMPTY_SLOT) {
+            return NO_SUFFIX;
+        }
+    }
+}
+
+/*
+    - key_suffix_ids[k] is the suffix id of keys[k], as built by
+      prepare_suffixes
+    - keys that can never verify (unescaped quote inside) and duplicated keys
+      are left out, matching the reverse trie
+    - so are keys whose suffix id is NO_SUFFIX, removed from a findkey_db
+*/
+SuffixTable build_suffix_table(
+    const std::vector<std::string_view>& keys,
+    const std::vector<uint32_t>& key_suffix_ids,
+    const std::vector<Suffix>& suffixes,
+    const std::vector<std::vector<uint32_t>>& group_suffix_ids,
+    int sigma);
+
+}  // namespace teddy
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "core/findkey_error.h"
 #include "core/key_dfa.h"
 #include "teddy/compile.h"
+#include "teddy/suffix_table.h"
 
 #include <cctype>
 #include <cstdint>
+#include <cstring>
+#include <utility>
 #include <vector>
 
 namespace teddy {
@@ -58,16 +62,16 @@ static inline bool is_valid_quote(const char* str, size_t pos) {
     return (backslash_count % 2) == 0;
 }
 
-static inline candidate_result verify_json_key_candidate(const char* str,
-                                                         size_t len,
-                                                         size_t end_quote,
-                                                         const DFA& dfa) {
+// closing quote, followed by optional whitespace and a colon
+static inline candidate_type verify_json_key_terminator(const char* str,
+                                                        size_t len,
+                                                        size_t end_quote) {
     if (end_quote >= len || str[end_quote] != '"') {
-        return {CANDIDATE_BAD_END_QUOTE, 0, 0};
+        return CANDIDATE_BAD_END_QUOTE;
     }
 
     if (!is_valid_quote(str, end_quote)) {
-        return {CANDIDATE_INVALID_QUOTE, 0, 0};
+        return CANDIDATE_INVALID_QUOTE;
     }
 
     size_t j = end_quote + 1;
@@ -76,13 +80,20 @@ static inline candidate_result verify_json_key_candidate(const char* str,
     }
 
     if (j >= len || str[j] != ':') {
-        return {CANDIDATE_MISSING_COLON, 0, 0};
+        return CANDIDATE_MISSING_COLON;
     }
 
-    int32_t current_node = 0;
-    size_t consumed = 0;
+    return CANDIDATE_TYPE_MATCH;
+}
 
-    for (size_t position = end_quote; position > 0;) {
+// walk the reverse trie from `node` down to the opening quote,
+// `position` is one past the next byte to consume
+static inline candidate_result walk_reverse_trie(const char* str,
+                                                 size_t position,
+                                                 int32_t current_node,
+                                                 size_t consumed,
+                                                 const DFA& dfa) {
+    while (position > 0) {
         --position;
         const uint8_t c = static_cast<uint8_t>(str[position]);
 
@@ -110,4 +121,577 @@ static inline candidate_result verify_json_key_candidate(const char* str,
     return {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
 }
 
+static inline candidate_result verify_json_key_candidate(const char* str,
+                                                         size_t len,
+                                                         size_t end_quote,
+                                                         const DFA& dfa) {
+    const candidate_type terminator =
+        verify_json_key_terminator(str, len, end_quote);
+    if (terminator != CANDIDATE_TYPE_MATCH) {
+        return {terminator, 0, 0};
+    }
+
+    return walk_reverse_trie(str, end_quote, 0, 0, dfa);
+}
+
+/*
+    Same walk as above, but the first two trie levels are replaced by a
+    single load from DFA::top_nodes
+*/
+static inline candidate_result verify_json_key_candidate_top_trie(
+    const char* str,
+    size_t len,
+    size_t end_quote,
+    const DFA& dfa) {
+    const candidate_type terminator =
+        verify_json_key_terminator(str, len, end_quote);
+    if (terminator != CANDIDATE_TYPE_MATCH) {
+        return {terminator, 0, 0};
+    }
+
+    if (end_quote < 2 || dfa.max_key_len < 2) {
+        return walk_reverse_trie(str, end_quote, 0, 0, dfa);
+    }
+
+    const uint8_t last = static_cast<uint8_t>(str[end_quote - 1]);
+    const uint8_t second_last = static_cast<uint8_t>(str[end_quote - 2]);
+
+    // keys shorter than two bytes end on a quote within the first two levels
+    if ((last == '"' && is_valid_quote(str, end_quote - 1)) ||
+        (second_last == '"' && is_valid_quote(str, end_quote - 2))) {
+        return walk_reverse_trie(str, end_quote, 0, 0, dfa);
+    }
+
+    const int32_t node = dfa.top_nodes[last | (second_last << 8)];
+    if (node == -1) {
+        return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+    }
+
+    return walk_reverse_trie(str, end_quote - 2, node, 2, dfa);
+}
+
+/*
+    TEDDY_SUFFIX_PREFIX: the hit ends sigma - 1 bytes after the opening
+    quote, the forward trie is walked from there to the closing quote, which
+    is then checked by verify_json_key_terminator
+*/
+static inline candidate_result verify_json_key_candidate_forward(
+    const char* str,
+    size_t len,
+    size_t last_char,
+    int sigma,
+    const DFA& dfa) {
+    if (last_char + 1 < static_cast<size_t>(sigma)) {
+        return {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+    }
+    const size_t open_quote = last_char + 1 - sigma;
+    if (str[open_quote] != '"' || !is_valid_quote(str, open_quote)) {
+        return {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+    }
+
+    int32_t current_node = 0;
+    size_t consumed = 0;
+    for (size_t position = open_quote + 1; position < len; ++position) {
+        const uint8_t c = static_cast<uint8_t>(str[position]);
+
+        if (c == '"' && is_valid_quote(str, position)) {
+            const int32_t key_id = dfa.nodes[current_node].key_id;
+            if (key_id == -1) {
+                return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+            }
+            const candidate_type terminator =
+                verify_json_key_terminator(str, len, position);
+            if (terminator != CANDIDATE_TYPE_MATCH) {
+                return {terminator, 0, 0};
+            }
+            return {CANDIDATE_TYPE_MATCH, open_quote + 1,
+                    static_cast<uint32_t>(key_id)};
+        }
+
+        if (consumed >= dfa.max_key_len) {
+            return {CANDIDATE_BAD_END_QUOTE, 0, 0};
+        }
+
+        const int32_t next_node = dfa.nodes[current_node].children[c];
+        if (next_node == -1) {
+            return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+        }
+
+        current_node = next_node;
+        ++consumed;
+    }
+
+    return {CANDIDATE_BAD_END_QUOTE, 0, 0};
+}
+
+// closing quote of a key matched at `position`, the first unescaped one
+static inline size_t closing_quote(const char* str,
+                                   size_t len,
+                                   size_t position) {
+    while (position < len &&
+           (str[position] != '"' || !is_valid_quote(str, position))) {
+        ++position;
+    }
+    return position;
+}
+
+// lower bound of (hi, lo) in a sorted bucket without data dependent branches
+static inline uint32_t find_short_key(const ShortKeyTable& table,
+                                      size_t key_len,
+                                      uint64_t lo,
+                                      uint64_t hi) {
+    const uint32_t begin = table.bucket_offsets[key_len];
+    const uint32_t end = table.bucket_offsets[key_len + 1];
+    if (begin == end) {
+        return end;
+    }
+
+    const uint64_t* his = table.hi.data();
+    const uint64_t* los = table.lo.data();
+    uint32_t base = begin;
+    uint32_t count = end - begin;
+    while (count > 1) {
+        const uint32_t half = count / 2;
+        const uint32_t probe = base + half - 1;
+        const bool less =
+            (his[probe] < hi) | ((his[probe] == hi) & (los[probe] < lo));
+        base += less ? half : 0;
+        count -= half;
+    }
+
+    const bool less = (his[base] < hi) | ((his[base] == hi) & (los[base] < lo));
+    base += less ? 1 : 0;
+    if (base < end && his[base] == hi && los[base] == lo) {
+        return base;
+    }
+    return end;
+}
+
+/*
+    - keys of up to 16 bytes are loaded once as two zero padded words and
+      looked up in their length bucket
+    - only candidates without an opening quote in the last 17 bytes fall back
+      to the reverse trie
+*/
+static inline candidate_result verify_json_key_candidate_swar(
+    const char* str,
+    size_t len,
+    size_t end_quote,
+    const DFA& dfa) {
+    const candidate_type terminator =
+        verify_json_key_terminator(str, len, end_quote);
+    if (terminator != CANDIDATE_TYPE_MATCH) {
+        return {terminator, 0, 0};
+    }
+
+    const ShortKeyTable& table = dfa.short_keys;
+    if (table.empty()) {
+        return walk_reverse_trie(str, end_quote, 0, 0, dfa);
+    }
+
+    const size_t lowest = end_quote > SHORT_KEY_MAX_LEN
+                              ? end_quote - SHORT_KEY_MAX_LEN - 1
+                              : 0;
+    size_t open_quote = end_quote;
+    for (size_t position = end_quote; position > lowest;) {
+        --position;
+        if (str[position] == '"' && is_valid_quote(str, position)) {
+            open_quote = position;
+            break;
+        }
+    }
+
+    if (open_quote == end_quote) {
+        if (dfa.max_key_len <= SHORT_KEY_MAX_LEN) {
+            return {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+        }
+        return walk_reverse_trie(str, end_quote, 0, 0, dfa);
+    }
+
+    const size_t key_len = end_quote - open_quote - 1;
+    const char* key = str + open_quote + 1;
+
+    unsigned char bytes[2 * SHORT_KEY_MAX_LEN] = {};
+    if (open_quote + 1 + SHORT_KEY_MAX_LEN <= len) {
+        std::memcpy(bytes, key, SHORT_KEY_MAX_LEN);
+        std::memset(bytes + key_len, 0, SHORT_KEY_MAX_LEN);
+    } else {
+        std::memcpy(bytes, key, key_len);
+    }
+
+    uint64_t lo;
+    uint64_t hi;
+    std::memcpy(&lo, bytes, sizeof(lo));
+    std::memcpy(&hi, bytes + sizeof(lo), sizeof(hi));
+
+    const uint32_t index = find_short_key(table, key_len, lo, hi);
+    if (index == table.bucket_offsets[key_len + 1]) {
+        return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+    }
+    return {CANDIDATE_TYPE_MATCH, open_quote + 1, table.key_ids[index]};
+}
+
+// bytes between the window of a key and its end, 0 unless TEDDY_SUFFIX_WINDOW
+// Data: CompilationData, or the constant tables of a generated matcher
+template <typename Data>
+static inline uint32_t window_offset(const Data& data, uint32_t key_id) {
+    return data.key_window_offsets.empty() ? 0
+                                           : data.key_window_offsets[key_id];
+}
+
+/*
+    TEDDY_SUFFIX_WINDOW hits are verified at every window offset of the hit
+    groups, a match only counts at the window offset of its own key, so
+    every key occurrence is reported once
+    - offsets without a quote right after their key end are dropped before
+      verification, most hits pass only a few
+    - offsets are tried in increasing order, and windows lie within their
+      keys, so matches stay in input order
+*/
+template <typename Data>
+static inline uint8_t hit_window_offsets(const Data& data,
+                                         uint8_t hit_groups,
+                                         const char* str,
+                                         size_t len,
+                                         size_t end_quote) {
+    if (data.key_window_offsets.empty()) {
+        return 1;
+    }
+    uint8_t offsets = 0;
+    for (; hit_groups != 0; hit_groups &= hit_groups - 1) {
+        offsets |= data.group_window_offsets[__builtin_ctz(hit_groups)];
+    }
+
+    uint8_t quoted = 0;
+    for (; offsets != 0; offsets &= offsets - 1) {
+        const int offset = __builtin_ctz(offsets);
+        if (end_quote + offset < len && str[end_quote + offset] == '"') {
+            quoted |= static_cast<uint8_t>(1u << offset);
+        }
+    }
+    return quoted;
+}
+
+template <typename Data>
+static inline candidate_result at_window_offset(const Data& data,
+                                               const candidate_result& cr,
+                                               uint32_t offset) {
+    if (cr.type == CANDIDATE_TYPE_MATCH &&
+        window_offset(data, cr.key_id) != offset) {
+        return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+    }
+    return cr;
+}
+
+/*
+    - the sigma bytes ending at end_quote - end_quote_offset are the exact
+      suffix of the hit, one probe gives the keys ending with it
+    - TEDDY_SUFFIX_WINDOW probes once per window offset, moving the window
+      back by the offset
+    - at most one candidate can match: a longer one would contain the opening
+      quote of the shorter one
+*/
+template <int Sigma>
+static inline candidate_result verify_json_key_candidate(
+    const char* str,
+    size_t len,
+    size_t end_quote,
+    const CompilationData& data) {
+    const candidate_type terminator =
+        verify_json_key_terminator(str, len, end_quote);
+    if (terminator != CANDIDATE_TYPE_MATCH) {
+        return {terminator, 0, 0};
+    }
+
+    if (end_quote + 1 < Sigma + data.end_quote_offset) {
+        return {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+    }
+
+    const SuffixTable& table = data.suffix_table;
+    for (uint32_t offsets = data.window_offsets; offsets != 0;
+         offsets &= offsets - 1) {
+        const uint32_t offset = __builtin_ctz(offsets);
+        if (end_quote + 1 < Sigma + data.end_quote_offset + offset) {
+            break;
+        }
+
+        const size_t window =
+            end_quote + 1 - data.end_quote_offset - offset - Sigma;
+        const uint32_t suffix_id = find_suffix_id(
+            table, encode_suffix(reinterpret_cast<const uint8_t*>(str + window),
+                                 Sigma));
+        if (suffix_id == NO_SUFFIX) {
+            continue;
+        }
+
+        const uint32_t end = table.candidate_offsets[suffix_id + 1];
+        for (uint32_t i = table.candidate_offsets[suffix_id]; i < end; ++i) {
+            const SuffixTableCandidate& candidate = table.candidates[i];
+            if (end_quote < candidate.key_len + 1 ||
+                window_offset(data, candidate.key_id) != offset) {
+                continue;
+            }
+
+            const size_t open_quote = end_quote - candidate.key_len - 1;
+            if (str[open_quote] == '"' && is_valid_quote(str, open_quote) &&
+                std::memcmp(str + open_quote + 1,
+                            table.key_bytes.data() + candidate.key_offset,
+                            candidate.key_len) == 0) {
+                return {CANDIDATE_TYPE_MATCH, open_quote + 1,
+                        candidate.key_id};
+            }
+        }
+    }
+
+    return {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+}
+
+// group holding the exact suffix at `suffix`, -1 if no key ends with it
+template <int Sigma>
+static inline int exact_suffix_group(const CompilationData& data,
+                                     const uint8_t* suffix) {
+    if (!data.suffix_table.empty()) {
+        const uint32_t suffix_id = find_suffix_id(
+            data.suffix_table, encode_suffix(suffix, Sigma));
+        return suffix_id == NO_SUFFIX
+                   ? -1
+                   : data.suffix_table.suffix_groups[suffix_id];
+    }
+
+    for (int group = 0; group < data.num_groups; ++group) {
+        if (group_has_exact_suffix<Sigma>(data, group, suffix)) {
+            return group;
+        }
+    }
+    return -1;
+}
+
+class DfaVerifier {
+   public:
+    static constexpr bool BATCHED = false;
+
+    explicit DfaVerifier(const DFA& dfa) : dfa_(dfa) {}
+
+    candidate_result operator()(const char* str,
+                                size_t len,
+                                size_t end_quote) const {
+        return verify_json_key_candidate(str, len, end_quote, dfa_);
+    }
+
+   private:
+    const DFA& dfa_;
+};
+
+class TopTrieVerifier {
+   public:
+    static constexpr bool BATCHED = false;
+
+    explicit TopTrieVerifier(const DFA& dfa) : dfa_(dfa) {}
+
+    candidate_result operator()(const char* str,
+                                size_t len,
+                                size_t end_quote) const {
+        return verify_json_key_candidate_top_trie(str, len, end_quote, dfa_);
+    }
+
+   private:
+    const DFA& dfa_;
+};
+
+class SwarVerifier {
+   public:
+    static constexpr bool BATCHED = false;
+
+    explicit SwarVerifier(const DFA& dfa) : dfa_(dfa) {}
+
+    candidate_result operator()(const char* str,
+                                size_t len,
+                                size_t end_quote) const {
+        return verify_json_key_candidate_swar(str, len, end_quote, dfa_);
+    }
+
+   private:
+    const DFA& dfa_;
+};
+
+class ForwardDfaVerifier {
+   public:
+    static constexpr bool BATCHED = false;
+
+    explicit ForwardDfaVerifier(const CompilationData& data) : data_(data) {}
+
+    // `last_char` is the hit, end_quote_offset is 0 in PREFIX mode
+    candidate_result operator()(const char* str,
+                                size_t len,
+                                size_t last_char) const {
+        return verify_json_key_candidate_forward(str, len, last_char,
+                                                 data_.sigma,
+                                                 data_.forward_dfa);
+    }
+
+   private:
+    const CompilationData& data_;
+};
+
+template <int Sigma>
+class SuffixTableVerifier {
+   public:
+    static constexpr bool BATCHED = false;
+
+    explicit SuffixTableVerifier(const CompilationData& data) : data_(data) {}
+
+    candidate_result operator()(const char* str,
+                                size_t len,
+                                size_t end_quote) const {
+        return verify_json_key_candidate<Sigma>(str, len, end_quote, data_);
+    }
+
+   private:
+    const CompilationData& data_;
+};
+
+inline constexpr size_t PIPELINE_WIDTH = 16;
+
+/*
+    Queues candidates that pass the end quote / colon check, then walks up to
+    PIPELINE_WIDTH of them through the reverse trie together:
+    - every round advances each candidate by one trie level
+    - the node needed next round is prefetched, so the cache misses of
+      different candidates overlap instead of stalling one after another
+    - rejected candidates are handed back right away, queued ones in submit
+      order, so matches keep their order
+    - `tag` is handed back untouched with the result of its candidate
+*/
+class PipelinedDfaVerifier {
+   public:
+    static constexpr bool BATCHED = true;
+
+    explicit PipelinedDfaVerifier(const DFA& dfa) : dfa_(dfa) {}
+
+    template <typename Handler>
+    void submit(const char* str,
+                size_t len,
+                size_t end_quote,
+                uint32_t tag,
+                Handler&& handle) {
+        const candidate_type terminator =
+            verify_json_key_terminator(str, len, end_quote);
+        if (terminator != CANDIDATE_TYPE_MATCH) {
+            handle(candidate_result{terminator, 0, 0}, tag);
+            return;
+        }
+
+        if (end_quote > 0) {
+            const uint8_t c = static_cast<uint8_t>(str[end_quote - 1]);
+            __builtin_prefetch(&dfa_.nodes[0].children[c]);
+        }
+        lanes_[count_] = {end_quote, 0, static_cast<uint32_t>(count_), 0};
+        tags_[count_] = tag;
+        if (++count_ == PIPELINE_WIDTH) {
+            flush(str, handle);
+        }
+    }
+
+    template <typename Handler>
+    void flush(const char* str, Handler&& handle) {
+        candidate_result results[PIPELINE_WIDTH];
+        const TrieNode* nodes = dfa_.nodes.data();
+
+        size_t active = count_;
+        while (active > 0) {
+            size_t still_active = 0;
+            for (size_t i = 0; i < active; ++i) {
+                Lane lane = lanes_[i];
+                if (lane.position == 0) {
+                    results[lane.slot] = {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+                    continue;
+                }
+
+                --lane.position;
+                const uint8_t c = static_cast<uint8_t>(str[lane.position]);
+
+                if (c == '"' && is_valid_quote(str, lane.position)) {
+                    const int32_t key_id = nodes[lane.node].key_id;
+                    results[lane.slot] =
+                        key_id != -1
+                            ? candidate_result{CANDIDATE_TYPE_MATCH,
+                                               lane.position + 1,
+                                               static_cast<uint32_t>(key_id)}
+                            : candidate_result{CANDIDATE_KEY_NOT_FOUND, 0, 0};
+                    continue;
+                }
+
+                if (lane.consumed >= dfa_.max_key_len) {
+                    results[lane.slot] = {CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+                    continue;
+                }
+
+                const int32_t next_node = nodes[lane.node].children[c];
+                if (next_node == -1) {
+                    results[lane.slot] = {CANDIDATE_KEY_NOT_FOUND, 0, 0};
+                    continue;
+                }
+
+                lane.node = next_node;
+                ++lane.consumed;
+                if (lane.position > 0) {
+                    const uint8_t next_c =
+                        static_cast<uint8_t>(str[lane.position - 1]);
+                    __builtin_prefetch(&nodes[next_node].children[next_c]);
+                }
+                lanes_[still_active++] = lane;
+            }
+            active = still_active;
+        }
+
+        for (size_t slot = 0; slot < count_; ++slot) {
+            handle(results[slot], tags_[slot]);
+        }
+        count_ = 0;
+    }
+
+   private:
+    struct Lane {
+        size_t position;
+        int32_t node;
+        uint32_t slot;
+        size_t consumed;
+    };
+
+    const DFA& dfa_;
+    Lane lanes_[PIPELINE_WIDTH];
+    uint32_t tags_[PIPELINE_WIDTH];
+    size_t count_ = 0;
+};
+
+template <int Sigma, typename Function>
+decltype(auto) dispatch_verifier(const CompilationData& data,
+                                 const DFA& dfa,
+                                 Function&& function) {
+    if (data.prefix) {
+        return std::forward<Function>(function)(ForwardDfaVerifier(data));
+    }
+    switch (data.verifier) {
+        case TEDDY_VERIFY_DFA:
+            return std::forward<Function>(function)(DfaVerifier(dfa));
+        case TEDDY_VERIFY_SUFFIX_TABLE:
+            return std::forward<Function>(function)(
+                SuffixTableVerifier<Sigma>(data));
+        case TEDDY_VERIFY_TOP_TRIE:
+            if (dfa.top_nodes.empty()) {
+                throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                                   "Teddy top trie verifier needs a DFA "
+                                   "compiled for it");
+            }
+            return std::forward<Function>(function)(TopTrieVerifier(dfa));
+        case TEDDY_VERIFY_PIPELINED:
+            return std::forward<Function>(function)(PipelinedDfaVerifier(dfa));
+        case TEDDY_VERIFY_SWAR:
+            return std::forward<Function>(function)(SwarVerifier(dfa));
+        default:
+            throw FindkeyError(FindkeyErrorCode::INVALID_ARGUMENT,
+                               "Unknown Teddy verifier");
+    }
+}
+
 }  // namespace teddy
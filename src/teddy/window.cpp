@@ -0,0 +1,166 @@
+#include "teddy/window.h"
+
+#include "teddy/compile.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace teddy {
+namespace {
+
+int max_window_offset(std::string_view key, int sigma) {
+    return std::min(static_cast<int>(key.size()) - sigma, MAX_WINDOW_OFFSET);
+}
+
+Suffix window_suffix(std::string_view key, int sigma, int offset) {
+    Suffix suffix{};
+    const size_t begin = key.size() - offset - sigma;
+    for (int i = 0; i < sigma; ++i) {
+        suffix[i] = static_cast<uint8_t>(key[begin + i]);
+    }
+    return suffix;
+}
+
+// share of every byte in the input
+std::array<double, 256> byte_shares(const findkey_byte_histogram* histogram) {
+    uint64_t total = 0;
+    for (int byte = 0; byte < 256 && histogram; ++byte) {
+        total += histogram->counts[byte];
+    }
+    std::array<double, 256> shares{};
+    for (int byte = 0; byte < 256; ++byte) {
+        shares[byte] = total == 0 ? 1.0 / 256
+                                  : static_cast<double>(
+                                        histogram->counts[byte]) /
+                                        static_cast<double>(total);
+    }
+    return shares;
+}
+
+// chance that a position passes the nibble masks of a group's windows,
+// summed in byte order so equal masks give equal chances
+double pass_probability(const std::vector<std::string_view>& keys,
+                        const std::vector<uint32_t>& key_ids,
+                        int sigma,
+                        int offset,
+                        const std::array<double, 256>& shares) {
+    std::array<uint16_t, FINDKEY_TEDDY_MAX_SIGMA> low{};
+    std::array<uint16_t, FINDKEY_TEDDY_MAX_SIGMA> high{};
+    for (const uint32_t key_id : key_ids) {
+        const Suffix window = window_suffix(keys[key_id], sigma, offset);
+        for (int i = 0; i < sigma; ++i) {
+            low[i] |= static_cast<uint16_t>(1u << (window[i] & 0x0F));
+            high[i] |= static_cast<uint16_t>(1u << (window[i] >> 4));
+        }
+    }
+
+    double probability = 1;
+    for (int i = 0; i < sigma; ++i) {
+        double passing = 0;
+        for (int byte = 0; byte < 256; ++byte) {
+            if (((low[i] >> (byte & 0x0F)) & (high[i] >> (byte >> 4)) & 1u) !=
+                0) {
+                passing += shares[byte];
+            }
+        }
+        probability *= passing;
+    }
+    return probability;
+}
+
+}  // namespace
+
+SuffixSet window_suffixes(const std::vector<std::string_view>& keys,
+                          int sigma,
+                          const std::vector<uint8_t>& key_window_offsets) {
+    SuffixSet prepared;
+    prepared.sigma = sigma;
+    prepared.end_quote_offset = 1;
+    prepared.key_suffix_ids.reserve(keys.size());
+    prepared.key_window_offsets = key_window_offsets;
+
+    std::unordered_map<uint64_t, uint32_t> seen;
+    seen.reserve(keys.size());
+    for (size_t key_id = 0; key_id < keys.size(); ++key_id) {
+        const int offset = key_window_offsets[key_id];
+        const Suffix suffix = window_suffix(keys[key_id], sigma, offset);
+
+        const auto [it, inserted] =
+            seen.try_emplace(encode_suffix(suffix.data(), sigma),
+                             static_cast<uint32_t>(prepared.data.size()));
+        if (inserted) {
+            prepared.data.push_back(suffix);
+            prepared.suffix_window_offsets.push_back(0);
+        }
+        prepared.key_suffix_ids.push_back(it->second);
+        prepared.suffix_window_offsets[it->second] |=
+            static_cast<uint8_t>(1u << offset);
+    }
+    return prepared;
+}
+
+WindowAssignment shift_windows(
+    const std::vector<std::string_view>& keys,
+    const SuffixSet& suffixes,
+    const std::vector<std::vector<uint32_t>>& group_suffix_ids,
+    const findkey_byte_histogram* histogram) {
+    const int sigma = suffixes.sigma;
+
+    std::vector<uint32_t> suffix_group(suffixes.data.size());
+    for (uint32_t group = 0; group < group_suffix_ids.size(); ++group) {
+        for (const uint32_t suffix_id : group_suffix_ids[group]) {
+            suffix_group[suffix_id] = group;
+        }
+    }
+    std::vector<std::vector<uint32_t>> group_key_ids(group_suffix_ids.size());
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        group_key_ids[suffix_group[suffixes.key_suffix_ids[key_id]]].push_back(
+            key_id);
+    }
+
+    const std::array<double, 256> shares = byte_shares(histogram);
+    std::vector<uint8_t> offsets(keys.size(), 0);
+    for (const std::vector<uint32_t>& key_ids : group_key_ids) {
+        int last = MAX_WINDOW_OFFSET;
+        for (const uint32_t key_id : key_ids) {
+            last = std::min(last, max_window_offset(keys[key_id], sigma));
+        }
+
+        int best_offset = 0;
+        double best = pass_probability(keys, key_ids, sigma, 0, shares) /
+                      MIN_WINDOW_GAIN;
+        for (int offset = 1; offset <= last; ++offset) {
+            const double candidate =
+                pass_probability(keys, key_ids, sigma, offset, shares);
+            if (candidate <= best) {
+                best = candidate;
+                best_offset = offset;
+            }
+        }
+        for (const uint32_t key_id : key_ids) {
+            offsets[key_id] = static_cast<uint8_t>(best_offset);
+        }
+    }
+
+    WindowAssignment assignment;
+    assignment.suffixes = window_suffixes(keys, sigma, offsets);
+    const std::vector<uint32_t>& key_suffix_ids =
+        assignment.suffixes.key_suffix_ids;
+    std::vector<bool> placed(assignment.suffixes.data.size(), false);
+    assignment.group_suffix_ids.resize(group_suffix_ids.size());
+    for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+        const uint32_t suffix_id = key_suffix_ids[key_id];
+        if (!placed[suffix_id]) {
+            placed[suffix_id] = true;
+            assignment
+                .group_suffix_ids[suffix_group[suffixes.key_suffix_ids[key_id]]]
+                .push_back(suffix_id);
+        }
+    }
+    std::erase_if(assignment.group_suffix_ids,
+                  [](const auto& group) { return group.empty(); });
+    return assignment;
+}
+
+}  // namespace teddy
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "findkey.h"
+#include "teddy/suffix.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace teddy {
+
+// unique windows of keys at the given offsets
+SuffixSet window_suffixes(const std::vector<std::string_view>& keys,
+                          int sigma,
+                          const std::vector<uint8_t>& key_window_offsets);
+
+struct WindowAssignment {
+    SuffixSet suffixes;
+    std::vector<std::vector<uint32_t>> group_suffix_ids;
+};
+
+/*
+    Moves the windows of every group, grouped on the key ends, to one
+    common offset of at most MAX_WINDOW_OFFSET bytes before the key end
+    - the offset whose nibble masks the input is least likely to pass by its
+      byte histogram (uniform when NULL), then the one closest to the key end
+    - the key end is kept unless an offset is MIN_WINDOW_GAIN times less
+      likely to pass: the histogram takes window bytes as independent, and
+      the end is next to the quote every hit is checked for
+    - one offset per group keeps a hit verified once per hit group
+    - a window shared by keys of several groups stays in the group of its
+      first key, with every offset it is used at
+*/
+inline constexpr double MIN_WINDOW_GAIN = 2;
+
+WindowAssignment shift_windows(
+    const std::vector<std::string_view>& keys,
+    const SuffixSet& suffixes,
+    const std::vector<std::vector<uint32_t>>& group_suffix_ids,
+    const findkey_byte_histogram* histogram);
+
+}  // namespace teddy
@@ -51,5 +51,7 @@ TEST(TeddyConfigurationsTest, ExpandsTheCompleteTeddyConfigurationMatrix) {
 
     EXPECT_EQ(configurations.size(), grouping_configurations.size() *
                                          teddy::ALL_SUFFIX_MODES.size() *
-                                         teddy::ALL_SIGMAS.size());
+                                         teddy::ALL_SIGMAS.size() *
+                                         teddy::ALL_VERIFIERS.size() *
+                                         teddy::ALL_SCAN_MODES.size());
 }
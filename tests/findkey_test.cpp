@@ -1,10 +1,21 @@
 #include "utils.h"
 
+#include "core/database.h"
+#include "core/key_dfa.h"
+#include "core/query.h"
+#include "core/teddy_auto.h"
+#include "matchers/matcher_scalar.h"
+#include "matchers/matcher_teddy.h"
+#include "matchers/matcher_teddy_baseline.h"
+#include "teddy/compile.h"
 #include "teddy/configurations.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -12,11 +23,20 @@
 namespace {
 
 using findkey_test::ApiRun;
+using findkey_test::expect_same_results;
 using findkey_test::expect_success;
 using findkey_test::expect_teddy_matchers_match;
 using findkey_test::expect_teddy_matches_scalar;
+using findkey_test::for_each_teddy_config;
+using findkey_test::KeyArrays;
+using findkey_test::load_dense_matrix_json;
 using findkey_test::load_json_fixture;
+using findkey_test::make_key_arrays;
+using findkey_test::MATRIX_KEYS;
+using findkey_test::MATRIX_KEYS_WITH_EXTRAS;
 using findkey_test::run_findkey;
+using findkey_test::simd_teddy_availability;
+using findkey_test::SimdTeddyAvailability;
 
 }  // namespace
 
@@ -90,15 +110,122 @@ TEST(FindkeyDifferentialTest, MatchesScalarForJsonEdgeCases) {
         ASSERT_EQ(scalar.total, test_case.expected_matches);
 
         for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
-            findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
-            config.suffix_mode = suffix_mode;
-            config.sigma = 4;
-            expect_teddy_matchers_match(scalar, test_case.json, test_case.keys,
-                                        &config);
+            for (const auto verifier : teddy::ALL_VERIFIERS) {
+                findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+                config.suffix_mode = suffix_mode;
+                config.sigma = 4;
+                config.verifier = verifier;
+                expect_teddy_matchers_match(scalar, test_case.json,
+                                            test_case.keys, &config);
+            }
         }
     }
 }
 
+TEST(FindkeyDifferentialTest, SuffixTableResolvesKeysSharingASuffix) {
+    constexpr std::string_view json =
+        R"({"user_id":1,"id":2,"order_id":3,"x_id":4,"_id":5,"d":"id"})";
+    const std::vector<std::string_view> keys = {"user_id", "id", "order_id",
+                                                "_id", "missing_id"};
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+    ASSERT_EQ(scalar.total, 4u);
+
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+        config.suffix_mode = suffix_mode;
+        config.verifier = TEDDY_VERIFY_SUFFIX_TABLE;
+        expect_teddy_matchers_match(scalar, json, keys, &config);
+    }
+}
+
+TEST(FindkeyDifferentialTest, WindowModeMovesOffCommonKeyEnds) {
+    constexpr std::string_view json =
+        R"({"user_id":1,"id":"did id","order_id":3,"ids":["idid","didi"]})";
+    const std::vector<std::string_view> keys = {"user_id", "order_id"};
+
+    findkey_byte_histogram histogram{};
+    for (const char byte : json) {
+        ++histogram.counts[static_cast<uint8_t>(byte)];
+    }
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    config.suffix_mode = TEDDY_SUFFIX_WINDOW;
+    config.sigma = 2;
+    config.grouping.byte_histogram = &histogram;
+
+    const teddy::CompilationData data = teddy::compile(keys, config);
+    ASSERT_EQ(data.key_window_offsets.size(), keys.size());
+    for (const uint8_t offset : data.key_window_offsets) {
+        EXPECT_GT(offset, 0);
+    }
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+    ASSERT_EQ(scalar.total, 2u);
+    for (const auto verifier : teddy::ALL_VERIFIERS) {
+        config.verifier = verifier;
+        expect_teddy_matchers_match(scalar, json, keys, &config);
+    }
+}
+
+TEST(FindkeyDifferentialTest, PrefixModeVerifiesForwardFromTheOpeningQuote) {
+    constexpr std::string_view json =
+        R"({"user_id":1,"user_idx":2,"user":3,"order_id" :4,)"
+        R"("x":"item_id","acc\"ount_id":5,"item_id")";
+    const std::vector<std::string_view> keys = {"user_id", "order_id",
+                                                "item_id", "account_id"};
+
+    // every key ends with "_id", their first bytes differ
+    EXPECT_EQ(teddy::resolve_suffix_mode(keys, 3), TEDDY_SUFFIX_PREFIX);
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    config.suffix_mode = TEDDY_SUFFIX_AUTO;
+    EXPECT_TRUE(teddy::compile(keys, config).prefix);
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+    ASSERT_EQ(scalar.total, 2u);
+    for (const auto scan_mode : teddy::ALL_SCAN_MODES) {
+        for (const auto verifier : teddy::ALL_VERIFIERS) {
+            config.scan_mode = scan_mode;
+            config.verifier = verifier;
+            expect_teddy_matchers_match(scalar, json, keys, &config);
+        }
+    }
+
+    // dense enough for the adaptive scan to hand keys to the tokenizer
+    std::string dense = "[";
+    for (int i = 0; i < 4000; ++i) {
+        dense += i % 16 == 0 ? R"({"user_id":1},)" : R"("use",)";
+    }
+    dense += R"({"item_id":2}])";
+
+    const ApiRun dense_scalar = run_findkey(dense, keys, SCALAR);
+    ASSERT_TRUE(expect_success(dense_scalar));
+    config.suffix_mode = TEDDY_SUFFIX_PREFIX;
+    config.scan_mode = TEDDY_SCAN_ADAPTIVE;
+    config.verifier = TEDDY_VERIFY_DFA;
+    expect_teddy_matchers_match(dense_scalar, dense, keys, &config);
+
+    if (findkey_test::simd_teddy_availability() !=
+        findkey_test::SimdTeddyAvailability::Available) {
+        return;
+    }
+
+    const KeyArrays c_keys = make_key_arrays(keys);
+    findkey_teddy_stats stats{};
+    int status = FINDKEY_ERR_BAD_ARGS;
+    const size_t total = findkey_with_stats(
+        reinterpret_cast<const uint8_t*>(dense.data()), dense.size(),
+        c_keys.ptrs.data(), c_keys.lens.data(), keys.size(), &config, &stats,
+        &status, nullptr);
+
+    EXPECT_EQ(status, FINDKEY_OK);
+    EXPECT_EQ(total, dense_scalar.total);
+    EXPECT_GT(stats.switches_to_tokenizer, 0u);
+    EXPECT_GT(stats.tokenizer_bytes, 0u);
+}
+
 TEST(FindkeyDifferentialTest, MatchesScalarWithDefaultTeddyConfiguration) {
     constexpr std::string_view json =
         R"({"alpha":1,"bravo":2,"value":"alpha"})";
@@ -113,14 +240,116 @@ TEST(FindkeyDifferentialTest, MatchesScalarWhenShortKeyCapsSigma) {
     constexpr std::string_view json = R"({"a":1,"ab":2,"abc":3,"abcd":4})";
     const std::vector<std::string_view> keys = {"a", "ab", "abc", "abcd"};
 
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        for (const auto verifier : teddy::ALL_VERIFIERS) {
+            findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+            config.suffix_mode = suffix_mode;
+            config.sigma = 4;
+            config.verifier = verifier;
+            expect_teddy_matches_scalar(json, keys, config);
+        }
+    }
+}
+
+TEST(FindkeyDifferentialTest, SwarVerifierHandlesKeysAroundSixteenBytes) {
+    constexpr std::string_view json =
+        R"({"abcdefghijklmnop":1,"bcdefghijklmnop":2,)"
+        R"("abcdefghijklmnopq":3,"xabcdefghijklmnopq":4,)"
+        R"("a\"bcdefghijklmnop":5,"":6,"abcdefghijklmnop":7})";
+    const std::vector<std::string_view> keys = {
+        "abcdefghijklmnop", "bcdefghijklmnop", "abcdefghijklmnopq",
+        R"(a\"bcdefghijklmnop)"};
+
     for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
         findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
         config.suffix_mode = suffix_mode;
-        config.sigma = 4;
+        config.verifier = TEDDY_VERIFY_SWAR;
         expect_teddy_matches_scalar(json, keys, config);
     }
 }
 
+TEST(FindkeyDifferentialTest, AdaptiveScanMatchesScalarAcrossSwitches) {
+    // sparse regions stay on Teddy, every "_id" string in the dense ones is
+    // a rejected candidate
+    std::string json = "[";
+    for (int region = 0; region < 4; ++region) {
+        for (int i = 0; i < 2000; ++i) {
+            if (region % 2 == 0) {
+                json += R"({"name":"n","count":12345,"flag":true},)";
+            } else if (i % 10 == 0) {
+                json += R"({"user_id":"a_id","q\"_id":"\\_id"},)";
+            } else {
+                json += R"(["_id","_id","_id","c\"_id"],)";
+            }
+        }
+    }
+    json += R"({"order_id":0}])";
+
+    const std::vector<std::string_view> keys = {"user_id", "order_id",
+                                                R"(q\"_id)", "name"};
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+
+    for (const auto verifier : teddy::ALL_VERIFIERS) {
+        findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+        config.verifier = verifier;
+        config.scan_mode = TEDDY_SCAN_ADAPTIVE;
+        expect_teddy_matchers_match(scalar, json, keys, &config);
+
+        if (findkey_test::simd_teddy_availability() !=
+            findkey_test::SimdTeddyAvailability::Available) {
+            continue;
+        }
+
+        const KeyArrays c_keys = make_key_arrays(keys);
+
+        findkey_teddy_stats stats{};
+        int status = FINDKEY_ERR_BAD_ARGS;
+        const size_t total = findkey_with_stats(
+            reinterpret_cast<const uint8_t*>(json.data()), json.size(),
+            c_keys.ptrs.data(), c_keys.lens.data(), keys.size(), &config,
+            &stats, &status, nullptr);
+
+        EXPECT_EQ(status, FINDKEY_OK);
+        EXPECT_EQ(total, scalar.total);
+        EXPECT_EQ(stats.exact_matches, scalar.total);
+        EXPECT_GE(stats.switches_to_tokenizer, 2u);
+        EXPECT_GE(stats.switches_to_teddy, 1u);
+        EXPECT_GT(stats.tokenizer_bytes, 0u);
+    }
+
+    // no key searched for, the handoff is at a rejected key
+    std::string unmatched = R"([{"name":0})";
+    for (int i = 0; i < 2000; ++i) {
+        unmatched += R"(,{"_id":"_id"})";
+    }
+    unmatched += "]";
+
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    config.scan_mode = TEDDY_SCAN_ADAPTIVE;
+    const ApiRun unmatched_scalar = run_findkey(unmatched, keys, SCALAR);
+    ASSERT_TRUE(expect_success(unmatched_scalar));
+    ASSERT_EQ(unmatched_scalar.total, 1u);
+    expect_teddy_matchers_match(unmatched_scalar, unmatched, keys, &config);
+
+    if (findkey_test::simd_teddy_availability() !=
+        findkey_test::SimdTeddyAvailability::Available) {
+        return;
+    }
+
+    const KeyArrays c_keys = make_key_arrays(keys);
+    findkey_teddy_stats stats{};
+    int status = FINDKEY_ERR_BAD_ARGS;
+    EXPECT_EQ(findkey_with_stats(
+                  reinterpret_cast<const uint8_t*>(unmatched.data()),
+                  unmatched.size(), c_keys.ptrs.data(), c_keys.lens.data(),
+                  keys.size(), &config, &stats, &status, nullptr),
+              1u);
+    EXPECT_EQ(status, FINDKEY_OK);
+    EXPECT_GT(stats.switches_to_tokenizer, 0u);
+}
+
 TEST(FindkeyDifferentialTest, MatchesScalarAcrossBlockBoundaries) {
     const std::vector<std::string_view> keys = {"boundary"};
 
@@ -146,10 +375,7 @@ TEST(FindkeyDifferentialTest, MatchesScalarAcrossBlockBoundaries) {
 
 TEST(FindkeyDifferentialTest, MatchesScalarAcrossTeddyConfigurationMatrix) {
     const std::string json = load_json_fixture("configuration_matrix.json");
-    const std::vector<std::string_view> keys = {
-        "alpha", "bravo", "charlie", "delta",  "echo", "foxtrot",
-        "golf",  "hotel", "india",   "juliet", "kilo", "lima",
-    };
+    const std::vector<std::string_view>& keys = MATRIX_KEYS;
 
     const ApiRun scalar = run_findkey(json, keys, SCALAR);
     ASSERT_EQ(scalar.status, FINDKEY_OK);
@@ -166,3 +392,771 @@ TEST(FindkeyDifferentialTest, MatchesScalarAcrossTeddyConfigurationMatrix) {
         expect_teddy_matchers_match(scalar, json, keys, &config);
     }
 }
+
+TEST(FindkeyDifferentialTest, AutoSelectsTheCandidateWithFewestPrefilterHits) {
+    const std::string json = load_json_fixture("configuration_matrix.json");
+    const std::vector<std::string_view>& keys = MATRIX_KEYS;
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    const auto hit_lanes = [&](const findkey_teddy_config& config) {
+        findkey_teddy_stats stats{};
+        int status = FINDKEY_OK;
+        findkey_with_stats(data, json.size(), c_keys.ptrs.data(),
+                           c_keys.lens.data(), keys.size(), &config, &stats,
+                           &status, nullptr);
+        EXPECT_EQ(status, FINDKEY_OK);
+        return stats.prefilter_hit_lanes;
+    };
+
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    config.grouping.strategy = TEDDY_COMPILE_AUTO;
+    config.verifier = TEDDY_VERIFY_SUFFIX_TABLE;
+
+    // the sample is the whole fixture, so its stats are the simulation
+    ASSERT_LE(json.size(), AUTO_SAMPLE_BYTES);
+    const std::vector<findkey_teddy_config> candidates =
+        auto_candidate_configs(config);
+    ASSERT_EQ(candidates.size(), teddy::all_grouping_configurations().size() *
+                                     teddy::ALL_SIGMAS.size());
+    std::vector<uint64_t> candidate_hits;
+    for (const auto& candidate : candidates) {
+        EXPECT_EQ(candidate.verifier, TEDDY_VERIFY_SUFFIX_TABLE);
+        candidate_hits.push_back(hit_lanes(candidate));
+    }
+    const size_t best = std::min_element(candidate_hits.begin(),
+                                         candidate_hits.end()) -
+                        candidate_hits.begin();
+
+    findkey_teddy_config selected{};
+    int status = FINDKEY_ERR_BAD_ARGS;
+    findkey_teddy_select_config(data, json.size(), c_keys.ptrs.data(),
+                                c_keys.lens.data(), keys.size(), &config,
+                                &selected, &status);
+    ASSERT_EQ(status, FINDKEY_OK);
+    EXPECT_EQ(selected.grouping.strategy, candidates[best].grouping.strategy);
+    EXPECT_EQ(selected.grouping.score, candidates[best].grouping.score);
+    EXPECT_EQ(selected.sigma, candidates[best].sigma);
+    EXPECT_EQ(selected.verifier, TEDDY_VERIFY_SUFFIX_TABLE);
+    EXPECT_EQ(hit_lanes(selected), candidate_hits[best]);
+    EXPECT_EQ(hit_lanes(config), candidate_hits[best]);
+
+    expect_teddy_matches_scalar(json, keys, config);
+}
+
+TEST(FindkeyQueryTest, EarlyExitsKeepThePrefixOfTheFullScan) {
+    // every key within the first blocks, then a long tail of repeats
+    std::string json = R"({"alpha":1,"x\"alpha":2,"bravo":{"alpha":3},)"
+                       R"("charlie":[{"echo":4}],"bravo"  :5,)";
+    for (int i = 0; i < 500; ++i) {
+        json += R"("filler":{"alpha":6,"charlie":7},)";
+    }
+    json += R"("lima":8})";
+    const std::vector<std::string_view> keys = {"alpha", "bravo", "charlie",
+                                                "echo", "bravo"};
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+    const auto expected_run = [&](const findkey_query& query) {
+        ApiRun expected = scalar;
+        std::vector<bool> seen(keys.size(), false);
+        std::erase_if(expected.results, [&](const findkey_result& result) {
+            const bool repeated = seen[result.key_id];
+            seen[result.key_id] = true;
+            return query.mode == FINDKEY_QUERY_FIRST_PER_KEY && repeated;
+        });
+        const size_t limit = query.mode == FINDKEY_QUERY_ANY     ? 1
+                             : query.mode == FINDKEY_QUERY_LIMIT ? query.limit
+                                                                 : json.size();
+        expected.results.resize(std::min(expected.results.size(), limit));
+        expected.total = expected.results.size();
+        return expected;
+    };
+    const auto query_run = [&](findkey_algo algo,
+                               const findkey_teddy_config& config,
+                               const findkey_query& query) {
+        ApiRun run;
+        run.results.resize(scalar.total);
+        run.total = findkey_with_query(
+            data, json.size(), c_keys.ptrs.data(), c_keys.lens.data(),
+            keys.size(), algo, &config, &query, run.results.data(),
+            run.results.size(), &run.status, nullptr);
+        run.results.resize(std::min(run.total, run.results.size()));
+        return run;
+    };
+
+    const std::vector<findkey_query> queries = {
+        {FINDKEY_QUERY_ANY, 0},
+        {FINDKEY_QUERY_FIRST_PER_KEY, 0},
+        {FINDKEY_QUERY_LIMIT, 3},
+        {FINDKEY_QUERY_LIMIT, 9},
+    };
+    for (const findkey_query& query : queries) {
+        SCOPED_TRACE(::testing::Message()
+                     << "mode=" << static_cast<int>(query.mode)
+                     << " limit=" << query.limit);
+        const ApiRun expected = expected_run(query);
+        expect_same_results(expected, query_run(SCALAR, {}, query));
+
+        for_each_teddy_config(
+            json, keys,
+            [&](findkey_algo algo, const findkey_teddy_config& config) {
+                expect_same_results(expected, query_run(algo, config, query));
+            },
+            [&](const findkey_db* db, const findkey_teddy_config&) {
+                ApiRun from_db;
+                from_db.results.resize(scalar.total);
+                from_db.total = findkey_db_match_with_query(
+                    db, data, json.size(), &query, from_db.results.data(),
+                    from_db.results.size(), &from_db.status, nullptr);
+                from_db.results.resize(
+                    std::min(from_db.total, from_db.results.size()));
+                expect_same_results(expected, from_db);
+            });
+    }
+
+    // the matchers stop within a block of the last first match, what they
+    // found until then is what the full scan finds first
+    const auto expect_stops_early = [&](const auto& scan) {
+        for (const findkey_query& query : queries) {
+            SCOPED_TRACE(::testing::Message()
+                         << "mode=" << static_cast<int>(query.mode)
+                         << " limit=" << query.limit);
+            ResultQuery result_query(query, keys);
+            const std::vector<findkey_result> full = scan(nullptr);
+            const std::vector<findkey_result> partial =
+                scan(ResultQuery::active(result_query));
+            ASSERT_LT(partial.size(), 20u);
+            ASSERT_GT(full.size(), 1000u);
+            for (size_t i = 0; i < partial.size(); ++i) {
+                SCOPED_TRACE(::testing::Message() << "result index " << i);
+                EXPECT_EQ(partial[i].position, full[i].position);
+                EXPECT_EQ(partial[i].key_id, full[i].key_id);
+            }
+        }
+    };
+    expect_stops_early([&](ResultQuery* query) {
+        return matcher_scalar(json, keys, query);
+    });
+    const teddy::CompilationData teddy_data =
+        teddy::compile(keys, FINDKEY_TEDDY_CONFIG_INIT);
+    const DFA dfa = compile_key_dfa(keys);
+    expect_stops_early([&](ResultQuery* query) {
+        return matcher_teddy_baseline(json, teddy_data, dfa, nullptr, query);
+    });
+    if (simd_teddy_availability() == SimdTeddyAvailability::Available) {
+        expect_stops_early([&](ResultQuery* query) {
+            return matcher_teddy(json, teddy_data, dfa, query);
+        });
+    }
+
+    EXPECT_EQ(query_run(SCALAR, {}, {FINDKEY_QUERY_LIMIT, 0}).status,
+              FINDKEY_ERR_BAD_ARGS);
+    EXPECT_EQ(query_run(SCALAR, {}, {FINDKEY_QUERY_MODE_COUNT, 1}).status,
+              FINDKEY_ERR_BAD_ARGS);
+}
+
+TEST(FindkeyCountTest, CountsEveryKeyOfTheFullScan) {
+    const std::string json = load_dense_matrix_json();
+    const std::vector<std::string_view>& keys = MATRIX_KEYS_WITH_EXTRAS;
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+    std::vector<uint64_t> expected(keys.size(), 0);
+    for (const findkey_result& result : scalar.results) {
+        ++expected[result.key_id];
+    }
+    EXPECT_EQ(expected[12], 0u);
+
+    const auto expect_counts = [&](findkey_algo algo,
+                                   const findkey_teddy_config& config) {
+        std::vector<uint64_t> counts(keys.size(), 7);
+        int status = FINDKEY_ERR_BAD_ARGS;
+        const size_t total = findkey_count(
+            data, json.size(), c_keys.ptrs.data(), c_keys.lens.data(),
+            keys.size(), algo, &config, counts.data(), &status, nullptr);
+        EXPECT_EQ(status, FINDKEY_OK);
+        EXPECT_EQ(total, scalar.total);
+        EXPECT_EQ(counts, expected);
+    };
+
+    expect_counts(SCALAR, FINDKEY_TEDDY_CONFIG_INIT);
+    for_each_teddy_config(
+        json, keys, expect_counts,
+        [&](const findkey_db* db, const findkey_teddy_config&) {
+            std::vector<uint64_t> counts(keys.size(), 7);
+            int status = FINDKEY_ERR_BAD_ARGS;
+            EXPECT_EQ(findkey_db_count(db, data, json.size(), counts.data(),
+                                       &status, nullptr),
+                      scalar.total);
+            EXPECT_EQ(status, FINDKEY_OK);
+            EXPECT_EQ(counts, expected);
+        });
+
+    if (simd_teddy_availability() != SimdTeddyAvailability::Available) {
+        return;
+    }
+    // the adaptive runs above went through the tokenizer
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        SCOPED_TRACE(::testing::Message()
+                     << "suffix_mode=" << static_cast<int>(suffix_mode));
+        findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+        config.suffix_mode = suffix_mode;
+        config.scan_mode = TEDDY_SCAN_ADAPTIVE;
+        findkey_teddy_stats stats{};
+        int status = FINDKEY_ERR_BAD_ARGS;
+        EXPECT_EQ(findkey_with_stats(data, json.size(), c_keys.ptrs.data(),
+                                     c_keys.lens.data(), keys.size(), &config,
+                                     &stats, &status, nullptr),
+                  scalar.total);
+        EXPECT_EQ(status, FINDKEY_OK);
+        EXPECT_GT(stats.switches_to_tokenizer, 0u);
+    }
+}
+
+TEST(FindkeyCursorTest, ResumedCallsReturnTheFullScan) {
+    const std::string json = load_dense_matrix_json();
+    const std::vector<std::string_view>& keys = MATRIX_KEYS_WITH_EXTRAS;
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    // pipelined verifiers and window offsets report in scan order
+    const auto by_position = [](ApiRun run) {
+        std::sort(run.results.begin(), run.results.end(),
+                  [](const findkey_result& a, const findkey_result& b) {
+                      return a.position != b.position
+                                 ? a.position < b.position
+                                 : a.key_id < b.key_id;
+                  });
+        return run;
+    };
+    const ApiRun expected = by_position(run_findkey(json, keys, SCALAR));
+    ASSERT_TRUE(expect_success(expected));
+    ASSERT_GT(expected.total, 8u);
+
+    // next: one call writing into out, returns its count
+    const auto resumed_run = [&](size_t capacity, const auto& next) {
+        ApiRun run;
+        run.status = FINDKEY_OK;
+        findkey_cursor cursor = FINDKEY_CURSOR_INIT;
+        std::vector<findkey_result> out(capacity);
+        while (!cursor.done && run.results.size() <= expected.total) {
+            int status = FINDKEY_ERR_BAD_ARGS;
+            const size_t written = next(cursor, out, status);
+            EXPECT_EQ(status, FINDKEY_OK);
+            if (status != FINDKEY_OK) {
+                run.status = status;
+                break;
+            }
+            EXPECT_LE(written, capacity);
+            EXPECT_TRUE(written == capacity || cursor.done);
+            run.results.insert(run.results.end(), out.begin(),
+                               out.begin() + written);
+        }
+        int status = FINDKEY_ERR_BAD_ARGS;
+        EXPECT_EQ(next(cursor, out, status), 0u);
+        EXPECT_EQ(status, FINDKEY_OK);
+        run.total = run.results.size();
+        return by_position(run);
+    };
+    const auto expect_resumes = [&](findkey_algo algo,
+                                    const findkey_teddy_config& config) {
+        for (const size_t capacity : {size_t{1}, size_t{3}, size_t{64}}) {
+            SCOPED_TRACE(::testing::Message() << "capacity=" << capacity);
+            expect_same_results(
+                expected,
+                resumed_run(capacity, [&](findkey_cursor& cursor,
+                                          std::vector<findkey_result>& out,
+                                          int& status) {
+                    return findkey_with_cursor(
+                        data, json.size(), c_keys.ptrs.data(),
+                        c_keys.lens.data(), keys.size(), algo, &config,
+                        &cursor, out.data(), out.size(), &status, nullptr);
+                }));
+        }
+    };
+
+    expect_resumes(SCALAR, FINDKEY_TEDDY_CONFIG_INIT);
+    // the time limit is dropped, every call must group the keys alike
+    findkey_teddy_config time_limited = FINDKEY_TEDDY_CONFIG_INIT;
+    time_limited.grouping.refine_max_passes = 8;
+    time_limited.grouping.refine_time_limit_ms = 1;
+    expect_resumes(TEDDY_BASELINE, time_limited);
+    for_each_teddy_config(
+        json, keys, expect_resumes,
+        [&](const findkey_db* db, const findkey_teddy_config&) {
+            expect_same_results(
+                expected,
+                resumed_run(2, [&](findkey_cursor& cursor,
+                                   std::vector<findkey_result>& out,
+                                   int& status) {
+                    return findkey_db_match_with_cursor(
+                        db, data, json.size(), &cursor, out.data(),
+                        out.size(), &status, nullptr);
+                }));
+        });
+
+    findkey_cursor past_end = {json.size() + 1, 0, 0};
+    findkey_result result{};
+    int status = FINDKEY_OK;
+    EXPECT_EQ(findkey_with_cursor(data, json.size(), c_keys.ptrs.data(),
+                                  c_keys.lens.data(), keys.size(), SCALAR,
+                                  nullptr, &past_end, &result, 1, &status,
+                                  nullptr),
+              0u);
+    EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+    findkey_cursor cursor = FINDKEY_CURSOR_INIT;
+    EXPECT_EQ(findkey_with_cursor(data, json.size(), c_keys.ptrs.data(),
+                                  c_keys.lens.data(), keys.size(), SCALAR,
+                                  nullptr, &cursor, &result, 0, &status,
+                                  nullptr),
+              0u);
+    EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+}
+
+TEST(FindkeyColumnsTest, ColumnsHoldTheResultsOfFindkey) {
+    const std::string json = load_dense_matrix_json();
+    const std::vector<std::string_view>& keys = MATRIX_KEYS_WITH_EXTRAS;
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    // run: fills the columns, returns the total
+    const auto expect_columns = [&](const ApiRun& expected, const auto& run) {
+        ASSERT_TRUE(expect_success(expected));
+        for (const size_t capacity : {expected.total, size_t{5}}) {
+            SCOPED_TRACE(::testing::Message() << "capacity=" << capacity);
+            std::vector<uint64_t> positions(capacity);
+            std::vector<uint32_t> positions32(capacity);
+            std::vector<uint32_t> key_ids(capacity);
+            std::vector<uint16_t> key_ids16(capacity);
+            const findkey_result_columns wide = {
+                positions.data(), nullptr, key_ids.data(), nullptr, capacity};
+            const findkey_result_columns narrow = {
+                nullptr, positions32.data(), nullptr, key_ids16.data(),
+                capacity};
+            for (const findkey_result_columns& columns : {wide, narrow}) {
+                int status = FINDKEY_ERR_BAD_ARGS;
+                EXPECT_EQ(run(columns, status), expected.total);
+                EXPECT_EQ(status, FINDKEY_OK);
+            }
+            for (size_t i = 0; i < std::min(capacity, expected.total); ++i) {
+                SCOPED_TRACE(::testing::Message() << "result index " << i);
+                EXPECT_EQ(positions[i], expected.results[i].position);
+                EXPECT_EQ(positions32[i], expected.results[i].position);
+                EXPECT_EQ(key_ids[i], expected.results[i].key_id);
+                EXPECT_EQ(key_ids16[i], expected.results[i].key_id);
+            }
+        }
+    };
+    const auto findkey_run = [&](findkey_algo algo,
+                                 const findkey_teddy_config& config) {
+        expect_columns(
+            run_findkey(json, keys, algo, &config),
+            [&](const findkey_result_columns& columns, int& status) {
+                return findkey_columns(data, json.size(), c_keys.ptrs.data(),
+                                       c_keys.lens.data(), keys.size(), algo,
+                                       &config, &columns, &status, nullptr);
+            });
+    };
+
+    findkey_run(SCALAR, FINDKEY_TEDDY_CONFIG_INIT);
+    for_each_teddy_config(
+        json, keys, findkey_run,
+        [&](const findkey_db* db, const findkey_teddy_config& config) {
+            expect_columns(
+                run_findkey(json, keys, TEDDY, &config),
+                [&](const findkey_result_columns& columns, int& status) {
+                    return findkey_db_match_columns(db, data, json.size(),
+                                                    &columns, &status,
+                                                    nullptr);
+                });
+        });
+
+    uint64_t position = 0;
+    uint32_t position32 = 0;
+    uint32_t key_id = 0;
+    const findkey_result_columns both_positions = {&position, &position32,
+                                                   &key_id, nullptr, 1};
+    int status = FINDKEY_OK;
+    EXPECT_EQ(findkey_columns(data, json.size(), c_keys.ptrs.data(),
+                              c_keys.lens.data(), keys.size(), SCALAR, nullptr,
+                              &both_positions, &status, nullptr),
+              0u);
+    EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+}
+
+TEST(FindkeyResultBlockTest, DecodesWhatWasEncoded) {
+    const std::vector<findkey_result> results = {
+        {12, 3}, {12, 0}, {4096, 70000}, {7, 1}, {SIZE_MAX, UINT32_MAX},
+        {0, 2},
+    };
+    int status = FINDKEY_ERR_BAD_ARGS;
+    const size_t size = findkey_results_encode(results.data(), results.size(),
+                                               nullptr, 0, &status);
+    EXPECT_EQ(status, FINDKEY_OK);
+    std::vector<uint8_t> block(size);
+    EXPECT_EQ(findkey_results_encode(results.data(), results.size(),
+                                     block.data(), block.size(), &status),
+              size);
+
+    std::vector<findkey_result> decoded(results.size() + 1);
+    EXPECT_EQ(findkey_results_decode(block.data(), block.size(),
+                                     decoded.data(), decoded.size(), &status),
+              results.size());
+    EXPECT_EQ(status, FINDKEY_OK);
+    for (size_t i = 0; i < results.size(); ++i) {
+        SCOPED_TRACE(::testing::Message() << "result index " << i);
+        EXPECT_EQ(decoded[i].position, results[i].position);
+        EXPECT_EQ(decoded[i].key_id, results[i].key_id);
+    }
+    EXPECT_EQ(findkey_results_decode(block.data(), block.size(), nullptr, 0,
+                                     &status),
+              results.size());
+    EXPECT_EQ(status, FINDKEY_OK);
+
+    // dense results take a few bytes each
+    std::vector<findkey_result> dense;
+    for (size_t i = 0; i < 1000; ++i) {
+        dense.push_back({i * 40, static_cast<uint32_t>(i % 16)});
+    }
+    EXPECT_LE(findkey_results_encode(dense.data(), dense.size(), nullptr, 0,
+                                     &status),
+              2 * dense.size() + 16);
+
+    for (size_t cut = 0; cut < block.size(); ++cut) {
+        SCOPED_TRACE(::testing::Message() << "truncated to " << cut);
+        EXPECT_EQ(findkey_results_decode(block.data(), cut, decoded.data(),
+                                         decoded.size(), &status),
+                  0u);
+        EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+    }
+    std::vector<uint8_t> trailing = block;
+    trailing.push_back(0);
+    EXPECT_EQ(findkey_results_decode(trailing.data(), trailing.size(),
+                                     decoded.data(), decoded.size(), &status),
+              0u);
+    EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+    std::vector<uint8_t> other_version = block;
+    ++other_version[4];
+    findkey_results_decode(other_version.data(), other_version.size(),
+                           decoded.data(), decoded.size(), &status);
+    EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+}
+
+TEST(FindkeyDatabaseTest, DeserializedDatabaseMatchesFindkey) {
+    const std::string json = load_json_fixture("configuration_matrix.json");
+    const std::vector<std::string_view>& keys = MATRIX_KEYS;
+    const KeyArrays c_keys = make_key_arrays(keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        for (const auto verifier : teddy::ALL_VERIFIERS) {
+            SCOPED_TRACE(::testing::Message()
+                         << "suffix_mode=" << static_cast<int>(suffix_mode)
+                         << " verifier=" << static_cast<int>(verifier));
+            findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+            config.suffix_mode = suffix_mode;
+            config.verifier = verifier;
+
+            int status = FINDKEY_ERR_BAD_ARGS;
+            findkey_db* compiled =
+                findkey_db_compile(data, json.size(), c_keys.ptrs.data(),
+                                   c_keys.lens.data(), keys.size(), &config,
+                                   &status);
+            ASSERT_EQ(status, FINDKEY_OK);
+            std::vector<uint8_t> bytes(
+                findkey_db_serialize(compiled, nullptr, 0, &status));
+            ASSERT_EQ(status, FINDKEY_OK);
+            EXPECT_EQ(findkey_db_serialize(compiled, bytes.data(),
+                                           bytes.size(), &status),
+                      bytes.size());
+            findkey_db_free(compiled);
+
+            // the vector storage is aligned for findkey_db_map
+            for (findkey_db* loaded :
+                 {findkey_db_deserialize(bytes.data(), bytes.size(), &status),
+                  findkey_db_map(bytes.data(), bytes.size(), &status)}) {
+                ASSERT_NE(loaded, nullptr);
+                EXPECT_EQ(findkey_db_num_keys(loaded), keys.size());
+                for (uint32_t key_id = 0; key_id < keys.size(); ++key_id) {
+                    size_t key_len = 0;
+                    const uint8_t* key =
+                        findkey_db_key(loaded, key_id, &key_len);
+                    ASSERT_NE(key, nullptr);
+                    EXPECT_EQ(std::string_view(
+                                  reinterpret_cast<const char*>(key),
+                                  key_len),
+                              keys[key_id]);
+                }
+                EXPECT_EQ(findkey_db_key(loaded, keys.size(), nullptr),
+                          nullptr);
+
+                if (simd_teddy_availability() ==
+                    SimdTeddyAvailability::Available) {
+                    const ApiRun expected =
+                        run_findkey(json, keys, TEDDY, &config);
+                    ApiRun actual;
+                    actual.results.resize(expected.total);
+                    actual.total = findkey_db_match(
+                        loaded, data, json.size(), actual.results.data(),
+                        actual.results.size(), &actual.status, nullptr);
+                    expect_same_results(expected, actual);
+                }
+                findkey_db_free(loaded);
+            }
+        }
+    }
+}
+
+TEST(FindkeyDatabaseTest, RejectsDamagedDatabases) {
+    const std::vector<std::string_view> keys = {"alpha", "bravo"};
+    const KeyArrays c_keys = make_key_arrays(keys);
+
+    int status = FINDKEY_ERR_BAD_ARGS;
+    findkey_db* db = findkey_db_compile(nullptr, 0, c_keys.ptrs.data(),
+                                        c_keys.lens.data(), keys.size(),
+                                        nullptr, &status);
+    ASSERT_EQ(status, FINDKEY_OK);
+    std::vector<uint8_t> bytes(findkey_db_serialize(db, nullptr, 0, nullptr));
+    findkey_db_serialize(db, bytes.data(), bytes.size(), nullptr);
+    findkey_db_free(db);
+
+    const auto expect_rejected = [&](const std::vector<uint8_t>& damaged) {
+        int load_status = FINDKEY_OK;
+        EXPECT_EQ(findkey_db_deserialize(damaged.data(), damaged.size(),
+                                         &load_status),
+                  nullptr);
+        EXPECT_EQ(load_status, FINDKEY_ERR_BAD_ARGS);
+    };
+
+    std::vector<uint8_t> damaged = bytes;
+    damaged[0] = 'X';
+    expect_rejected(damaged);
+
+    damaged = bytes;
+    ++damaged[4];  // version
+    expect_rejected(damaged);
+
+    damaged.assign(bytes.begin(), bytes.end() - 8);
+    expect_rejected(damaged);
+
+    damaged.assign(bytes.begin(), bytes.begin() + 24);  // header only
+    expect_rejected(damaged);
+
+    // the key count follows the header and the 8 padded config fields
+    const size_t key_count_offset = 24 + 8 * 8;
+    uint64_t key_count = 0;
+    std::memcpy(&key_count, bytes.data() + key_count_offset,
+                sizeof(key_count));
+    ASSERT_EQ(key_count, keys.size());
+    damaged = bytes;
+    key_count = uint64_t{1} << 62;
+    std::memcpy(damaged.data() + key_count_offset, &key_count,
+                sizeof(key_count));
+    expect_rejected(damaged);
+
+    // a mapped database is read in place, so it has to be aligned
+    damaged.assign(bytes.size() + 1, 0);
+    std::copy(bytes.begin(), bytes.end(), damaged.begin() + 1);
+    int map_status = FINDKEY_OK;
+    EXPECT_EQ(findkey_db_map(damaged.data() + 1, bytes.size(), &map_status),
+              nullptr);
+    EXPECT_EQ(map_status, FINDKEY_ERR_BAD_ARGS);
+}
+
+TEST(FindkeyDatabaseTest, UpdatedDatabaseMatchesARecompiledKeySet) {
+    const std::string json = load_json_fixture("configuration_matrix.json");
+    const std::vector<std::string_view> initial_keys = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot",
+    };
+    const KeyArrays c_keys = make_key_arrays(initial_keys);
+    const auto* data = reinterpret_cast<const uint8_t*>(json.data());
+
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        for (const auto verifier : teddy::ALL_VERIFIERS) {
+            SCOPED_TRACE(::testing::Message()
+                         << "suffix_mode=" << static_cast<int>(suffix_mode)
+                         << " verifier=" << static_cast<int>(verifier));
+            findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+            config.suffix_mode = suffix_mode;
+            config.verifier = verifier;
+
+            int status = FINDKEY_ERR_BAD_ARGS;
+            findkey_db* compiled = findkey_db_compile(
+                data, json.size(), c_keys.ptrs.data(), c_keys.lens.data(),
+                initial_keys.size(), &config, &status);
+            ASSERT_EQ(status, FINDKEY_OK);
+            std::vector<uint8_t> bytes(
+                findkey_db_serialize(compiled, nullptr, 0, &status));
+            findkey_db_serialize(compiled, bytes.data(), bytes.size(),
+                                 &status);
+            findkey_db_free(compiled);
+
+            // updates copy what they change out of the mapped bytes
+            findkey_db* db =
+                findkey_db_map(bytes.data(), bytes.size(), &status);
+            ASSERT_NE(db, nullptr);
+            std::vector<std::string_view> db_keys = initial_keys;
+            const auto add = [&](std::string_view key) {
+                EXPECT_EQ(findkey_db_add_key(
+                              db, reinterpret_cast<const uint8_t*>(key.data()),
+                              key.size(), &status),
+                          db_keys.size());
+                EXPECT_EQ(status, FINDKEY_OK);
+                db_keys.push_back(key);
+            };
+            const auto remove = [&](uint32_t key_id) {
+                findkey_db_remove_key(db, key_id, &status);
+                EXPECT_EQ(status, FINDKEY_OK);
+                db_keys[key_id] = {};
+            };
+            // the live keys compiled from scratch, ids mapped back to db's
+            const auto expect_matches_recompiled = [&] {
+                if (simd_teddy_availability() !=
+                    SimdTeddyAvailability::Available) {
+                    return;
+                }
+                std::vector<std::string_view> live_keys;
+                std::vector<uint32_t> live_ids;
+                for (uint32_t key_id = 0; key_id < db_keys.size(); ++key_id) {
+                    if (!db_keys[key_id].empty()) {
+                        live_keys.push_back(db_keys[key_id]);
+                        live_ids.push_back(key_id);
+                    }
+                }
+                const KeyArrays live = make_key_arrays(live_keys);
+                findkey_db* fresh = findkey_db_compile(
+                    data, json.size(), live.ptrs.data(), live.lens.data(),
+                    live_keys.size(), &config, &status);
+                ASSERT_NE(fresh, nullptr);
+
+                ApiRun expected;
+                expected.results.resize(json.size());
+                expected.total = findkey_db_match(
+                    fresh, data, json.size(), expected.results.data(),
+                    expected.results.size(), &expected.status, nullptr);
+                expected.results.resize(expected.total);
+                for (findkey_result& result : expected.results) {
+                    result.key_id = live_ids[result.key_id];
+                }
+                findkey_db_free(fresh);
+
+                ApiRun actual;
+                actual.results.resize(json.size());
+                actual.total = findkey_db_match(
+                    db, data, json.size(), actual.results.data(),
+                    actual.results.size(), &actual.status, nullptr);
+                actual.results.resize(actual.total);
+                expect_same_results(expected, actual);
+            };
+
+            // a plain add and remove patch one group's table bits in place
+            const double grouped_pass_rate = db->grouped_pass_rate;
+            add("golf");
+            remove(1);
+            EXPECT_EQ(db->grouped_pass_rate, grouped_pass_rate);
+            expect_matches_recompiled();
+
+            for (const auto key :
+                 {"hotel", "india", "juliet", "kilo", "lima", "alpha",
+                  "nested"}) {
+                add(key);
+            }
+            remove(0);  // "alpha" is now matched as id 12
+            remove(4);
+            add("bravo");
+            expect_matches_recompiled();
+            add("ab");  // shorter than the suffixes, regroups every key
+            expect_matches_recompiled();
+            findkey_db_remove_key(db, 4, &status);
+            EXPECT_EQ(status, FINDKEY_ERR_BAD_ARGS);
+            EXPECT_EQ(findkey_db_num_keys(db), db_keys.size());
+
+            std::vector<std::string_view> live_keys;
+            std::vector<uint32_t> live_ids;
+            for (uint32_t key_id = 0; key_id < db_keys.size(); ++key_id) {
+                if (!db_keys[key_id].empty()) {
+                    live_keys.push_back(db_keys[key_id]);
+                    live_ids.push_back(key_id);
+                }
+            }
+            ApiRun expected = run_findkey(json, live_keys, SCALAR);
+            for (findkey_result& result : expected.results) {
+                result.key_id = live_ids[result.key_id];
+            }
+
+            if (simd_teddy_availability() ==
+                SimdTeddyAvailability::Available) {
+                ApiRun actual;
+                actual.results.resize(expected.total);
+                actual.total = findkey_db_match(
+                    db, data, json.size(), actual.results.data(),
+                    actual.results.size(), &actual.status, nullptr);
+                expect_same_results(expected, actual);
+
+                std::vector<uint8_t> updated(
+                    findkey_db_serialize(db, nullptr, 0, &status));
+                findkey_db_serialize(db, updated.data(), updated.size(),
+                                     &status);
+                findkey_db* loaded = findkey_db_deserialize(
+                    updated.data(), updated.size(), &status);
+                ASSERT_NE(loaded, nullptr);
+                actual.total = findkey_db_match(
+                    loaded, data, json.size(), actual.results.data(),
+                    actual.results.size(), &actual.status, nullptr);
+                expect_same_results(expected, actual);
+                findkey_db_free(loaded);
+            }
+            findkey_db_free(db);
+        }
+    }
+}
+
+TEST(FindkeyCompileCacheTest, ReusesCompiledKeySetsAndEvictsTheOldest) {
+    constexpr std::string_view json =
+        R"({"alpha":1,"bravo":2,"charlie":3,"value":"alpha"})";
+    const std::vector<std::string_view> keys = {"alpha", "bravo"};
+    const std::vector<std::string_view> other_keys = {"charlie"};
+    const ApiRun scalar = run_findkey(json, keys, SCALAR);
+    ASSERT_TRUE(expect_success(scalar));
+
+    findkey_set_compile_cache_capacity(2);
+    findkey_reset_compile_cache();
+    const auto cache_stats = [] {
+        findkey_compile_cache_stats stats{};
+        findkey_get_compile_cache_stats(&stats);
+        return stats;
+    };
+
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+    expect_teddy_matchers_match(scalar, json, keys, &config);
+    findkey_compile_cache_stats stats = cache_stats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.capacity, 2u);
+    if (simd_teddy_availability() == SimdTeddyAvailability::Available) {
+        EXPECT_EQ(stats.hits, 1u);
+    }
+
+    // a new config and a new key set each take an entry
+    config.sigma = 2;
+    expect_teddy_matchers_match(scalar, json, keys, &config);
+    ASSERT_TRUE(expect_success(run_findkey(json, other_keys, TEDDY_BASELINE)));
+    stats = cache_stats();
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+
+    // compiled on a sample of the input, never cached
+    config.grouping.strategy = TEDDY_COMPILE_AUTO;
+    expect_teddy_matchers_match(scalar, json, keys, &config);
+    EXPECT_EQ(cache_stats().misses, 3u);
+
+    findkey_set_compile_cache_capacity(0);
+    EXPECT_EQ(cache_stats().entries, 0u);
+    findkey_reset_compile_cache();
+}
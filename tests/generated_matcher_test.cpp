@@ -0,0 +1,56 @@
+#include "utils.h"
+
+#include "configuration_matrix_keys.h"
+#include "quoted_configuration_matrix_keys.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using findkey_test::ApiRun;
+using findkey_test::expect_same_results;
+using findkey_test::load_json_fixture;
+using findkey_test::run_findkey;
+
+ApiRun generated_run(const std::vector<findkey_result>& results) {
+    ApiRun run;
+    run.status = FINDKEY_OK;
+    run.total = results.size();
+    run.results = results;
+    return run;
+}
+
+}  // namespace
+
+TEST(GeneratedMatcherTest, MatchesScalarOverTheBuildTimeKeySet) {
+    const std::vector<std::string_view> keys(
+        std::begin(configuration_matrix_keys::KEYS),
+        std::end(configuration_matrix_keys::KEYS));
+    ASSERT_EQ(keys.size(), 12u);
+    EXPECT_EQ(keys.front(), "alpha");
+
+    const std::vector<std::string> inputs = {
+        load_json_fixture("configuration_matrix.json"),
+        R"({"alpha" : 1, "x\"alpha": 2, "lima": {"kilo": 3}, "alphas": 4,)"
+        R"( "echo": "golf", "\"hotel": 5, "india"   :6})",
+    };
+    for (const std::string& json : inputs) {
+        const ApiRun expected = run_findkey(json, keys, SCALAR);
+        expect_same_results(expected,
+                            generated_run(configuration_matrix_keys::match(
+                                json)));
+        expect_same_results(
+            expected,
+            generated_run(quoted_configuration_matrix_keys::match(json)));
+    }
+
+    static_assert(configuration_matrix_keys::Tables::end_quote_offset == 1);
+    static_assert(
+        quoted_configuration_matrix_keys::Tables::end_quote_offset == 0);
+    static_assert(quoted_configuration_matrix_keys::Tables::sigma == 3);
+}
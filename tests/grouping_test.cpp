@@ -0,0 +1,425 @@
+#include "teddy/compile.h"
+#include "teddy/configurations.h"
+#include "teddy/dispatch.h"
+#include "teddy/grouping.h"
+#include "teddy/grouping/group.h"
+#include "teddy/grouping/merge_deltas.h"
+#include "teddy/grouping/scores/dispatch.h"
+#include "teddy/grouping/scores/frequency.h"
+#include "teddy/grouping/sorted.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using GroupedSuffixIds = std::vector<std::vector<uint32_t>>;
+
+// the quadratic MinDelta loop the incremental builder has to reproduce
+template <teddy::grouping::GroupingScore ScoreModel>
+GroupedSuffixIds reference_min_delta_groups(
+    const std::vector<teddy::Suffix>& suffixes) {
+    using Group = teddy::grouping::SuffixGroup<ScoreModel>;
+
+    std::vector<Group> groups;
+    for (uint32_t i = 0; i < suffixes.size(); ++i) {
+        groups.emplace_back(i, suffixes[i]);
+    }
+
+    while (groups.size() > teddy::MAX_GROUPS) {
+        int64_t best = std::numeric_limits<int64_t>::max();
+        size_t best_i = 0;
+        size_t best_j = 0;
+        for (size_t i = 0; i < groups.size(); ++i) {
+            for (size_t j = i + 1; j < groups.size(); ++j) {
+                const int64_t delta =
+                    static_cast<int64_t>(groups[i].score_if_merged_with(
+                        groups[j])) -
+                    static_cast<int64_t>(groups[i].score() +
+                                         groups[j].score());
+                if (best > delta) {
+                    best = delta;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        groups[best_i].absorb(std::move(groups[best_j]));
+        groups.erase(groups.begin() + best_j);
+    }
+
+    GroupedSuffixIds group_suffix_ids;
+    for (auto& group : groups) {
+        group_suffix_ids.push_back(std::move(group).take_suffix_ids());
+    }
+    return group_suffix_ids;
+}
+
+// the quadratic sorted optimal partition DP the layered one has to reproduce
+template <teddy::grouping::GroupingScore ScoreModel, int Sigma>
+GroupedSuffixIds reference_sorted_optimal_groups(
+    const std::vector<teddy::Suffix>& suffixes) {
+    const std::vector<uint32_t> suffix_ids =
+        teddy::grouping::detail::sorted_suffix_ids<Sigma>(suffixes);
+    const size_t num_groups =
+        std::min(suffix_ids.size(), static_cast<size_t>(teddy::MAX_GROUPS));
+
+    struct PartitionState {
+        uint64_t score = std::numeric_limits<uint64_t>::max();
+        size_t largest_group = std::numeric_limits<size_t>::max();
+        size_t previous_boundary = std::numeric_limits<size_t>::max();
+    };
+    std::vector<std::vector<PartitionState>> dp(
+        num_groups + 1, std::vector<PartitionState>(suffix_ids.size() + 1));
+    dp[0][0] = {0, 0, 0};
+
+    for (size_t begin = 0; begin < suffix_ids.size(); ++begin) {
+        ScoreModel partition_score;
+        for (size_t end = begin + 1; end <= suffix_ids.size(); ++end) {
+            partition_score.add(suffixes[suffix_ids[end - 1]]);
+            const uint64_t group_score = partition_score.value();
+            for (size_t g = 1; g <= std::min(num_groups, begin + 1); ++g) {
+                const PartitionState& prev = dp[g - 1][begin];
+                if (prev.score == std::numeric_limits<uint64_t>::max()) {
+                    continue;
+                }
+                const uint64_t candidate_score = prev.score + group_score;
+                const size_t candidate_largest_group =
+                    std::max(prev.largest_group, end - begin);
+                PartitionState& current = dp[g][end];
+                if (candidate_score < current.score ||
+                    (candidate_score == current.score &&
+                     candidate_largest_group < current.largest_group)) {
+                    current = {candidate_score, candidate_largest_group,
+                               begin};
+                }
+            }
+        }
+    }
+
+    GroupedSuffixIds group_suffix_ids(num_groups);
+    size_t end = suffix_ids.size();
+    for (size_t group_count = num_groups; group_count > 0; --group_count) {
+        const size_t begin = dp[group_count][end].previous_boundary;
+        group_suffix_ids[group_count - 1].assign(suffix_ids.begin() + begin,
+                                                 suffix_ids.begin() + end);
+        end = begin;
+    }
+    return group_suffix_ids;
+}
+
+// small alphabets so that many merges tie on their delta
+std::vector<teddy::Suffix> random_suffixes(size_t count,
+                                           int alphabet,
+                                           uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> byte(0, alphabet - 1);
+
+    std::vector<teddy::Suffix> suffixes(count);
+    for (auto& suffix : suffixes) {
+        for (auto& value : suffix) {
+            value = static_cast<uint8_t>('a' + byte(rng) * 3);
+        }
+    }
+    return suffixes;
+}
+
+template <teddy::grouping::GroupingScore ScoreModel>
+uint64_t total_score(const std::vector<teddy::Suffix>& suffixes,
+                     const GroupedSuffixIds& group_suffix_ids) {
+    uint64_t total = 0;
+    for (const auto& group : group_suffix_ids) {
+        ScoreModel score;
+        for (const uint32_t suffix_id : group) {
+            score.add(suffixes[suffix_id]);
+        }
+        total += score.value();
+    }
+    return total;
+}
+
+// minimum total score over every partition into min(suffixes, MAX_GROUPS)
+// groups
+template <teddy::grouping::GroupingScore ScoreModel>
+uint64_t exhaustive_best_score(const std::vector<teddy::Suffix>& suffixes) {
+    std::vector<uint32_t> group_of(suffixes.size(), 0);
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+
+    const auto visit = [&](auto& self, size_t next, uint32_t used) -> void {
+        if (next == suffixes.size()) {
+            if (used < std::min<size_t>(suffixes.size(), teddy::MAX_GROUPS)) {
+                return;
+            }
+            GroupedSuffixIds groups(used);
+            for (uint32_t i = 0; i < suffixes.size(); ++i) {
+                groups[group_of[i]].push_back(i);
+            }
+            best = std::min(best, total_score<ScoreModel>(suffixes, groups));
+            return;
+        }
+        const uint32_t choices =
+            std::min<uint32_t>(used + 1, teddy::MAX_GROUPS);
+        for (uint32_t group = 0; group < choices; ++group) {
+            group_of[next] = group;
+            self(self, next + 1, std::max(used, group + 1));
+        }
+    };
+    visit(visit, 0, 0);
+    return best;
+}
+
+}  // namespace
+
+TEST(TeddyGroupingTest, IncrementalMinDeltaMatchesQuadraticReference) {
+    for (const int sigma : teddy::ALL_SIGMAS) {
+        for (const auto score : teddy::ALL_GROUPING_SCORES) {
+            for (const size_t count : {3u, 9u, 17u, 64u, 150u}) {
+                for (const int alphabet : {2, 5, 40}) {
+                    SCOPED_TRACE(::testing::Message()
+                                 << "sigma=" << sigma
+                                 << ", score=" << static_cast<int>(score)
+                                 << ", suffixes=" << count
+                                 << ", alphabet=" << alphabet);
+
+                    const auto suffixes = random_suffixes(
+                        count, alphabet, static_cast<uint32_t>(count + sigma));
+                    const GroupedSuffixIds expected =
+                        teddy::dispatch_sigma(sigma, [&]<int Sigma>() {
+                            return teddy::grouping::dispatch_grouping_score<
+                                Sigma>(score, [&]<typename ScoreModel>() {
+                                return reference_min_delta_groups<ScoreModel>(
+                                    suffixes);
+                            });
+                        });
+
+                    const GroupedSuffixIds actual = teddy::build_groups(
+                        suffixes,
+                        {TEDDY_COMPILE_GREEDY_MIN_DELTA, score, nullptr, 0, 0},
+                        sigma);
+                    EXPECT_EQ(actual, expected);
+                }
+            }
+        }
+    }
+}
+
+TEST(TeddyGroupingTest, PackedScoresMatchPairwiseMerge) {
+    for (const int sigma : teddy::ALL_SIGMAS) {
+        for (const auto score : teddy::ALL_GROUPING_SCORES) {
+            SCOPED_TRACE(::testing::Message()
+                         << "sigma=" << sigma
+                         << ", score=" << static_cast<int>(score));
+
+            const auto suffixes =
+                random_suffixes(40, 86, static_cast<uint32_t>(sigma));
+            teddy::dispatch_sigma(sigma, [&]<int Sigma>() {
+                teddy::grouping::dispatch_grouping_score<Sigma>(
+                    score, [&]<typename ScoreModel>() {
+                        using Group = teddy::grouping::SuffixGroup<ScoreModel>;
+
+                        // groups of 1 to 4 suffixes
+                        std::vector<Group> groups;
+                        for (uint32_t i = 0; i < suffixes.size(); ++i) {
+                            if (i % 5 == 0 || groups.empty()) {
+                                groups.emplace_back(i, suffixes[i]);
+                            } else {
+                                groups.back().absorb(Group(i, suffixes[i]));
+                            }
+                        }
+
+                        teddy::grouping::MergeDeltas<ScoreModel> rows;
+                        for (const Group& group : groups) {
+                            rows.push_back(group);
+                        }
+
+                        std::vector<int64_t> deltas(groups.size());
+                        for (const Group& group : groups) {
+                            rows.compute(group, 0, groups.size(),
+                                         deltas.data());
+                            for (size_t k = 0; k < groups.size(); ++k) {
+                                EXPECT_EQ(deltas[k],
+                                          static_cast<int64_t>(
+                                              group.score_if_merged_with(
+                                                  groups[k])) -
+                                              static_cast<int64_t>(
+                                                  group.score() +
+                                                  groups[k].score()));
+                            }
+                        }
+                    });
+            });
+        }
+    }
+}
+
+TEST(TeddyGroupingTest, FrequencyScoreChargesTheNibbleCrossProduct) {
+    using teddy::grouping::ByteFrequencies;
+    using Score = teddy::grouping::FrequencyScore<1>;
+
+    const auto suffix = [](char c) {
+        teddy::Suffix suffix{};
+        suffix[0] = static_cast<uint8_t>(c);
+        return suffix;
+    };
+    const auto value = [&](const ByteFrequencies& frequencies,
+                           std::initializer_list<char> bytes) {
+        Score score(frequencies);
+        for (const char c : bytes) {
+            score.add(suffix(c));
+        }
+        return score.value();
+    };
+
+    // one byte in 256 passes a single byte position
+    EXPECT_EQ(value(ByteFrequencies::uniform(), {'b'}), uint64_t{1} << 32);
+
+    findkey_byte_histogram histogram{};
+    histogram.counts[static_cast<uint8_t>('a')] = uint64_t{1} << 40;
+    const ByteFrequencies frequencies(histogram);
+
+    EXPECT_EQ(value(frequencies, {'b'}), 0u);
+    EXPECT_EQ(value(frequencies, {'q'}), 0u);
+    // 'b' (0x62) and 'q' (0x71) also let 'a' (0x61) through
+    EXPECT_GT(value(frequencies, {'b', 'q'}), uint64_t{255} << 32);
+    EXPECT_EQ(value(frequencies, {'b', 'r'}), 0u);
+}
+
+TEST(TeddyGroupingTest, RefinementKeepsAPartitionAndNeverRaisesTheScore) {
+    constexpr int sigma = 3;
+    const auto suffixes = random_suffixes(300, 40, 7);
+
+    for (const auto& grouping : teddy::all_grouping_configurations()) {
+        SCOPED_TRACE(::testing::Message()
+                     << "strategy=" << static_cast<int>(grouping.strategy)
+                     << ", score=" << static_cast<int>(grouping.score));
+
+        findkey_teddy_grouping_config refined_grouping = grouping;
+        refined_grouping.refine_max_passes = 8;
+
+        const GroupedSuffixIds initial =
+            teddy::build_groups(suffixes, grouping, sigma);
+        const GroupedSuffixIds refined =
+            teddy::build_groups(suffixes, refined_grouping, sigma);
+
+        ASSERT_EQ(refined.size(), initial.size());
+        std::vector<int> seen(suffixes.size(), 0);
+        for (const auto& group : refined) {
+            EXPECT_FALSE(group.empty());
+            for (const uint32_t suffix_id : group) {
+                ++seen[suffix_id];
+            }
+        }
+        EXPECT_EQ(std::count(seen.begin(), seen.end(), 1),
+                  static_cast<std::ptrdiff_t>(suffixes.size()));
+
+        teddy::grouping::dispatch_grouping_score<sigma>(
+            grouping.score, [&]<typename ScoreModel>() {
+                EXPECT_LE(total_score<ScoreModel>(suffixes, refined),
+                          total_score<ScoreModel>(suffixes, initial));
+            });
+    }
+}
+
+TEST(TeddyGroupingTest, BranchAndBoundFindsTheOptimalGrouping) {
+    constexpr int sigma = 2;
+    for (const auto score : teddy::ALL_GROUPING_SCORES) {
+        for (const size_t count : {5u, 9u, 11u}) {
+            SCOPED_TRACE(::testing::Message()
+                         << "score=" << static_cast<int>(score)
+                         << ", suffixes=" << count);
+
+            const auto suffixes =
+                random_suffixes(count, 6, static_cast<uint32_t>(count));
+            const GroupedSuffixIds exact = teddy::build_groups(
+                suffixes,
+                {TEDDY_COMPILE_BRANCH_AND_BOUND, score, nullptr, 0, 0}, sigma);
+            const GroupedSuffixIds greedy = teddy::build_groups(
+                suffixes,
+                {TEDDY_COMPILE_GREEDY_MIN_DELTA, score, nullptr, 0, 0}, sigma);
+
+            teddy::grouping::dispatch_grouping_score<sigma>(
+                score, [&]<typename ScoreModel>() {
+                    const uint64_t exact_score =
+                        total_score<ScoreModel>(suffixes, exact);
+                    EXPECT_EQ(exact_score,
+                              exhaustive_best_score<ScoreModel>(suffixes));
+                    EXPECT_LE(exact_score,
+                              total_score<ScoreModel>(suffixes, greedy));
+                });
+        }
+    }
+}
+
+TEST(TeddyGroupingTest, LayeredSortedOptimalMatchesQuadraticReference) {
+    for (const int sigma : teddy::ALL_SIGMAS) {
+        for (const auto score : teddy::ALL_GROUPING_SCORES) {
+            for (const size_t count : {1u, 5u, 8u, 9u, 40u, 300u}) {
+                for (const int alphabet : {2, 5, 40}) {
+                    SCOPED_TRACE(::testing::Message()
+                                 << "sigma=" << sigma
+                                 << ", score=" << static_cast<int>(score)
+                                 << ", suffixes=" << count
+                                 << ", alphabet=" << alphabet);
+
+                    const auto suffixes = random_suffixes(
+                        count, alphabet, static_cast<uint32_t>(count * sigma));
+                    const GroupedSuffixIds expected =
+                        teddy::dispatch_sigma(sigma, [&]<int Sigma>() {
+                            return teddy::grouping::dispatch_grouping_score<
+                                Sigma>(score, [&]<typename ScoreModel>() {
+                                return reference_sorted_optimal_groups<
+                                    ScoreModel, Sigma>(suffixes);
+                            });
+                        });
+
+                    const GroupedSuffixIds actual = teddy::build_groups(
+                        suffixes,
+                        {TEDDY_COMPILE_SORTED_SUFFIX_OPTIMAL_PARTITION, score,
+                         nullptr, 0, 0},
+                        sigma);
+                    EXPECT_EQ(actual, expected);
+                }
+            }
+        }
+    }
+}
+
+TEST(TeddyGroupingTest, NibbleClusteringSeparatesDisjointNibbleFamilies) {
+    // family f only uses high nibble f and low nibbles 2f and 2f + 1
+    constexpr int sigma = 3;
+    std::vector<teddy::Suffix> suffixes;
+    std::vector<uint32_t> family_of;
+    for (uint32_t variant = 0; variant < (1u << sigma); ++variant) {
+        for (uint32_t family = 0; family < teddy::MAX_GROUPS; ++family) {
+            teddy::Suffix suffix{};
+            for (int i = 0; i < sigma; ++i) {
+                suffix[i] = static_cast<uint8_t>(
+                    (family << 4) | (2 * family + ((variant >> i) & 1u)));
+            }
+            suffixes.push_back(suffix);
+            family_of.push_back(family);
+        }
+    }
+
+    const GroupedSuffixIds groups = teddy::build_groups(
+        suffixes,
+        {TEDDY_COMPILE_NIBBLE_CLUSTERING, TEDDY_GROUPING_SCORE_PAPER, nullptr,
+         0, 0},
+        sigma);
+
+    ASSERT_EQ(groups.size(), static_cast<size_t>(teddy::MAX_GROUPS));
+    for (const auto& group : groups) {
+        ASSERT_EQ(group.size(), size_t{1} << sigma);
+        for (const uint32_t suffix_id : group) {
+            EXPECT_EQ(family_of[suffix_id], family_of[group.front()]);
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "utils.h"
 
+#include "teddy/configurations.h"
+
 #include <gtest/gtest.h>
 
 #include <algorithm>
@@ -39,26 +41,85 @@ std::string load_json_fixture(std::string_view filename) {
     return contents;
 }
 
-ApiRun run_findkey(std::string_view json,
-                   const std::vector<std::string_view>& keys,
-                   findkey_algo algorithm,
-                   const findkey_teddy_config* teddy_config) {
-    std::vector<const uint8_t*> key_data;
-    std::vector<size_t> key_lengths;
-    key_data.reserve(keys.size());
-    key_lengths.reserve(keys.size());
+std::string load_dense_matrix_json() {
+    std::string json = "[";
+    json += load_json_fixture("configuration_matrix.json");
+    for (int i = 0; i < 4096; ++i) {
+        json += i % 32 == 0 ? R"(,{"lima":1})" : R"(,"lima")";
+    }
+    json += ']';
+    return json;
+}
 
+KeyArrays make_key_arrays(const std::vector<std::string_view>& keys) {
+    KeyArrays arrays;
+    arrays.ptrs.reserve(keys.size());
+    arrays.lens.reserve(keys.size());
     for (std::string_view key : keys) {
-        key_data.push_back(reinterpret_cast<const uint8_t*>(key.data()));
-        key_lengths.push_back(key.size());
+        arrays.ptrs.push_back(reinterpret_cast<const uint8_t*>(key.data()));
+        arrays.lens.push_back(key.size());
     }
+    return arrays;
+}
+
+CompiledDb::CompiledDb(std::string_view json,
+                       const std::vector<std::string_view>& keys,
+                       const findkey_teddy_config& config) {
+    const KeyArrays c_keys = make_key_arrays(keys);
+    db_ = findkey_db_compile(reinterpret_cast<const uint8_t*>(json.data()),
+                             json.size(), c_keys.ptrs.data(),
+                             c_keys.lens.data(), keys.size(), &config,
+                             &status_);
+}
 
+CompiledDb::~CompiledDb() {
+    findkey_db_free(db_);
+}
+
+void for_each_teddy_config(std::string_view json,
+                           const std::vector<std::string_view>& keys,
+                           const TeddyRun& run,
+                           const TeddyDbRun& run_db) {
+    for (const auto suffix_mode : teddy::ALL_SUFFIX_MODES) {
+        for (const auto verifier : teddy::ALL_VERIFIERS) {
+            for (const auto scan_mode : teddy::ALL_SCAN_MODES) {
+                SCOPED_TRACE(::testing::Message()
+                             << "suffix_mode=" << static_cast<int>(suffix_mode)
+                             << " verifier=" << static_cast<int>(verifier)
+                             << " scan_mode=" << static_cast<int>(scan_mode));
+                findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+                config.suffix_mode = suffix_mode;
+                config.verifier = verifier;
+                config.scan_mode = scan_mode;
+
+                run(TEDDY_BASELINE, config);
+                if (simd_teddy_availability() !=
+                    SimdTeddyAvailability::Available) {
+                    continue;
+                }
+                run(TEDDY, config);
+
+                const CompiledDb db(json, keys, config);
+                EXPECT_EQ(db.status(), FINDKEY_OK);
+                if (db.get()) {
+                    run_db(db.get(), config);
+                }
+            }
+        }
+    }
+}
+
+ApiRun run_findkey(std::string_view json,
+                   const std::vector<std::string_view>& keys,
+                   findkey_algo algorithm,
+                   const findkey_teddy_config* teddy_config) {
+    const KeyArrays c_keys = make_key_arrays(keys);
     std::vector<findkey_result> output(std::max<size_t>(json.size(), 1));
     findkey_timing timing{};
     ApiRun run;
 
     run.total = findkey(reinterpret_cast<const uint8_t*>(json.data()),
-                        json.size(), key_data.data(), key_lengths.data(),
+                        json.size(), c_keys.ptrs.data(), c_keys.lens.data(),
                         keys.size(), algorithm, teddy_config, output.data(),
                         output.size(), &run.status, &timing);
 
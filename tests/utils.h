@@ -3,6 +3,8 @@
 #include "findkey.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -15,6 +17,61 @@ struct ApiRun {
     std::vector<findkey_result> results;
 };
 
+// the keys of configuration_matrix.json
+inline const std::vector<std::string_view> MATRIX_KEYS = {
+    "alpha", "bravo", "charlie", "delta",  "echo", "foxtrot",
+    "golf",  "hotel", "india",   "juliet", "kilo", "lima",
+};
+
+// MATRIX_KEYS, then a repeated key and one the fixture does not hold
+inline const std::vector<std::string_view> MATRIX_KEYS_WITH_EXTRAS = {
+    "alpha", "bravo", "charlie", "delta", "echo",  "foxtrot", "golf",
+    "hotel", "india", "juliet",  "kilo",  "lima",  "alpha",   "zulu",
+};
+
+// the key arguments of the C API, pointing into the keys
+struct KeyArrays {
+    std::vector<const uint8_t*> ptrs;
+    std::vector<size_t> lens;
+};
+
+KeyArrays make_key_arrays(const std::vector<std::string_view>& keys);
+
+// findkey_db_compile of keys on json, freed with the wrapper
+class CompiledDb {
+   public:
+    CompiledDb(std::string_view json,
+               const std::vector<std::string_view>& keys,
+               const findkey_teddy_config& config);
+    ~CompiledDb();
+
+    CompiledDb(const CompiledDb&) = delete;
+    CompiledDb& operator=(const CompiledDb&) = delete;
+
+    const findkey_db* get() const noexcept { return db_; }
+    int status() const noexcept { return status_; }
+
+   private:
+    findkey_db* db_ = nullptr;
+    int status_ = FINDKEY_ERR_BAD_ARGS;
+};
+
+using TeddyRun =
+    std::function<void(findkey_algo, const findkey_teddy_config&)>;
+using TeddyDbRun =
+    std::function<void(const findkey_db*, const findkey_teddy_config&)>;
+
+/*
+    Every suffix mode, verifier and scan mode, traced by name
+    - run(TEDDY_BASELINE, config), then run(TEDDY, config) where the SIMD
+      matcher runs
+    - run_db with a database compiled from config on json after TEDDY
+*/
+void for_each_teddy_config(std::string_view json,
+                           const std::vector<std::string_view>& keys,
+                           const TeddyRun& run,
+                           const TeddyDbRun& run_db);
+
 enum class SimdTeddyAvailability {
     Available,
     NotCompiled,
@@ -23,6 +80,10 @@ enum class SimdTeddyAvailability {
 
 std::string load_json_fixture(std::string_view filename);
 
+// configuration_matrix.json, then enough rejected "lima" values between
+// matrix keys for the adaptive scan to switch to its tokenizer
+std::string load_dense_matrix_json();
+
 ApiRun run_findkey(std::string_view json,
                    const std::vector<std::string_view>& keys,
                    findkey_algo algorithm,
@@ -64,13 +64,19 @@ std::optional<size_t> parse_size(std::string_view raw) {
         << "  --grouping <name>                Repeatable. Defaults: "
            "greedy_paper_policy, greedy_min_delta, hash_std, hash_adler32, "
            "hash_crc32, hash_xxhash, hash_fnv1a, sorted_suffix_round_robin, "
-           "sorted_suffix_partition, sorted_suffix_optimal_partition\n"
+           "sorted_suffix_partition, sorted_suffix_optimal_partition, "
+           "branch_and_bound, nibble_clustering\n"
         << "  --score <name>                   Repeatable. Defaults for "
-           "score-based strategies: paper, paper_nibble, nibble_count\n"
+           "score-based strategies: paper, paper_nibble, nibble_count, "
+           "frequency\n"
         << "  --suffix-mode <name>             Repeatable. Defaults: raw, "
-           "quote-suffix\n"
+           "quote-suffix, window, prefix, auto\n"
         << "  --sigma <n>                      Repeatable. Defaults: 1, 2, 3, "
-           "4\n";
+           "4\n"
+        << "  --verifier <name>                Repeatable. Defaults: dfa, "
+           "suffix_table, top_trie, pipelined, swar\n"
+        << "  --scan-mode <name>               Repeatable. Defaults: fixed, "
+           "adaptive\n";
     std::exit(EXIT_FAILURE);
 }
 
@@ -94,6 +100,8 @@ Options parse_options(int argc, char** argv) {
         {"score", required_argument, nullptr, 'c'},
         {"suffix-mode", required_argument, nullptr, 'f'},
         {"sigma", required_argument, nullptr, 'i'},
+        {"verifier", required_argument, nullptr, 'v'},
+        {"scan-mode", required_argument, nullptr, 'e'},
         {"repeats", required_argument, nullptr, 'r'},
         {"warmup", required_argument, nullptr, 'w'},
         {"dry-run", no_argument, nullptr, 'd'},
@@ -202,6 +210,24 @@ Options parse_options(int argc, char** argv) {
                 options.sigmas.push_back(*sigma);
                 break;
             }
+            case 'v': {
+                const auto verifier = findkey_options::parse_verifier(optarg);
+                if (!verifier) {
+                    std::cerr << "Invalid --verifier\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.verifiers.push_back(*verifier);
+                break;
+            }
+            case 'e': {
+                const auto scan_mode = findkey_options::parse_scan_mode(optarg);
+                if (!scan_mode) {
+                    std::cerr << "Invalid --scan-mode\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.scan_modes.push_back(*scan_mode);
+                break;
+            }
             case 'r': {
                 const auto value = parse_size(optarg);
                 if (!value) {
@@ -268,6 +294,14 @@ Options parse_options(int argc, char** argv) {
         options.sigmas.assign(teddy::ALL_SIGMAS.begin(),
                               teddy::ALL_SIGMAS.end());
     }
+    if (options.verifiers.empty()) {
+        options.verifiers.assign(teddy::ALL_VERIFIERS.begin(),
+                                 teddy::ALL_VERIFIERS.end());
+    }
+    if (options.scan_modes.empty()) {
+        options.scan_modes.assign(teddy::ALL_SCAN_MODES.begin(),
+                                  teddy::ALL_SCAN_MODES.end());
+    }
 
     return options;
 }
@@ -291,7 +325,8 @@ std::vector<findkey_teddy_config> make_teddy_configs(const Options& options) {
 
     return teddy::make_teddy_configurations(
         options.grouping_strategies, options.grouping_scores,
-        options.suffix_modes, options.sigmas);
+        options.suffix_modes, options.sigmas, options.verifiers,
+        options.scan_modes);
 }
 
 std::vector<KeyCase> make_key_cases(const Options& options) {
@@ -35,6 +35,8 @@ struct Options {
     std::vector<findkey_teddy_grouping_score> grouping_scores;
     std::vector<findkey_teddy_suffix_mode> suffix_modes;
     std::vector<int> sigmas;
+    std::vector<findkey_teddy_verifier> verifiers;
+    std::vector<findkey_teddy_scan_mode> scan_modes;
     size_t repeats = 5;
     size_t warmup = 1;
     std::filesystem::path out_dir = "bench_out_cpp";
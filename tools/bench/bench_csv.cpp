@@ -12,9 +12,9 @@
 namespace bench {
 namespace {
 
-constexpr size_t BENCH_COLUMN_COUNT = 19;
-constexpr size_t STATS_COLUMN_COUNT = 36;
-constexpr size_t BENCH_TEDDY_COLUMN_COUNT = 4;
+constexpr size_t BENCH_COLUMN_COUNT = 21;
+constexpr size_t STATS_COLUMN_COUNT = 41;
+constexpr size_t BENCH_TEDDY_COLUMN_COUNT = 6;
 
 // RFC4180 CSV escaping
 std::string csv_escape(std::string value) {
@@ -80,6 +80,8 @@ void write_bench_header(std::ofstream& output) {
         "grouping_score",
         "suffix_mode",
         "requested_sigma",
+        "verifier",
+        "scan_mode",
         "repeat_index",
         "status",
         "total_found",
@@ -106,6 +108,8 @@ void write_stats_header(std::ofstream& output) {
         "grouping_score",
         "suffix_mode",
         "requested_sigma",
+        "verifier",
+        "scan_mode",
         "compiled_sigma",
         "num_groups",
         "dfa_nodes",
@@ -128,6 +132,9 @@ void write_stats_header(std::ofstream& output) {
         "reject_missing_open_quote",
         "reject_key_not_found",
         "exact_matches",
+        "switches_to_tokenizer",
+        "switches_to_teddy",
+        "tokenizer_bytes",
         "hit_lane_ratio",
         "avg_hit_groups_per_lane",
         "exact_matches_per_hit_lane",
@@ -162,6 +169,10 @@ void write_bench_row(std::ofstream& output, const BenchCsvRow& row) {
         csv_row.push_back(std::string(
             findkey_options::suffix_mode_name(row.teddy_config.suffix_mode)));
         csv_row.push_back(std::to_string(row.teddy_config.sigma));
+        csv_row.push_back(std::string(
+            findkey_options::verifier_name(row.teddy_config.verifier)));
+        csv_row.push_back(std::string(
+            findkey_options::scan_mode_name(row.teddy_config.scan_mode)));
     }
 
     csv_row.push_back(std::to_string(row.repeat_index));
@@ -196,6 +207,10 @@ void write_stats_row(std::ofstream& output, const StatsCsvRow& row) {
     csv_row.push_back(std::string(
         findkey_options::suffix_mode_name(row.teddy_config.suffix_mode)));
     csv_row.push_back(std::to_string(row.teddy_config.sigma));
+    csv_row.push_back(std::string(
+        findkey_options::verifier_name(row.teddy_config.verifier)));
+    csv_row.push_back(std::string(
+        findkey_options::scan_mode_name(row.teddy_config.scan_mode)));
     csv_row.push_back(std::to_string(row.metadata.sigma));
     csv_row.push_back(std::to_string(row.metadata.num_groups));
     csv_row.push_back(std::to_string(row.dfa_metadata.nodes));
@@ -218,6 +233,9 @@ void write_stats_row(std::ofstream& output, const StatsCsvRow& row) {
     csv_row.push_back(std::to_string(row.stats.reject_missing_open_quote));
     csv_row.push_back(std::to_string(row.stats.reject_key_not_found));
     csv_row.push_back(std::to_string(row.stats.exact_matches));
+    csv_row.push_back(std::to_string(row.stats.switches_to_tokenizer));
+    csv_row.push_back(std::to_string(row.stats.switches_to_teddy));
+    csv_row.push_back(std::to_string(row.stats.tokenizer_bytes));
     csv_row.push_back(to_string_double(row.hit_lane_ratio));
     csv_row.push_back(to_string_double(row.avg_hit_groups_per_lane));
     csv_row.push_back(to_string_double(row.exact_matches_per_hit_lane));
@@ -0,0 +1,267 @@
+#include "core/findkey_error.h"
+#include "core/findkey_options.h"
+#include "teddy/compile.h"
+#include "teddy/configurations.h"
+#include "teddy/grouping/strategy.h"
+
+#include <getopt.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Times teddy::compile on synthetic key sets, without any JSON input
+// Usage: bench_compile [--num-keys <n>]... [--grouping <name>]...
+//                      [--score <name>]... [--sigma <n>]... [--seed <n>]
+//                      [--repeats <n>] [--refine-passes <n>]
+
+namespace {
+
+struct Options {
+    std::vector<size_t> num_keys;
+    std::vector<findkey_teddy_compile_grouping_strategy> grouping_strategies;
+    std::vector<findkey_teddy_grouping_score> grouping_scores;
+    std::vector<int> sigmas;
+    uint32_t seed = 1;
+    size_t repeats = 3;
+    uint32_t refine_passes = 0;
+};
+
+std::optional<size_t> parse_size(std::string_view raw) {
+    if (raw.empty()) {
+        return std::nullopt;
+    }
+
+    char* end = nullptr;
+    const std::string text(raw);
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(value);
+}
+
+[[noreturn]] void print_usage_and_exit(const char* program_name) {
+    std::cerr << "Usage:\n"
+              << "  " << program_name << " [options]\n\n"
+              << "  --num-keys <n>     Repeatable. Defaults: 1000, 5000, "
+                 "10000, 25000, 50000\n"
+              << "  --grouping <name>  Repeatable. Default: greedy_min_delta\n"
+              << "  --score <name>     Repeatable. Default: paper\n"
+              << "  --sigma <n>        Repeatable. Default: 3\n"
+              << "  --seed <n>         Default: 1\n"
+              << "  --repeats <n>      Default: 3\n"
+              << "  --refine-passes <n> Default: 0\n";
+    std::exit(EXIT_FAILURE);
+}
+
+Options parse_options(int argc, char** argv) {
+    static constexpr option long_options[] = {
+        {"num-keys", required_argument, nullptr, 'n'},
+        {"grouping", required_argument, nullptr, 'g'},
+        {"score", required_argument, nullptr, 'c'},
+        {"sigma", required_argument, nullptr, 'i'},
+        {"seed", required_argument, nullptr, 's'},
+        {"repeats", required_argument, nullptr, 'r'},
+        {"refine-passes", required_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    Options options;
+
+    opterr = 0;
+    optind = 1;
+    while (true) {
+        const int option_value =
+            getopt_long(argc, argv, "", long_options, nullptr);
+        if (option_value == -1) {
+            break;
+        }
+
+        switch (option_value) {
+            case 'n': {
+                const auto value = parse_size(optarg);
+                if (!value || *value == 0) {
+                    std::cerr << "Invalid --num-keys\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.num_keys.push_back(*value);
+                break;
+            }
+            case 'g': {
+                const auto strategy =
+                    findkey_options::parse_grouping_strategy(optarg);
+                if (!strategy) {
+                    std::cerr << "Invalid --grouping\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.grouping_strategies.push_back(*strategy);
+                break;
+            }
+            case 'c': {
+                const auto score =
+                    findkey_options::parse_grouping_score(optarg);
+                if (!score) {
+                    std::cerr << "Invalid --score\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.grouping_scores.push_back(*score);
+                break;
+            }
+            case 'i': {
+                const auto sigma = findkey_options::parse_sigma(optarg);
+                if (!sigma) {
+                    std::cerr << "Invalid --sigma\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.sigmas.push_back(*sigma);
+                break;
+            }
+            case 's': {
+                const auto value = parse_size(optarg);
+                if (!value) {
+                    std::cerr << "Invalid --seed\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.seed = static_cast<uint32_t>(*value);
+                break;
+            }
+            case 'r': {
+                const auto value = parse_size(optarg);
+                if (!value || *value == 0) {
+                    std::cerr << "Invalid --repeats\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.repeats = *value;
+                break;
+            }
+            case 'f': {
+                const auto value = findkey_options::parse_uint32(optarg);
+                if (!value) {
+                    std::cerr << "Invalid --refine-passes\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.refine_passes = *value;
+                break;
+            }
+            default:
+                print_usage_and_exit(argv[0]);
+        }
+    }
+
+    if (optind != argc) {
+        print_usage_and_exit(argv[0]);
+    }
+
+    if (options.num_keys.empty()) {
+        options.num_keys = {1000, 5000, 10000, 25000, 50000};
+    }
+    if (options.grouping_strategies.empty()) {
+        options.grouping_strategies = {TEDDY_COMPILE_GREEDY_MIN_DELTA};
+    }
+    if (options.grouping_scores.empty()) {
+        options.grouping_scores = {TEDDY_GROUPING_SCORE_PAPER};
+    }
+    if (options.sigmas.empty()) {
+        options.sigmas = {FINDKEY_TEDDY_DEFAULT_SUFFIX_LENGTH};
+    }
+
+    return options;
+}
+
+// identifier-like keys: lowercase words joined by '_', 3 to 24 bytes
+std::vector<std::string> synthetic_keys(size_t num_keys, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> word_length(2, 8);
+    std::uniform_int_distribution<int> word_count(1, 3);
+
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> keys;
+    keys.reserve(num_keys);
+    while (keys.size() < num_keys) {
+        std::string key;
+        const int words = word_count(rng);
+        for (int word = 0; word < words; ++word) {
+            if (word != 0) {
+                key.push_back('_');
+            }
+            const size_t length = word_length(rng);
+            for (size_t i = 0; i < length; ++i) {
+                key.push_back(static_cast<char>(letter(rng)));
+            }
+        }
+        if (key.size() >= 3 && seen.insert(key).second) {
+            keys.push_back(std::move(key));
+        }
+    }
+    return keys;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const Options options = parse_options(argc, argv);
+
+    std::cout << "num_keys,grouping_strategy,grouping_score,refine_passes,"
+                 "sigma,num_groups,repeat_index,compile_ns\n";
+
+    for (const size_t num_keys : options.num_keys) {
+        const std::vector<std::string> keys =
+            synthetic_keys(num_keys, options.seed);
+        const std::vector<std::string_view> key_views(keys.begin(),
+                                                      keys.end());
+
+        constexpr std::array suffix_modes = {TEDDY_SUFFIX_RAW};
+        constexpr std::array verifiers = {TEDDY_VERIFY_DFA};
+        constexpr std::array scan_modes = {TEDDY_SCAN_FIXED};
+        auto configs = teddy::make_teddy_configurations(
+            options.grouping_strategies, options.grouping_scores, suffix_modes,
+            options.sigmas, verifiers, scan_modes);
+        for (findkey_teddy_config& config : configs) {
+            config.grouping.refine_max_passes = options.refine_passes;
+        }
+
+        for (const findkey_teddy_config& config : configs) {
+            for (size_t repeat = 0; repeat < options.repeats; ++repeat) {
+                try {
+                    const auto start = std::chrono::steady_clock::now();
+                    const teddy::CompilationData data =
+                        teddy::compile(key_views, config);
+                    const auto end = std::chrono::steady_clock::now();
+
+                    std::cout
+                        << num_keys << ','
+                        << findkey_options::grouping_strategy_name(
+                               config.grouping.strategy)
+                        << ','
+                        << (teddy::grouping::grouping_strategy_uses_score(
+                                config.grouping.strategy)
+                                ? findkey_options::grouping_score_name(
+                                      config.grouping.score)
+                                : "")
+                        << ',' << options.refine_passes << ','
+                        << config.sigma << ',' << data.num_groups << ','
+                        << repeat << ','
+                        << std::chrono::duration_cast<
+                               std::chrono::nanoseconds>(end - start)
+                               .count()
+                        << '\n'
+                        << std::flush;
+                } catch (const FindkeyError& error) {
+                    std::cerr << "Compile failed: " << error.what() << '\n';
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
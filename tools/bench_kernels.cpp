@@ -0,0 +1,277 @@
+#include "core/findkey_error.h"
+#include "core/findkey_options.h"
+#include "core/key_dfa.h"
+#include "io/mmap_file.h"
+#include "matchers/matcher_teddy_impl.h"
+#include "teddy/compile.h"
+#include "teddy/dispatch.h"
+#include "teddy/verify.h"
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Times the Teddy scan with every kernel shape read at runtime against the
+// shape dispatch_kernel specializes, per sigma, suffix mode and key count
+// Usage: bench_kernels --json <file> --keys <file> [--num-keys <n>]...
+//                      [--sigma <n>]... [--suffix-mode <name>]...
+//                      [--repeats <n>]
+
+namespace {
+
+struct Options {
+    std::string json_path;
+    std::string keys_path;
+    std::vector<size_t> num_keys;
+    std::vector<int> sigmas;
+    std::vector<findkey_teddy_suffix_mode> suffix_modes;
+    size_t repeats = 5;
+};
+
+std::optional<size_t> parse_size(std::string_view raw) {
+    if (raw.empty()) {
+        return std::nullopt;
+    }
+
+    char* end = nullptr;
+    const std::string text(raw);
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(value);
+}
+
+[[noreturn]] void print_usage_and_exit(const char* program_name) {
+    std::cerr << "Usage:\n"
+              << "  " << program_name
+              << " --json <file> --keys <file> [options]\n\n"
+              << "  --num-keys <n>       Repeatable, the first n keys. "
+                 "Defaults: 4, every key\n"
+              << "  --sigma <n>          Repeatable. Defaults: 1 to 4\n"
+              << "  --suffix-mode <name> Repeatable. Defaults: raw, "
+                 "quote-suffix, window\n"
+              << "  --repeats <n>        Default: 5, the fastest counts\n";
+    std::exit(EXIT_FAILURE);
+}
+
+Options parse_options(int argc, char** argv) {
+    static constexpr option long_options[] = {
+        {"json", required_argument, nullptr, 'j'},
+        {"keys", required_argument, nullptr, 'k'},
+        {"num-keys", required_argument, nullptr, 'n'},
+        {"sigma", required_argument, nullptr, 'i'},
+        {"suffix-mode", required_argument, nullptr, 'm'},
+        {"repeats", required_argument, nullptr, 'r'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    Options options;
+
+    opterr = 0;
+    optind = 1;
+    while (true) {
+        const int option_value =
+            getopt_long(argc, argv, "", long_options, nullptr);
+        if (option_value == -1) {
+            break;
+        }
+
+        switch (option_value) {
+            case 'j':
+                options.json_path = optarg;
+                break;
+            case 'k':
+                options.keys_path = optarg;
+                break;
+            case 'n': {
+                const auto value = parse_size(optarg);
+                if (!value || *value == 0) {
+                    std::cerr << "Invalid --num-keys\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.num_keys.push_back(*value);
+                break;
+            }
+            case 'i': {
+                const auto sigma = findkey_options::parse_sigma(optarg);
+                if (!sigma) {
+                    std::cerr << "Invalid --sigma\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.sigmas.push_back(*sigma);
+                break;
+            }
+            case 'm': {
+                const auto suffix_mode =
+                    findkey_options::parse_suffix_mode(optarg);
+                if (!suffix_mode) {
+                    std::cerr << "Invalid --suffix-mode\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.suffix_modes.push_back(*suffix_mode);
+                break;
+            }
+            case 'r': {
+                const auto value = parse_size(optarg);
+                if (!value || *value == 0) {
+                    std::cerr << "Invalid --repeats\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.repeats = *value;
+                break;
+            }
+            default:
+                print_usage_and_exit(argv[0]);
+        }
+    }
+
+    if (optind != argc || options.json_path.empty() ||
+        options.keys_path.empty()) {
+        print_usage_and_exit(argv[0]);
+    }
+
+    if (options.num_keys.empty()) {
+        options.num_keys = {4, ~size_t{0}};
+    }
+    if (options.sigmas.empty()) {
+        options.sigmas = {1, 2, 3, 4};
+    }
+    if (options.suffix_modes.empty()) {
+        options.suffix_modes = {TEDDY_SUFFIX_RAW, TEDDY_SUFFIX_QUOTED,
+                                TEDDY_SUFFIX_WINDOW};
+    }
+
+    return options;
+}
+
+// same format as the findkey keys file
+std::vector<std::string> read_keys(const std::string& keys_path) {
+    std::ifstream infile(keys_path);
+    std::vector<std::string> keys;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (!line.empty()) {
+            if (line.back() == '\r') {
+                line.pop_back();  // windows return
+            }
+            keys.push_back(line);
+        }
+    }
+    return keys;
+}
+
+const char* group_count_name(teddy::GroupCount groups) {
+    return groups == teddy::GroupCount::FULL ? "full" : "any";
+}
+
+const char* suffix_class_name(teddy::SuffixClass suffix) {
+    switch (suffix) {
+        case teddy::SuffixClass::RAW:
+            return "raw";
+        case teddy::SuffixClass::QUOTED:
+            return "quoted";
+        case teddy::SuffixClass::WINDOWED:
+            return "windowed";
+        default:
+            return "any";
+    }
+}
+
+// fastest of `repeats` runs, and the match count to check the shapes agree
+template <typename Shape>
+std::pair<uint64_t, size_t> time_scan(std::string_view json,
+                                      const teddy::CompilationData& data,
+                                      const DFA& dfa,
+                                      size_t repeats) {
+    uint64_t best_ns = ~uint64_t{0};
+    size_t matches = 0;
+    for (size_t repeat = 0; repeat < repeats; ++repeat) {
+        const auto start = std::chrono::steady_clock::now();
+        matches = teddy::dispatch_verifier<Shape::sigma>(
+            data, dfa, [&](const auto& verify) {
+                return teddy::matcher_impl<Shape>(json, data, verify).size();
+            });
+        const auto end = std::chrono::steady_clock::now();
+        best_ns = std::min<uint64_t>(
+            best_ns,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                .count());
+    }
+    return {best_ns, matches};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const Options options = parse_options(argc, argv);
+
+    MMapFile json_file(options.json_path.c_str());
+    const std::string_view json(json_file.data(), json_file.size());
+    const std::vector<std::string> all_keys = read_keys(options.keys_path);
+    if (all_keys.empty()) {
+        std::cerr << "No keys found in keys file: " << options.keys_path
+                  << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "num_keys,suffix_mode,sigma,num_groups,group_count,"
+                 "suffix_class,any_shape_ns,specialized_ns,speedup\n";
+
+    for (const size_t num_keys : options.num_keys) {
+        const std::vector<std::string_view> keys(
+            all_keys.begin(),
+            all_keys.begin() + std::min(num_keys, all_keys.size()));
+        const DFA dfa = compile_key_dfa(keys);
+
+        for (const auto suffix_mode : options.suffix_modes) {
+            for (const int sigma : options.sigmas) {
+                findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+                config.suffix_mode = suffix_mode;
+                config.sigma = sigma;
+
+                try {
+                    const teddy::CompilationData data =
+                        teddy::compile(keys, config);
+                    teddy::dispatch_kernel(data, [&]<typename Shape>() {
+                        const auto [any_ns, any_matches] =
+                            time_scan<teddy::AnyKernelShape<Shape::sigma>>(
+                                json, data, dfa, options.repeats);
+                        const auto [shape_ns, shape_matches] = time_scan<Shape>(
+                            json, data, dfa, options.repeats);
+                        if (any_matches != shape_matches) {
+                            throw FindkeyError(
+                                FindkeyErrorCode::INVALID_ARGUMENT,
+                                "Kernel shapes disagree on the matches");
+                        }
+
+                        std::cout
+                            << keys.size() << ','
+                            << findkey_options::suffix_mode_name(suffix_mode)
+                            << ',' << data.sigma << ',' << data.num_groups
+                            << ',' << group_count_name(Shape::groups) << ','
+                            << suffix_class_name(Shape::suffix) << ','
+                            << any_ns << ',' << shape_ns << ','
+                            << static_cast<double>(any_ns) /
+                                   static_cast<double>(shape_ns)
+                            << '\n'
+                            << std::flush;
+                    });
+                } catch (const FindkeyError& error) {
+                    std::cerr << "Bench failed: " << error.what() << '\n';
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,418 @@
+#include "core/findkey_error.h"
+#include "core/findkey_options.h"
+#include "core/key_dfa.h"
+#include "teddy/compile.h"
+
+#include <getopt.h>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Writes a header with a Teddy matcher specialized for a fixed key set
+// Usage: generate_matcher --keys <file> --output <header> --namespace <name>
+//                         [--grouping <name>] [--score <name>]
+//                         [--suffix-mode <name>] [--sigma <n>]
+//                         [--refine-passes <n>]
+
+namespace {
+
+struct Options {
+    std::string keys_path;
+    std::string output_path;
+    std::string name;
+    findkey_teddy_config config = FINDKEY_TEDDY_CONFIG_INIT;
+};
+
+[[noreturn]] void print_usage_and_exit(const char* program_name) {
+    std::cerr << "Usage:\n"
+              << "  " << program_name
+              << " --keys <file> --output <header> --namespace <name> "
+                 "[options]\n\n"
+              << "  --grouping <name>     Default: greedy_paper_policy\n"
+              << "  --score <name>        Default: paper\n"
+              << "  --suffix-mode <name>  raw, quote-suffix or auto. "
+                 "Default: raw\n"
+              << "  --sigma <n>           Default: 3\n"
+              << "  --refine-passes <n>   Default: 0\n";
+    std::exit(EXIT_FAILURE);
+}
+
+bool is_identifier(std::string_view name) {
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+    for (const char c : name) {
+        if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Options parse_options(int argc, char** argv) {
+    static constexpr option long_options[] = {
+        {"keys", required_argument, nullptr, 'k'},
+        {"output", required_argument, nullptr, 'o'},
+        {"namespace", required_argument, nullptr, 'n'},
+        {"grouping", required_argument, nullptr, 'g'},
+        {"score", required_argument, nullptr, 'c'},
+        {"suffix-mode", required_argument, nullptr, 'm'},
+        {"sigma", required_argument, nullptr, 'i'},
+        {"refine-passes", required_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    Options options;
+
+    opterr = 0;
+    optind = 1;
+    while (true) {
+        const int option_value =
+            getopt_long(argc, argv, "", long_options, nullptr);
+        if (option_value == -1) {
+            break;
+        }
+
+        switch (option_value) {
+            case 'k':
+                options.keys_path = optarg;
+                break;
+            case 'o':
+                options.output_path = optarg;
+                break;
+            case 'n':
+                options.name = optarg;
+                break;
+            case 'g': {
+                const auto strategy =
+                    findkey_options::parse_grouping_strategy(optarg);
+                if (!strategy || *strategy == TEDDY_COMPILE_AUTO) {
+                    std::cerr << "Invalid --grouping\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.config.grouping.strategy = *strategy;
+                break;
+            }
+            case 'c': {
+                const auto score =
+                    findkey_options::parse_grouping_score(optarg);
+                if (!score) {
+                    std::cerr << "Invalid --score\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.config.grouping.score = *score;
+                break;
+            }
+            case 'm': {
+                const auto suffix_mode =
+                    findkey_options::parse_suffix_mode(optarg);
+                if (!suffix_mode || *suffix_mode == TEDDY_SUFFIX_WINDOW ||
+                    *suffix_mode == TEDDY_SUFFIX_PREFIX) {
+                    std::cerr << "Invalid --suffix-mode\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.config.suffix_mode = *suffix_mode;
+                break;
+            }
+            case 'i': {
+                const auto sigma = findkey_options::parse_sigma(optarg);
+                if (!sigma) {
+                    std::cerr << "Invalid --sigma\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.config.sigma = *sigma;
+                break;
+            }
+            case 'f': {
+                const auto value = findkey_options::parse_uint32(optarg);
+                if (!value) {
+                    std::cerr << "Invalid --refine-passes\n";
+                    print_usage_and_exit(argv[0]);
+                }
+                options.config.grouping.refine_max_passes = *value;
+                break;
+            }
+            default:
+                print_usage_and_exit(argv[0]);
+        }
+    }
+
+    if (optind != argc || options.keys_path.empty() ||
+        options.output_path.empty() || !is_identifier(options.name)) {
+        print_usage_and_exit(argv[0]);
+    }
+
+    return options;
+}
+
+// same format as the findkey keys file
+std::vector<std::string> read_keys(const std::string& keys_path) {
+    std::ifstream infile(keys_path);
+    if (!infile) {
+        std::cerr << "Failed to open keys file: " << keys_path << '\n';
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> keys;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (!line.empty()) {
+            if (line.back() == '\r') {
+                line.pop_back();  // windows return
+            }
+            keys.push_back(line);
+        }
+    }
+
+    if (keys.empty()) {
+        std::cerr << "No keys found in keys file: " << keys_path << '\n';
+        std::exit(EXIT_FAILURE);
+    }
+    return keys;
+}
+
+// C++ string literal, octal escapes cannot run into the following byte
+std::string literal(std::string_view bytes) {
+    std::string out = "\"";
+    for (const char c : bytes) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (byte >= 0x20 && byte < 0x7F && c != '"' && c != '\\' &&
+            c != '?') {
+            out.push_back(c);
+            continue;
+        }
+        char escaped[5];
+        std::snprintf(escaped, sizeof(escaped), "\\%03o", byte);
+        out += escaped;
+    }
+    out.push_back('"');
+    return out;
+}
+
+void write_table(std::ostream& out,
+                 const char* name,
+                 const uint8_t (&table)[FINDKEY_TEDDY_MAX_SIGMA][16]) {
+    out << "    static constexpr uint8_t " << name
+        << "[FINDKEY_TEDDY_MAX_SIGMA][16] = {\n";
+    for (const auto& row : table) {
+        out << "        {";
+        for (int nibble = 0; nibble < 16; ++nibble) {
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "0x%02X", row[nibble]);
+            out << (nibble == 0 ? "" : ", ") << hex;
+        }
+        out << "},\n";
+    }
+    out << "    };\n";
+}
+
+// `count` comma separated values, 16 to a line
+template <typename Value>
+void write_values(std::ostream& out, size_t count, Value value) {
+    for (size_t i = 0; i < count; ++i) {
+        out << (i % 16 == 0 ? "    " : " ") << value(i) << ','
+            << (i % 16 == 15 || i + 1 == count ? "\n" : "");
+    }
+}
+
+/*
+    The reverse trie as constants, the same walk as walk_reverse_trie
+    - bytes no key holds share class 0, which has no children, so a node
+      is a row of (distinct key bytes + 1) children instead of 256
+    - child 0 is the missing child, the root is never one
+*/
+void write_verifier(std::ostream& out, const DFA& dfa) {
+    std::array<uint32_t, 256> byte_classes{};
+    uint32_t num_classes = 1;
+    for (const TrieNode& node : dfa.nodes) {
+        for (int c = 0; c < 256; ++c) {
+            if (node.children[c] != -1 && byte_classes[c] == 0) {
+                byte_classes[c] = num_classes++;
+            }
+        }
+    }
+    const char* node_type =
+        dfa.nodes.size() <= 0xFFFF ? "uint16_t" : "uint32_t";
+
+    out << "inline constexpr size_t MAX_KEY_LEN = " << dfa.max_key_len
+        << ";\n"
+        << "inline constexpr size_t NUM_BYTE_CLASSES = " << num_classes
+        << ";\n\n"
+        << "inline constexpr uint8_t BYTE_CLASSES[256] = {\n";
+    write_values(out, 256, [&](size_t c) { return byte_classes[c]; });
+    out << "};\n\n"
+        << "// by node, then byte class\n"
+        << "inline constexpr " << node_type
+        << " CHILDREN[][NUM_BYTE_CLASSES] = {\n";
+    for (const TrieNode& node : dfa.nodes) {
+        std::vector<int32_t> row(num_classes, 0);
+        for (int c = 0; c < 256; ++c) {
+            if (node.children[c] != -1) {
+                row[byte_classes[c]] = node.children[c];
+            }
+        }
+        out << "    {";
+        for (uint32_t i = 0; i < num_classes; ++i) {
+            out << (i == 0 ? "" : ", ") << row[i];
+        }
+        out << "},\n";
+    }
+    out << "};\n\n"
+        << "inline constexpr int32_t NODE_KEY_IDS[] = {\n";
+    write_values(out, dfa.nodes.size(),
+                 [&](size_t node_id) { return dfa.nodes[node_id].key_id; });
+    out << "};\n\n";
+
+    out << R"(struct Verifier {
+    static constexpr bool BATCHED = false;
+
+    teddy::candidate_result operator()(const char* str,
+                                       size_t len,
+                                       size_t end_quote) const {
+        const teddy::candidate_type terminator =
+            teddy::verify_json_key_terminator(str, len, end_quote);
+        if (terminator != teddy::CANDIDATE_TYPE_MATCH) {
+            return {terminator, 0, 0};
+        }
+
+        uint32_t node = 0;
+        size_t consumed = 0;
+        for (size_t position = end_quote; position > 0;) {
+            --position;
+            const uint8_t c = static_cast<uint8_t>(str[position]);
+
+            if (c == '"' && teddy::is_valid_quote(str, position)) {
+                if (NODE_KEY_IDS[node] != -1) {
+                    return {teddy::CANDIDATE_TYPE_MATCH, position + 1,
+                            static_cast<uint32_t>(NODE_KEY_IDS[node])};
+                }
+                return {teddy::CANDIDATE_KEY_NOT_FOUND, 0, 0};
+            }
+
+            if (consumed >= MAX_KEY_LEN) {
+                return {teddy::CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+            }
+
+            node = CHILDREN[node][BYTE_CLASSES[c]];
+            if (node == 0) {
+                return {teddy::CANDIDATE_KEY_NOT_FOUND, 0, 0};
+            }
+            ++consumed;
+        }
+
+        return {teddy::CANDIDATE_MISSING_OPEN_QUOTE, 0, 0};
+    }
+};
+)";
+}
+
+std::string generate(const Options& options,
+                     const std::vector<std::string>& keys,
+                     const teddy::CompilationData& data,
+                     const DFA& dfa) {
+    std::ostringstream out;
+    out << "// Generated by generate_matcher from "
+        << std::filesystem::path(options.keys_path).filename().string()
+        << ", do not edit\n"
+        << "// grouping " << findkey_options::grouping_strategy_name(
+                                 options.config.grouping.strategy)
+        << ", score "
+        << findkey_options::grouping_score_name(options.config.grouping.score)
+        << ", suffix mode "
+        << findkey_options::suffix_mode_name(options.config.suffix_mode)
+        << ", sigma " << data.sigma << ", " << data.num_groups
+        << " groups\n\n"
+        << "#pragma once\n\n"
+        << "// needs SSSE3, see findkey_generate_matcher in CMakeLists.txt\n\n"
+        << "#include \"findkey.h\"\n"
+        << "#include \"matchers/matcher_teddy_impl.h\"\n"
+        << "#include \"teddy/compile.h\"\n"
+        << "#include \"teddy/verify.h\"\n\n"
+        << "#include <array>\n"
+        << "#include <cstddef>\n"
+        << "#include <cstdint>\n"
+        << "#include <span>\n"
+        << "#include <string_view>\n"
+        << "#include <vector>\n\n"
+        << "namespace " << options.name << " {\n\n";
+
+    out << "// by key id\n"
+        << "inline constexpr std::string_view KEYS[] = {\n";
+    for (const std::string& key : keys) {
+        out << "    " << literal(key) << ",\n";
+    }
+    out << "};\n\n";
+
+    out << "// what matcher_impl reads of teddy::CompilationData\n"
+        << "struct Tables {\n"
+        << "    static constexpr int sigma = " << data.sigma << ";\n"
+        << "    static constexpr int num_groups = " << data.num_groups
+        << ";\n"
+        << "    static constexpr size_t end_quote_offset = "
+        << data.end_quote_offset << ";\n";
+    write_table(out, "low_table", data.low_table);
+    write_table(out, "high_table", data.high_table);
+    out << "    // never windowed\n"
+        << "    static constexpr std::span<const uint8_t> "
+           "key_window_offsets{};\n"
+        << "    static constexpr std::array<uint8_t, teddy::MAX_GROUPS>\n"
+        << "        group_window_offsets{};\n"
+        << "};\n\n";
+
+    write_verifier(out, dfa);
+
+    out << "\nusing Shape = teddy::KernelShape<\n"
+        << "    Tables::sigma,\n"
+        << "    teddy::GroupCount::"
+        << (data.num_groups == teddy::MAX_GROUPS ? "FULL" : "ANY") << ",\n"
+        << "    teddy::SuffixClass::"
+        << (data.end_quote_offset == 0 ? "QUOTED" : "RAW") << ">;\n\n"
+        << "// same results as findkey with algo TEDDY over KEYS\n"
+        << "inline std::vector<findkey_result> match(std::string_view data) "
+           "{\n"
+        << "    return teddy::matcher_impl<Shape>(data, Tables{}, "
+           "Verifier{});\n"
+        << "}\n\n"
+        << "}  // namespace " << options.name << '\n';
+    return out.str();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const Options options = parse_options(argc, argv);
+    const std::vector<std::string> keys = read_keys(options.keys_path);
+    const std::vector<std::string_view> key_views(keys.begin(), keys.end());
+
+    std::string header;
+    try {
+        const teddy::CompilationData data =
+            teddy::compile(key_views, options.config);
+        if (data.prefix) {
+            std::cerr << "The keys resolve to the prefix suffix mode, which "
+                         "generated matchers do not support\n";
+            return EXIT_FAILURE;
+        }
+        header = generate(options, keys, data, compile_key_dfa(key_views));
+    } catch (const FindkeyError& error) {
+        std::cerr << "Compile failed: " << error.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream out(options.output_path, std::ios::binary);
+    out << header;
+    if (!out) {
+        std::cerr << "Failed to write " << options.output_path << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}